@@ -35,3 +35,38 @@ function(add_shaders TARGET_NAME)
             BYPRODUCTS ${SHADER_PRODUCTS}
     )
 endfunction()
+
+# Compile variants of a shader with preprocessor definitions, in <shader>.<variant>.spv
+# Arguments after the shader source are pairs of variant name and definition
+function(add_shader_variants TARGET_NAME SHADER_SOURCE)
+    set(VARIANTS ${ARGN})
+    set(SHADER_BINARIES ${Z0_SHADERS_BUILD_DIR})
+    cmake_path(ABSOLUTE_PATH SHADER_SOURCE NORMALIZE)
+    cmake_path(GET SHADER_SOURCE FILENAME SHADER_NAME)
+
+    set(SHADER_COMMANDS)
+    set(SHADER_PRODUCTS)
+    list(LENGTH VARIANTS VARIANTS_COUNT)
+    math(EXPR LAST_VARIANT "${VARIANTS_COUNT} - 1")
+    foreach(INDEX RANGE 0 ${LAST_VARIANT} 2)
+        math(EXPR DEFINE_INDEX "${INDEX} + 1")
+        list(GET VARIANTS ${INDEX} VARIANT_NAME)
+        list(GET VARIANTS ${DEFINE_INDEX} VARIANT_DEFINE)
+
+        list(APPEND SHADER_COMMANDS COMMAND)
+        list(APPEND SHADER_COMMANDS Vulkan::glslc)
+        list(APPEND SHADER_COMMANDS "-D${VARIANT_DEFINE}")
+        list(APPEND SHADER_COMMANDS "${SHADER_SOURCE}")
+        list(APPEND SHADER_COMMANDS "-o")
+        list(APPEND SHADER_COMMANDS "${SHADER_BINARIES}/${SHADER_NAME}.${VARIANT_NAME}.spv")
+
+        list(APPEND SHADER_PRODUCTS "${SHADER_BINARIES}/${SHADER_NAME}.${VARIANT_NAME}.spv")
+    endforeach()
+
+    add_custom_target(${TARGET_NAME} ALL
+            ${SHADER_COMMANDS}
+            COMMENT "Compiling Shaders variants [${TARGET_NAME}]"
+            SOURCES ${SHADER_SOURCE}
+            BYPRODUCTS ${SHADER_PRODUCTS}
+    )
+endfunction()
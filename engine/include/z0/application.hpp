@@ -4,7 +4,6 @@
 #include "z0/application_config.hpp"
 #include "z0/vulkan/vulkan_instance.hpp"
 #include "z0/nodes/node.hpp"
-#include "z0/utils/blocking_queue.hpp"
 
 #include <Jolt/Jolt.h>
 #include <Jolt/Physics/PhysicsSystem.h>
@@ -46,7 +45,6 @@ namespace z0 {
     };
 
     class Viewport;
-    const float dt = 0.01; // Fixed delta time
 
     class Application: public Object {
     public:
@@ -65,9 +63,14 @@ namespace z0 {
         VulkanInstance vulkanInstance;
         std::shared_ptr<Viewport> viewport;
         const ApplicationConfig& applicationConfig;
+        // Fixed physics delta time
+        const float dt;
         std::shared_ptr<Node> currentScene;
         bool paused{false};
-        BlockingQueue<std::shared_ptr<Node>> queue{1000};
+        // Processed nodes of the current physics tick, in the tree order
+        std::vector<Node*> physicsNodes;
+        // Nodes per physics job
+        static constexpr uint32_t PHYSICS_NODES_CHUNK = 32;
 
         JPH::PhysicsSystem physicsSystem;
         BPLayerInterfaceImpl broad_phase_layer_interface;
@@ -78,7 +81,11 @@ namespace z0 {
 
         void ready(const std::shared_ptr<Node>& node);
         void process(const std::shared_ptr<Node>& node, float alpha);
-        void physicsProcess(const std::shared_ptr<Node>& node, float delta);
+        void physicsProcess(float delta);
+        void physicsUpdate();
+        void addPhysicsNodes(const std::shared_ptr<Node>& node);
+        // Render transforms of the nodes, the children of an interpolated physics body follow it
+        void interpolate(const std::shared_ptr<Node>& node, float alpha, const glm::mat4& correction, bool corrected);
         void input(const std::shared_ptr<Node>& node, InputEvent& event);
 
         static Application& get();
@@ -5,6 +5,7 @@
 #include <string>
 #include <cstdint>
 #include <filesystem>
+#include <vector>
 
 namespace z0 {
     enum MSAA {
@@ -14,14 +15,64 @@ namespace z0 {
         MSAA_8X         = 3,
     };
 
+    enum RenderingMode {
+        RENDERING_FORWARD   = 0,
+        RENDERING_DEFERRED  = 1,
+    };
+
+    enum ShadowFilter {
+        SHADOW_FILTER_HARDWARE_PCF  = 0,
+        SHADOW_FILTER_POISSON       = 1,
+        SHADOW_FILTER_PCSS          = 2,
+    };
+
     struct ApplicationConfig {
         std::string appName             = "MyApp";
         std::filesystem::path appDir    = ".";
+        // Directory of the device specific shader binaries cache, disabled if empty
+        std::filesystem::path shaderCacheDir = "shadercache";
         WindowMode windowMode           = WINDOW_MODE_WINDOWED;
         uint32_t windowWidth            = 800;
         uint32_t windowHeight           = 600;
         MSAA msaa                       = MSAA_2X;
         float gamma                     = 1.0f;
         float exposure                  = 1.0f;
+        // Deferred shading for the scenes with many lights, the transparent surfaces are still forward rendered
+        RenderingMode renderingMode     = RENDERING_FORWARD;
+        bool optimizeMeshes             = true;
+        // Simplification error budget of each generated mesh LOD, relative to the mesh size
+        std::vector<float> lodErrors    = {0.005f, 0.02f, 0.05f};
+        // Maximum projected simplification error, in pixels, when selecting a mesh LOD
+        float lodPixelError             = 1.0f;
+        // LOD error multiplier for the shadow passes
+        float shadowLodBias             = 4.0f;
+        // Cull the meshes clusters of triangles on the GPU and draw the visible ones with indirect draws
+        // (needs VK_KHR_draw_indirect_count)
+        bool meshletCulling             = true;
+        // Also cull the clusters hidden by the depth prepass of the previous frame (needs MSAA)
+        bool occlusionCulling           = true;
+        // Number of cascades of the directional light shadow map, from 1 to 4
+        uint32_t shadowCascades         = 4;
+        // Cascades splits, from uniform (0.0) to logarithmic (1.0)
+        float shadowCascadesSplitLambda = 0.75f;
+        // Maximum distance from the camera of the directional light shadows
+        float shadowMaxDistance         = 100.0f;
+        // Keep the static shadow casters in a cached layer, re-rendered only when the light or a static caster moves
+        bool shadowCaching              = true;
+        // Shadows filtering quality : single hardware PCF tap, Poisson disk of PCF taps or soft shadows (PCSS)
+        ShadowFilter shadowFilter       = SHADOW_FILTER_HARDWARE_PCF;
+        // Maximum number of point & spot lights sent to the GPU each frame, the most important visible ones first
+        uint32_t maxVisibleLights       = 256;
+        // Upload the textures mip tail at load time then stream the finer mip levels needed by the visible meshes
+        bool textureStreaming           = true;
+        // Video memory budget in MB, replacing the budget reported by the driver if not 0.
+        // Over the budget the least recently used textures mip levels and meshes are evicted
+        uint32_t videoMemoryBudget      = 0;
+        // Record & present the frames on a render thread while the game thread simulates the next frame.
+        // Adds up to one frame of input latency, measured by Viewport::getFrameLatency()
+        bool pipelinedRendering         = true;
+        // Fixed physics time step rate, in ticks per second. The physics bodies are interpolated between
+        // the last two ticks for the rendering, a lower rate saves CPU time without visual judder
+        uint32_t physicsTickRate        = 100;
     };
 }
\ No newline at end of file
@@ -16,9 +16,14 @@ namespace z0 {
 
         const glm::mat4& getProjection();
         const glm::mat4& getView() const { return viewMatrix; }
+        float getFov() const { return fov; }
+        float getNearDistance() const { return nearDistance; }
+        float getFarDistance() const { return farDistance; }
 
         void updateTransform(const glm::mat4& parentMatrix);
         void updateTransform();
+        // The view used by the rendering follows the interpolated transform
+        void _setInterpolatedTransform(const glm::mat4& transform) override;
 
     private:
         float fov{75.0};
@@ -30,7 +35,7 @@ namespace z0 {
 
         const glm::vec3 direction{0.0f, 0.0f, 1.0f };
 
-        void setViewDirection();
+        void setViewDirection(const glm::mat4& transform);
 
     };
 }
\ No newline at end of file
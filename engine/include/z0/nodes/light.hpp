@@ -14,6 +14,7 @@ namespace z0 {
         virtual ~Light() {};
 
         glm::vec4& getColorAndIntensity() { return colorAndIntensity; }
+        const glm::vec4& getColorAndIntensity() const { return colorAndIntensity; }
         void setColorAndIntensity(glm::vec4 color) { colorAndIntensity = color; }
         float getSpecularIntensity() const { return specularIntensity; }
         void setSpecularIntensity(float specular) { specularIntensity = specular; }
@@ -4,6 +4,8 @@
 
 namespace z0 {
 
+    class Camera;
+
     class MeshInstance: public Node {
     public:
         explicit MeshInstance(const std::string name = "MeshInstance"): Node{name} { }
@@ -12,10 +14,19 @@ namespace z0 {
         void setMesh(const std::shared_ptr<Mesh>& _mesh) { mesh = _mesh; };
         std::shared_ptr<Mesh> getMesh() const { return mesh; }
         bool isValid() const { return mesh != nullptr; }
+        // The rendering helpers use the interpolated transforms of the instance and the camera.
+        // Select the coarsest level of detail with a projected error below the threshold, in pixels
+        uint32_t getLod(const Camera& camera, float viewportHeight, float threshold) const;
+        // Bounding sphere in world space, center in xyz and radius in w
+        glm::vec4 getWorldBounds() const;
+        // Projected diameter of the bounding sphere, in pixels
+        float getScreenSize(const Camera& camera, float viewportHeight) const;
         //std::string toString() const override;
 
     private:
         std::shared_ptr<Mesh> mesh;
+        // Size in pixels of one world unit at the distance of the closest point of the bounding sphere
+        float getPixelsPerUnit(const Camera& camera, float viewportHeight) const;
         std::shared_ptr<Node> duplicateInstance() override;
     };
 
@@ -54,6 +54,8 @@ namespace z0 {
         // world relative position
         virtual void setPositionGlobal(glm::vec3 position);
         glm::vec3 getPositionGlobal() const { return worldTransform[3]; }
+        // world position used by the rendering, see getTransformInterpolated()
+        glm::vec3 getPositionInterpolated() const { return interpolatedTransform[3]; }
         void translateGlobal(glm::vec3 globalOffset);
 
         // rotations around own center
@@ -91,6 +93,9 @@ namespace z0 {
         virtual void setTransform(glm::mat4 transform) { localTransform = transform; }
         glm::mat4& getTransform() { return localTransform; }
         glm::mat4 getTransformGlobal() const { return worldTransform; }
+        // World transform with the physics bodies interpolated between the last two physics ticks,
+        // updated once per frame before the rendering
+        glm::mat4 getTransformInterpolated() const { return interpolatedTransform; }
         virtual void updateTransform();
         virtual void updateTransform(const glm::mat4& parentMatrix);
 
@@ -114,6 +119,7 @@ namespace z0 {
         std::string name;
         glm::mat4 localTransform {};
         glm::mat4 worldTransform {};
+        glm::mat4 interpolatedTransform {};
         std::list<std::shared_ptr<Node>> children;
         bool needPhysics{false};
         Node* parent {nullptr};
@@ -131,7 +137,12 @@ namespace z0 {
         friend class Application;
 
     public:
+        // Called before and after each physics step
+        virtual void _prePhysicsUpdate() {};
         virtual void _physicsUpdate() {};
+        // Interpolated world transform of the nodes moved by the physics, returns false for the other nodes
+        virtual bool _interpolateTransform(float alpha, glm::mat4& transform) const { return false; }
+        virtual void _setInterpolatedTransform(const glm::mat4& transform) { interpolatedTransform = transform; }
         inline bool _needPhysics() const { return needPhysics; }
     };
 
@@ -21,6 +21,12 @@ namespace z0 {
         void setQuadratic(float _quadratic) { quadratic = _quadratic;}
         float getAttenuation() const { return attenuation; }
         void setAttenuation(float _attenuation) { attenuation = _attenuation;}
+        // Distance where the attenuated light intensity falls below LIGHT_CUTOFF
+        float getRange() const;
+
+        static constexpr float LIGHT_CUTOFF = 1.0f / 256.0f;
+        // Range of the lights without distance attenuation
+        static constexpr float LIGHT_MAX_RANGE = 1000.0f;
 
     private:
         // http://learnwebgl.brown37.net/09_lights/lights_attenuation.html
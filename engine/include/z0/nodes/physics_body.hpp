@@ -24,6 +24,7 @@ namespace z0 {
 
         void updateTransform() override;
         void updateTransform(const glm::mat4& parentMatrix) override;
+        bool _interpolateTransform(float alpha, glm::mat4& transform) const override;
 
     protected:
         JPH::BodyID bodyId;
@@ -38,15 +39,25 @@ namespace z0 {
                     const std::string name);
 
     private:
+        // World position & rotation of the body after a physics tick
+        struct PhysicsState {
+            glm::vec3 position{0.0f};
+            glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+            bool operator==(const PhysicsState&) const = default;
+        };
         JPH::EActivation activationMode;
         JPH::EMotionType motionType;
         uint32_t collisionLayer;
         uint32_t collisionMask;
         bool updating{false};
+        // States of the last two physics ticks, for the render interpolation
+        PhysicsState previousState;
+        PhysicsState currentState;
 
         void setPositionAndRotation();
 
     public:
+        void _prePhysicsUpdate() override;
         void _physicsUpdate() override;
     };
 
@@ -1,42 +1,89 @@
 #pragma once
 
 #include "z0/vulkan/vulkan_model.hpp"
+#include "z0/vulkan/vulkan_residency.hpp"
 #include "z0/resources/material.hpp"
+#include "z0/utils/mesh_optimizer.hpp"
 
 #include <unordered_set>
 
 namespace z0 {
 
+    // Range of the mesh index buffer, and the meshlets covering it
+    struct MeshSurfaceRange {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t firstMeshlet{0};
+        uint32_t meshletCount{0};
+    };
+
     struct MeshSurface {
         uint32_t firstVertexIndex;
         uint32_t indexCount;
         std::shared_ptr<Material> material;
+        // Coarser levels of detail, stored after all the LOD 0 surfaces in the mesh index buffer
+        std::vector<MeshSurfaceRange> lods;
+        // Meshlets of the LOD 0
+        uint32_t firstMeshlet{0};
+        uint32_t meshletCount{0};
         MeshSurface(uint32_t first, uint32_t count): firstVertexIndex{first}, indexCount{count} {};
+
+        MeshSurfaceRange getLod(uint32_t lod) const;
     };
 
     class Mesh: public Resource {
     public:
         explicit Mesh(const std::string& meshName): Resource{meshName} {};
+        ~Mesh() override;
 
         std::vector<std::shared_ptr<MeshSurface>>& getSurfaces() { return surfaces; };
         std::shared_ptr<Material>& getSurfaceMaterial(uint32_t surfaceIndex);
         void setSurfaceMaterial(uint32_t surfaceIndex, std::shared_ptr<Material>& material);
         std::vector<Vertex>& getVertices() { return vertices; }
         std::vector<uint32_t>& getIndices() { return indices; }
-        bool isValid() override { return _model != nullptr; }
+        bool isValid() override { return modelBuilt; }
+
+        // Number of levels of detail, including the full resolution LOD 0
+        uint32_t getLodCount() const { return static_cast<uint32_t>(lodErrors.size()); }
+        // Simplification error of a level of detail, in the mesh space
+        float getLodError(uint32_t lod) const { return lodErrors[lod]; }
+        // Bounding sphere in the mesh space
+        const glm::vec3& getBoundsCenter() const { return boundsCenter; }
+        float getBoundsRadius() const { return boundsRadius; }
+        // Clusters of triangles of all the surfaces and levels of detail
+        const std::vector<MeshOptimizer::Meshlet>& getMeshlets() const { return meshlets; }
 
     private:
         std::vector<Vertex> vertices{};
         std::vector<uint32_t> indices{};
         std::vector<std::shared_ptr<MeshSurface>> surfaces{};
+        std::vector<float> lodErrors{0.0f};
+        glm::vec3 boundsCenter{0.0f};
+        float boundsRadius{0.0f};
+        std::vector<MeshOptimizer::Meshlet> meshlets{};
+
+        void computeBounds();
 
+        // The model buffers are evicted over the video memory budget when unused, and uploaded again when drawn
         std::shared_ptr<VulkanModel> _model;
+        bool modelBuilt{false};
+        VulkanResidency* residency{nullptr};
+        VulkanResidency::handle_t residencyHandle{0};
         std::unordered_set<std::shared_ptr<Material>> _materials{};
 
     public:
         std::unordered_set<std::shared_ptr<Material>>& _getMaterials() { return _materials; };
+        // Model used by the recording threads, made resident by _useModel() before the recording
         std::shared_ptr<VulkanModel>& _getModel() { return _model; };
+        // Model to draw in the current frame, uploaded again if evicted. Main thread only
+        VulkanModel& _useModel();
         void _buildModel();
+        MeshOptimizer::Stats _optimize();
+        // Generate one level of detail per error budget (relative to the bounding radius).
+        // Returns the triangles count of each generated level.
+        std::vector<uint32_t> _buildLods(const std::vector<float>& errorBudgets);
+        // Split all the surfaces and levels of detail in meshlets. Returns the meshlets count.
+        uint32_t _buildMeshlets();
     };
 
 }
\ No newline at end of file
@@ -10,6 +10,9 @@ namespace z0 {
     public:
         DebugUI(VulkanDevice& vulkanDevice, WindowHelper& windowHelper);
 
+        // Build the UI of the frame, on the main thread (GLFW)
+        void newFrame();
+        // Record the UI built by newFrame(), on the render thread
         void drawFrame(VkCommandBuffer commandBuffer, VkImageView targetImageView, VkExtent2D extent);
         void cleanup(VulkanDevice& device);
 
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "z0/object.hpp"
+
+namespace z0 {
+
+    // Planes of a view frustum, extracted from a view projection matrix with a depth range from 0 to 1
+    // https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf
+    struct Frustum {
+        // left, right, bottom, top, near, far. Normalized, pointing inside
+        glm::vec4 planes[6];
+
+        explicit Frustum(const glm::mat4& viewProjection);
+
+        // Sphere entirely behind one of the planes
+        bool isOutside(const glm::vec3& center, float radius) const;
+    };
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace z0 {
+
+    // Group of jobs waited together
+    struct JobCounter {
+        // Number of unfinished jobs, incremented by JobSystem::run() and decremented when a job ends
+        std::atomic<uint32_t> pending{0};
+        // First exception thrown by a job of the group, rethrown by JobSystem::wait()
+        std::exception_ptr exception;
+        std::atomic_flag failed;
+    };
+
+    // Work-stealing job system with one worker thread per core, the main thread being the last core.
+    // Each worker executes the jobs of its own queue, last pushed first, and steals the oldest jobs of the
+    // other queues when empty. The other threads (main, render) get their own queue on their first use of
+    // the job system and only steal from the workers, so they never execute the jobs of each other.
+    // A thread waiting for a counter executes the pending jobs and only sleeps when all the remaining jobs
+    // of the counter are running.
+    // https://blog.molecular-matters.com/2015/08/24/job-system-2-0-lock-free-work-stealing-part-1-basics/
+    class JobSystem {
+    public:
+        using Job = std::function<void()>;
+
+        explicit JobSystem(uint32_t workersCount);
+        ~JobSystem();
+
+        // Push a job of the counter group
+        void run(JobCounter& counter, Job job);
+        // Execute the pending jobs until all the jobs of the counter are done, then rethrow the first
+        // exception thrown by the jobs of the counter
+        void wait(JobCounter& counter);
+        uint32_t getWorkersCount() const { return workersCount; }
+
+        // Maximum number of non-worker threads using the job system at the same time
+        static constexpr uint32_t MAX_EXTERNAL_THREADS = 8;
+
+        static JobSystem& get();
+
+    private:
+        struct Task {
+            Job job;
+            JobCounter* counter{nullptr};
+        };
+        // Queues are locked one at a time, only for a push, a pop or a steal
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+        const uint32_t workersCount;
+        // One queue per worker, then one queue per non-worker thread
+        std::vector<std::unique_ptr<Queue>> queues;
+        // Queues of the non-worker threads in use
+        std::mutex externalQueuesMutex;
+        std::vector<bool> externalQueuesUsed;
+        std::vector<std::jthread> workers;
+        // Incremented for each pushed job, the idle workers wait for a change
+        std::atomic<uint64_t> pushedJobs{0};
+        // Incremented when the last job of a counter is done, the waiting threads wait for a change
+        std::atomic<uint64_t> completedGroups{0};
+        std::atomic<bool> stopping{false};
+
+        void workerLoop(uint32_t index);
+        // Queue of the calling thread, a non-worker thread gets a queue on its first call
+        uint32_t getQueueIndex();
+        // Queue of a non-worker thread, released when the thread ends
+        uint32_t acquireExternalQueue();
+        void releaseExternalQueue(uint32_t queueIndex);
+        // Execute a job of the queue or stolen from another queue, returns false if all the queues are empty
+        bool tryExecute(uint32_t queueIndex);
+
+        friend struct ThreadQueue;
+
+    public:
+        JobSystem(const JobSystem&) = delete;
+        JobSystem &operator=(const JobSystem&) = delete;
+        JobSystem(const JobSystem&&) = delete;
+        JobSystem &&operator=(const JobSystem&&) = delete;
+    };
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "z0/object.hpp"
+
+#include <vector>
+
+namespace z0 {
+
+    // CPU culling of the point & spot lights before the upload : the lights spheres (position + attenuation range)
+    // are tested against the camera frustum, four lights at a time over structure-of-arrays storage,
+    // then the visible ones are sorted by their projected screen size weighted by the intensity and
+    // capped to a budget.
+    // https://www.intel.com/content/www/us/en/developer/articles/technical/deferred-rendering-for-current-and-future-rendering-pipelines.html
+    class LightCuller {
+    public:
+        // Set the number of lights, the lights must then be updated with setLight()
+        void resize(uint32_t count);
+        void setLight(uint32_t index, const glm::vec3& position, float range, float intensity);
+        // Indices of the lights visible from the camera, the most important first, at most budget lights
+        const std::vector<uint32_t>& cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+                                          float nearDistance, uint32_t budget);
+
+    private:
+        std::vector<float> positionsX;
+        std::vector<float> positionsY;
+        std::vector<float> positionsZ;
+        std::vector<float> ranges;
+        std::vector<float> intensities;
+        std::vector<float> importances;
+        std::vector<uint32_t> visibles;
+    };
+
+}
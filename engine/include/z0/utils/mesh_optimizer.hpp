@@ -0,0 +1,87 @@
+#pragma once
+
+#include "z0/vertex.hpp"
+
+#include <vector>
+
+namespace z0 {
+
+    // Load-time mesh optimisations.
+    // Triangles are only reordered inside their own index range, so the mesh surfaces stay valid.
+    // Derived from :
+    // https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+    // https://gfx.cs.princeton.edu/pubs/Sander_2007_%3ETR/tipsy.pdf
+    // https://github.com/zeux/meshoptimizer
+    // https://www.cs.cmu.edu/~./garland/Papers/quadrics.pdf
+    // https://zeux.io/2023/01/16/meshlet-size-tradeoffs/
+    class MeshOptimizer {
+    public:
+        struct IndexRange {
+            uint32_t first;
+            uint32_t count;
+        };
+        struct Stats {
+            uint32_t verticesBefore{0};
+            uint32_t verticesAfter{0};
+            uint32_t triangles{0};
+            float acmrBefore{0.0f};
+            float acmrAfter{0.0f};
+        };
+        // Cluster of contiguous triangles of the index buffer, with its culling data in the mesh space
+        struct Meshlet {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            glm::vec3 center;
+            float radius;
+            glm::vec3 coneApex;
+            glm::vec3 coneAxis;
+            // backfacing when dot(normalize(coneApex - eye), coneAxis) >= coneCutoff, 1.0 for never
+            float coneCutoff;
+        };
+
+        // Size of the simulated FIFO post-transform cache used to compute the ACMR
+        static constexpr uint32_t CACHE_SIZE = 16;
+        // Meshlets limits
+        static constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+        static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+        // Simplification cost of an attributes discontinuity (normal & uv distance) created by a collapse
+        // across a seam, relative to the bounding radius of the simplified range
+        static constexpr float SEAM_PENALTY = 0.1f;
+        // Seam penalty weight of the ranges without extent
+        static constexpr double MIN_SEAM_WEIGHT = 1e-6;
+
+        // Run all the passes : deduplication, vertex cache, overdraw and vertex fetch
+        static Stats optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<IndexRange>& ranges);
+
+        // Average Cache Miss Ratio : number of transformed vertices per triangle
+        static float computeACMR(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+        // Remap the index buffer to unique vertices
+        static void deduplicateVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+        // Reorder triangles for the post-transform vertex cache (Forsyth)
+        static void optimizeVertexCache(uint32_t* indices, uint32_t indexCount);
+        // Reorder clusters of triangles front to back, keeping the cache efficiency in the threshold (Tipsify)
+        static void optimizeOverdraw(uint32_t* indices, uint32_t indexCount, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+        // Reorder vertices in the order of their first use by the index buffer
+        static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+        // Simplify a triangle list with quadric error metrics by collapsing edges onto existing positions,
+        // until the target index count is reached or until the next collapse exceeds the target error.
+        // Borders are kept, the collapses across attributes seams are penalized. Returns the simplified
+        // triangle list and the geometric error reached, without the seams penalties, both errors being
+        // distances in the vertices space.
+        static std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices,
+                                              const uint32_t* indices, uint32_t indexCount,
+                                              uint32_t targetIndexCount, float targetError, float& resultError);
+
+        // Split a range of the index buffer, in its current triangles order, into meshlets
+        // of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles
+        static std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices,
+                                                  const uint32_t* indices, uint32_t firstIndex, uint32_t indexCount);
+
+    private:
+        static Meshlet computeMeshletBounds(const std::vector<Vertex>& vertices,
+                                            const uint32_t* indices, uint32_t firstIndex, uint32_t indexCount);
+    };
+
+}
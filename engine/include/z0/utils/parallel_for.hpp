@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace z0 {
+
+    // Run a function for each index in [0, count) with the job system, one index per job.
+    // The calling thread executes jobs until all the indices are done
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& function);
+
+    // Run a function for each range [begin, end) of at most chunkSize indices in [0, count), one range per job
+    void parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+}
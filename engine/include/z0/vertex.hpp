@@ -2,6 +2,8 @@
 
 #include "z0/object.hpp"
 
+#include <glm/gtx/hash.hpp>
+
 namespace z0 {
 
     struct Vertex {
@@ -11,8 +13,26 @@ namespace z0 {
         glm::vec4   tangent{};
 
         bool operator==(const Vertex&other) const {
-            return position == other.position && normal == other.normal && uv == other.uv;
+            return position == other.position && normal == other.normal && uv == other.uv && tangent == other.tangent;
         }
     };
 
-}
\ No newline at end of file
+    // from: https://stackoverflow.com/a/57595105
+    template<typename T, typename... Rest>
+    void hashCombine(std::size_t &seed, const T &v, const Rest &... rest) {
+        seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        (hashCombine(seed, rest), ...);
+    };
+
+}
+
+namespace std {
+    template<>
+    struct hash<z0::Vertex>{
+        size_t operator()(z0::Vertex const &vertex) const {
+            size_t seed = 0;
+            z0::hashCombine(seed, vertex.position, vertex.normal, vertex.uv, vertex.tangent);
+            return seed;
+        }
+    };
+}
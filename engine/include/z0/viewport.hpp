@@ -5,6 +5,10 @@
 #include "z0/helpers/window_helper.hpp"
 #include "z0/vulkan/vulkan_device.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 namespace z0 {
 
     class SceneRenderer;
@@ -14,15 +18,20 @@ namespace z0 {
     class Viewport: public Object {
     public:
         Viewport(VulkanInstance& instance, const ApplicationConfig& applicationConfig);
+        ~Viewport();
 
         MSAA getMSAA() const;
         void setMSAA(MSAA samples);
         float getAspectRatio() const;
 
+        // Take the snapshot of the scene for the next frame then render it, on the render thread if pipelined
         void drawFrame();
+        // Wait for the render thread and the GPU
         void wait();
         bool shouldClose() { return window.shouldClose(); }
         float getFPS() const { return fps; }
+        // Time between the input events sampling and the presentation of the last frame, in milliseconds
+        float getFrameLatency() const { return vulkanDevice->getFrameLatency(); }
 
         void loadScene(std::shared_ptr<Node>& rootNode);
 
@@ -35,6 +44,20 @@ namespace z0 {
         std::shared_ptr<SceneRenderer> sceneRenderer;
         std::shared_ptr<TonemappingRenderer> tonemappingRenderer;
         std::shared_ptr<SimplePostprocessingRenderer> postprocessingRenderer;
+        // Sampling time of the input events consumed by the next snapshot
+        std::chrono::steady_clock::time_point inputTime;
+
+        // Pipelined rendering : the render thread records frame N while the game thread simulates frame N+1.
+        // Lock-free hand-off with two counters, the game thread increments preparedFrames after the snapshot,
+        // the render thread increments renderedFrames after the presentation. A snapshot is only taken
+        // when both are equal, the render thread never reads the nodes.
+        std::atomic<uint64_t> preparedFrames{0};
+        std::atomic<uint64_t> renderedFrames{0};
+        std::atomic<bool> stopRendering{false};
+        std::jthread renderThread;
+
+        void renderLoop();
+        void waitRenderThread();
 
     public:
         VulkanDevice& _getDevice() { return *vulkanDevice; }
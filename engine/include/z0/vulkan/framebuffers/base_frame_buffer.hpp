@@ -2,24 +2,38 @@
 
 #include "z0/vulkan/vulkan_device.hpp"
 
+#include <limits>
+
 namespace z0 {
 
     // Base class for all offscreen fame buffers & rendering attachements
     class BaseFrameBuffer {
     public:
+        // The image has its own memory allocation
+        static constexpr uint32_t NO_ALIASING = std::numeric_limits<uint32_t>::max();
+
         const VkImage& getImage() const { return image; }
         const VkImageView& getImageView() const { return imageView; }
+        VkFormat getFormat() const { return imageFormat; }
+        // Memory aliasing slot of the device shared with other attachments, or NO_ALIASING
+        uint32_t getAliasingSlot() const { return aliasingSlot; }
 
         virtual void createImagesResources() = 0;
         virtual void cleanupImagesResources();
 
     protected:
         VulkanDevice& vulkanDevice;
-        VkImage image;
-        VkImageView imageView;
-        VkDeviceMemory imageMemory;
-
-        BaseFrameBuffer(VulkanDevice &dev): vulkanDevice{dev} {};
+        VkImage image{VK_NULL_HANDLE};
+        VkImageView imageView{VK_NULL_HANDLE};
+        VkFormat imageFormat{VK_FORMAT_UNDEFINED};
+        // VK_NULL_HANDLE for the aliased images
+        VmaAllocation allocation{VK_NULL_HANDLE};
+        const uint32_t aliasingSlot;
+
+        // With an aliasing slot the memory is shared with the attachments of the slot, their lifetimes
+        // in a frame must not overlap
+        BaseFrameBuffer(VulkanDevice &dev, uint32_t aliasingSlot = NO_ALIASING):
+            vulkanDevice{dev}, aliasingSlot{aliasingSlot} {};
 
         // Helper function for children classes
         void createImage(uint32_t width,
@@ -27,7 +41,8 @@ namespace z0 {
                          VkFormat format,
                          VkSampleCountFlagBits samples,
                          VkImageUsageFlags usage,
-                         VkImageAspectFlags flags = VK_IMAGE_ASPECT_COLOR_BIT);
+                         VkImageAspectFlags flags = VK_IMAGE_ASPECT_COLOR_BIT,
+                         MemoryCategory category = MEMORY_ATTACHMENTS);
 
     public:
         BaseFrameBuffer(const BaseFrameBuffer&) = delete;
@@ -7,8 +7,10 @@ namespace z0 {
     // Rendering attachments
     class ColorAttachment: public BaseFrameBuffer {
     public:
-        // If multisampled==true attachment will support multisampling *and* HDR
-        explicit ColorAttachment(VulkanDevice &dev, bool multisampled);
+        // If multisampled==true attachment will support multisampling *and* HDR.
+        // The multisampled attachment is transient : resolved at the end of the pass, never stored.
+        // Lazily allocated if supported, otherwise in the aliasing slot if any
+        explicit ColorAttachment(VulkanDevice &dev, bool multisampled, uint32_t aliasingSlot = NO_ALIASING);
         void createImagesResources() override;
     private:
         bool multisampled;
@@ -12,7 +12,7 @@ namespace z0 {
         // https://www.khronos.org/registry/vulkan/specs/1.0/pdf/vkspec.pdf
         static const VkFormat renderFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
 
-        explicit ColorAttachmentHDR(VulkanDevice &dev);
+        explicit ColorAttachmentHDR(VulkanDevice &dev, uint32_t aliasingSlot = NO_ALIASING);
         void createImagesResources() override;
         void cleanupImagesResources() override;
         VkDescriptorImageInfo imageInfo();
@@ -9,8 +9,12 @@ namespace z0 {
     public:
         explicit DepthBuffer(VulkanDevice &dev, bool multisampled);
         void createImagesResources();
+        // Multisampled buffer of a tile based GPU, lazily allocated : only lives in the scene pass,
+        // without depth prepass nor Hi-Z pyramid
+        bool isTransient() const { return transient; }
     private:
         bool multisampled;
+        bool transient;
     };
 
 }
\ No newline at end of file
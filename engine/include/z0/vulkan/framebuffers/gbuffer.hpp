@@ -0,0 +1,54 @@
+#pragma once
+
+#include "base_frame_buffer.hpp"
+
+#include <array>
+
+namespace z0 {
+
+    // One attachment of the G-buffer
+    class GBufferAttachment: public BaseFrameBuffer {
+    public:
+        GBufferAttachment(VulkanDevice &dev, VkFormat format, bool multisampled, uint32_t aliasingSlot = NO_ALIASING);
+        void createImagesResources() override;
+    private:
+        VkFormat format;
+        bool multisampled;
+    };
+
+    // G-buffer of the deferred renderer : multisampled rendering attachments, resolved into sampled images.
+    // The resolved albedo is only used until the lighting pass and can share its memory with an attachment
+    // written after the lighting pass. Must be the same formats as gbuffer.glsl
+    class GBuffer {
+    public:
+        enum Attachment {
+            ALBEDO      = 0,
+            NORMAL      = 1,
+            MATERIAL    = 2,
+        };
+        static constexpr uint32_t ATTACHMENTS_COUNT = 3;
+        static constexpr std::array<VkFormat, ATTACHMENTS_COUNT> formats {
+            VK_FORMAT_R8G8B8A8_UNORM,   // albedo
+            VK_FORMAT_R16G16_SFLOAT,    // octahedral encoded normal
+            VK_FORMAT_R8G8B8A8_UNORM,   // specular color & shininess
+        };
+
+        explicit GBuffer(VulkanDevice &dev, uint32_t albedoAliasingSlot = BaseFrameBuffer::NO_ALIASING);
+        void createImagesResources();
+        void cleanupImagesResources();
+
+        GBufferAttachment& getAttachment(uint32_t index) { return *attachments[index]; }
+        GBufferAttachment& getResolvedAttachment(uint32_t index) { return *resolvedAttachments[index]; }
+
+    private:
+        std::array<std::unique_ptr<GBufferAttachment>, ATTACHMENTS_COUNT> attachments;
+        std::array<std::unique_ptr<GBufferAttachment>, ATTACHMENTS_COUNT> resolvedAttachments;
+
+    public:
+        GBuffer(const GBuffer&) = delete;
+        GBuffer &operator=(const GBuffer&) = delete;
+        GBuffer(const GBuffer&&) = delete;
+        GBuffer &&operator=(const GBuffer&&) = delete;
+    };
+
+}
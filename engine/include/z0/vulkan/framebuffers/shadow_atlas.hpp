@@ -0,0 +1,59 @@
+#pragma once
+
+#include "z0/vulkan/framebuffers/base_frame_buffer.hpp"
+
+#include <string>
+#include <vector>
+
+namespace z0 {
+
+    // Single depth image shared by all the shadow maps, each shadow map cascade is rendered in a square tile.
+    // The tiles sizes are powers of two, packed largest first along a Z-order curve :
+    // each tile starts on a multiple of its own area and always covers an aligned square of the atlas.
+    // https://developer.nvidia.com/gpugems/gpugems3/part-ii-light-and-shadows/chapter-10-parallel-split-shadow-maps-programmable-gpus
+    class ShadowAtlas: public BaseFrameBuffer {
+    public:
+        struct Tile {
+            uint32_t x{0};
+            uint32_t y{0};
+            uint32_t size{0};
+
+            bool operator==(const Tile&) const = default;
+        };
+
+#if defined(__ANDROID__)
+        static constexpr uint32_t SIZE{ 2048 };
+#else
+        static constexpr uint32_t SIZE{ 4096 };
+#endif
+        static constexpr uint32_t MIN_TILE_SIZE{ SIZE / 32 };
+        static constexpr uint32_t MAX_TILE_SIZE{ SIZE / 2 };
+
+        explicit ShadowAtlas(VulkanDevice &dev);
+
+        // Set the position of the tiles, returns false if they do not fit in the atlas
+        static bool allocate(std::vector<Tile>& tiles);
+
+        // Comparison sampler for the hardware PCF
+        const VkSampler& getSampler() const { return sampler; }
+        // Sampler of the raw depths, for the PCSS blockers search
+        const VkSampler& getDepthSampler() const { return depthSampler; }
+        // Suffix of the shaders compiled for the configured shadow filtering
+        static std::string getFilterShaderVariant();
+        // Depth of the static casters only, copied in the atlas before drawing the dynamic casters
+        bool isCached() const { return staticImage != VK_NULL_HANDLE; }
+        const VkImage& getStaticImage() const { return staticImage; }
+        const VkImageView& getStaticImageView() const { return staticImageView; }
+
+        void createImagesResources() override;
+        void cleanupImagesResources() override;
+
+    private:
+        VkSampler sampler{VK_NULL_HANDLE};
+        VkSampler depthSampler{VK_NULL_HANDLE};
+        VkImage staticImage{VK_NULL_HANDLE};
+        VmaAllocation staticImageAllocation{VK_NULL_HANDLE};
+        VkImageView staticImageView{VK_NULL_HANDLE};
+    };
+
+}
@@ -1,36 +1,54 @@
 #pragma once
 
-#include "z0/vulkan/framebuffers/base_frame_buffer.hpp"
+#include "z0/vulkan/framebuffers/shadow_atlas.hpp"
 #include "z0/nodes/light.hpp"
+#include "z0/nodes/camera.hpp"
+
+#include <array>
 
 namespace z0 {
 
-    // Rendering attachment or resolved offscreen depth buffer
-    class ShadowMap: public BaseFrameBuffer {
+    // Shadow map of a light, rendered in tiles of the shadow atlas.
+    // Directional lights shadows are split in cascades fitted to the camera frustum, one tile per cascade.
+    // https://learn.microsoft.com/en-us/windows/win32/dxtecharts/cascaded-shadow-maps
+    // https://developer.nvidia.com/gpugems/gpugems3/part-ii-light-and-shadows/chapter-10-parallel-split-shadow-maps-programmable-gpus
+    class ShadowMap {
     public:
-        explicit ShadowMap(VulkanDevice &dev, Light* light);
+        // Must be the same value as lights.glsl
+        static constexpr uint32_t MAX_CASCADES = 4;
+
+        explicit ShadowMap(Light* light);
 
         // Keep depth range as small as possible
         // for better shadow map precision const
         const float zNear = .1f;
         const float zFar = 50.0f;
-
-#if defined(__ANDROID__)
-	    const uint32_t size{ 1024 };
-#else
-        const uint32_t size{ 2048 };
-#endif
-
-        glm::mat4 getLightSpace() const;
-        glm::vec3 getLightPosition() const { return light->getPosition(); }
-        const VkSampler& getSampler() const { return sampler; }
-
-        void createImagesResources();
-        void cleanupImagesResources();
+        // Distance, behind a cascade, of the shadow casters of this cascade
+        const float cascadeCastersDistance = 50.0f;
+
+        const uint32_t cascadesCount;
+        // Size of the tiles of the cascades, maximum size of the tile for the spot lights
+        const uint32_t size;
+
+        // Camera used to fit the cascades
+        void setCamera(Camera* camera) { currentCamera = camera; }
+        uint32_t getCascadesCount() const { return cascadesCount; }
+        glm::mat4 getLightSpace(uint32_t cascade = 0) const;
+        // Farthest view space depth of a cascade
+        float getCascadeSplit(uint32_t cascade) const;
+        glm::vec3 getLightPosition() const { return light->getPositionInterpolated(); }
+        Light* getLight() const { return light; }
+        bool isDirectional() const;
+        // Tile of a cascade in the shadow atlas, chosen each frame by the shadow map renderer
+        const ShadowAtlas::Tile& getTile(uint32_t cascade) const { return tiles[cascade]; }
+        void setTile(uint32_t cascade, const ShadowAtlas::Tile& tile) { tiles[cascade] = tile; }
 
     private:
         Light* light;
-        VkSampler sampler{VK_NULL_HANDLE};
+        Camera* currentCamera{nullptr};
+        std::array<ShadowAtlas::Tile, MAX_CASCADES> tiles{};
+
+        glm::mat4 getCascadeLightSpace(uint32_t cascade) const;
     };
 
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "z0/vulkan/renderers/base_renderpass.hpp"
+#include "z0/vulkan/renderers/meshlet_culling_renderer.hpp"
 #include "z0/vulkan/framebuffers/depth_buffer.hpp"
 #include "z0/nodes/mesh_instance.hpp"
 #include "z0/nodes/camera.hpp"
@@ -15,14 +16,42 @@ namespace z0 {
         std::shared_ptr<DepthBuffer>& getDepthBuffer() { return depthBuffer; }
 
     protected:
+        // Render state of a mesh instance, taken by update() on the game thread. The passes are recorded
+        // from the snapshots by the render thread while the nodes are updated for the next frame
+        struct MeshSnapshot {
+            Node::id_t id;
+            // nullptr if the mesh is not valid or outside of the camera frustum
+            std::shared_ptr<Mesh> mesh;
+            uint32_t lod;
+            // Index of the first surface of the mesh in the surfaces snapshots and the surfaces buffers,
+            // the surfaces of all the valid meshes are numbered, visible or not
+            uint32_t firstSurface{0};
+        };
+        // Render state of a surface : the materials can be changed by the game thread during the recording
+        struct SurfaceSnapshot {
+            VkCullModeFlags cullMode;
+            // Shader permutation of the material, set by the renderers using them
+            uint32_t permutation{0};
+        };
+
         Camera* currentCamera {nullptr};
         std::vector<MeshInstance*> meshes {};
+        // Snapshots of the meshes, in the meshes order, for each frame in flight
+        std::vector<std::vector<MeshSnapshot>> meshesSnapshots{MAX_FRAMES_IN_FLIGHT};
+        std::vector<std::vector<SurfaceSnapshot>> surfacesSnapshots{MAX_FRAMES_IN_FLIGHT};
         std::shared_ptr<DepthBuffer> depthBuffer;
         std::vector<std::unique_ptr<VulkanBuffer>> modelsBuffers{MAX_FRAMES_IN_FLIGHT};
+        // GPU meshlets culling, nullptr if disabled
+        std::shared_ptr<MeshletCullingRenderer> meshletCulling;
 
         BaseMeshesRenderer(VulkanDevice& device, std::string shaderDirectory);
 
         void setInitialState(VkCommandBuffer commandBuffer);
+        // Level of detail of a mesh instance seen from the current camera
+        uint32_t getLod(const MeshInstance* meshInstance, float bias = 1.0f) const;
+        // Take the snapshots of the meshes for a frame and make the visible models resident.
+        // Must be called by update(), with a camera
+        void snapshotMeshes(uint32_t currentFrame);
 
     public:
         BaseMeshesRenderer(const BaseMeshesRenderer&) = delete;
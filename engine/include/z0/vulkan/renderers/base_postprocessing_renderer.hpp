@@ -16,14 +16,17 @@ namespace z0 {
         VkImageView getImageView() const override { return colorAttachmentHdr->getImageView(); }
 
         void cleanup() override;
-        void loadShaders() override;
+        // Full screen triangle vertex shader linked with the effect fragment shader
+        void createShaders(const std::string& fragFilename);
         void createGlobalDescriptorSetLayout(VkDeviceSize globalUboSize) ;
         void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) override;
         void createImagesResources() override;
         void cleanupImagesResources() override;
         void recreateImagesResources() override;
         void beginRendering(VkCommandBuffer commandBuffer) override;
-        void endRendering(VkCommandBuffer commandBuffer, bool isLast) override;
+        void endRendering(VkCommandBuffer commandBuffer) override;
+        // Reads the input attachment, writes the output attachment
+        void declareResources(RenderGraphPass& pass, uint32_t currentFrame) override;
 
     protected:
         VkDeviceSize globalUboSize;
@@ -8,6 +8,7 @@
 
 namespace z0 {
 
+    class Material;
 
     class BaseRenderpass {
     public:
@@ -39,11 +40,18 @@ namespace z0 {
         void createResources();
         void writeUniformBuffer(const std::vector<std::unique_ptr<VulkanBuffer>>& buffers, uint32_t currentFrame, void *data, uint32_t index = 0);
         void createUniformBuffers(std::vector<std::unique_ptr<VulkanBuffer>>& buffers, VkDeviceSize size, uint32_t count = 1);
-        void bindDescriptorSets(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t count = 0, uint32_t *offsets = nullptr);
+        void bindDescriptorSets(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t count = 0, uint32_t *offsets = nullptr,
+                                VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
         void bindShaders(VkCommandBuffer commandBuffer);
+        void bindShader(VkCommandBuffer commandBuffer, VulkanShader& shader);
         std::unique_ptr<VulkanShader> createShader(const std::string& filename,
                                                    VkShaderStageFlagBits stage,
-                                                   VkShaderStageFlags next_stage);
+                                                   VkShaderStageFlags next_stage,
+                                                   const std::vector<uint32_t>& specializationConstants = {});
+        // Create vertShader & fragShader in one linked call, letting the driver optimize across the stages
+        void createLinkedShaders(const std::string& vertFilename, const std::string& fragFilename);
+        // Faces culling of a surface material, no culling for the non-standard materials
+        static VkCullModeFlags getCullMode(const Material* material);
 
         virtual void loadShaders() = 0;
         virtual void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) = 0;
@@ -54,8 +62,6 @@ namespace z0 {
         void createPipelineLayout();
         std::vector<char> readFile(const std::string& fileName);
 
-        void bindShader(VkCommandBuffer commandBuffer, VulkanShader& shader);
-
     public:
         BaseRenderpass(const BaseRenderpass&) = delete;
         BaseRenderpass &operator=(const BaseRenderpass&) = delete;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "z0/vulkan/renderers/base_renderpass.hpp"
+#include "z0/vulkan/renderers/light_clusters_renderer.hpp"
+#include "z0/vulkan/framebuffers/gbuffer.hpp"
+#include "z0/vulkan/framebuffers/depth_buffer.hpp"
+#include "z0/vulkan/framebuffers/shadow_atlas.hpp"
+#include "z0/vulkan/framebuffers/color_attachment_hdr.hpp"
+
+namespace z0 {
+
+    // Lighting pass of the deferred renderer : a compute pass lights the resolved G-buffer with the
+    // clustered point lights and writes the result into the HDR color attachment.
+    // https://learnopengl.com/Advanced-Lighting/Deferred-Shading
+    class DeferredLightingRenderer: public BaseRenderpass {
+    public:
+        struct DirectionalLightUniform {
+            alignas(16) glm::vec3 direction = { 0.0f, 0.0f, 0.0f };
+            alignas(16) glm::vec4 color = { 0.0f, 0.0f, 0.0f, 0.0f }; // RGB + Intensity;
+            alignas(4) float specular = { 1.0f };
+        };
+        struct LightingUniformBufferObject {
+            glm::mat4 inverseViewProjection{1.0f};
+            glm::mat4 view{1.0f};
+            glm::vec4 ambient = { 1.0f, 1.0f, 1.0f, .0f }; // RGB + Intensity;
+            glm::vec4 clearColor;
+            alignas(16) glm::vec3 cameraPosition;
+            alignas(16) DirectionalLightUniform directionalLight;
+            alignas(4) bool haveDirectionalLight{false};
+            alignas(4) uint32_t shadowMapsCount{0};
+            alignas(4) float clustersNear;
+            alignas(4) float clustersFar;
+            alignas(8) glm::vec2 clustersTileSize;
+        };
+
+        DeferredLightingRenderer(VulkanDevice& device, const std::string& shaderDirectory);
+
+        void loadScene(std::shared_ptr<GBuffer>& gBuffer,
+                       std::shared_ptr<DepthBuffer>& resolvedDepthBuffer,
+                       std::shared_ptr<ColorAttachmentHDR>& colorAttachmentHdr,
+                       std::shared_ptr<LightClustersRenderer>& lightClusters,
+                       std::shared_ptr<ShadowAtlas>& shadowAtlas,
+                       std::vector<std::unique_ptr<VulkanBuffer>>& shadowMapsBuffers);
+        void cleanup() override;
+        void update(uint32_t currentFrame, const LightingUniformBufferObject& lightingUbo);
+        // Must be recorded outside of a rendering, with the G-buffer and the depth buffer in a shader read layout
+        // and the color attachment in the general layout
+        void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) override;
+        // Update the descriptors after the images recreation
+        void recreateImagesResources();
+
+    private:
+        std::shared_ptr<GBuffer> gBuffer;
+        std::shared_ptr<DepthBuffer> resolvedDepthBuffer;
+        std::shared_ptr<ColorAttachmentHDR> colorAttachmentHdr;
+        std::shared_ptr<LightClustersRenderer> lightClusters;
+        std::shared_ptr<ShadowAtlas> shadowAtlas;
+        std::vector<VulkanBuffer*> shadowMapsBuffers;
+        std::unique_ptr<VulkanShader> lightingShader;
+        VkSampler sampler{VK_NULL_HANDLE};
+
+        void createDescriptorSetLayout() override;
+        void loadShaders() override;
+        void writeDescriptorSets();
+    };
+
+}
@@ -18,7 +18,8 @@ namespace z0 {
 
         void loadScene(std::shared_ptr<DepthBuffer>& buffer,
                        Camera* camera,
-                       std::vector<MeshInstance*>& meshes);
+                       std::vector<MeshInstance*>& meshes,
+                       const std::shared_ptr<MeshletCullingRenderer>& meshletCulling = nullptr);
 
     private:
         void update(uint32_t currentFrame) override;
@@ -29,7 +30,8 @@ namespace z0 {
         void cleanupImagesResources() override;
         void recreateImagesResources() override;
         void beginRendering(VkCommandBuffer commandBuffer) override;
-        void endRendering(VkCommandBuffer commandBuffer, bool isLast) override;
+        void endRendering(VkCommandBuffer commandBuffer) override;
+        void declareResources(RenderGraphPass& pass, uint32_t currentFrame) override;
 
     };
 
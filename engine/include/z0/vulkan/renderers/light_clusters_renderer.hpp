@@ -0,0 +1,70 @@
+#pragma once
+
+#include "z0/vulkan/renderers/base_renderpass.hpp"
+#include "z0/nodes/camera.hpp"
+
+namespace z0 {
+
+    // Clustered forward lighting : a compute pass assigns the point and spot lights to the clusters of the camera
+    // frustum (screen tiles * exponential depth slices) so the fragment shaders only iterate the lights of their cluster.
+    // https://www.aortiz.me/2018/12/21/CG.html
+    // https://github.com/DaveH355/clustered-shading
+    class LightClustersRenderer: public BaseRenderpass, public VulkanRenderer {
+    public:
+        struct ClustersParamsUniform {
+            glm::mat4 view;
+            glm::mat4 inverseProjection;
+            glm::vec2 screenSize;
+            glm::vec2 tileSize;
+            alignas(4) float near;
+            alignas(4) float far;
+            alignas(4) uint32_t lightsCount;
+        };
+
+        // Must be the same values as clusters.glsl
+        static constexpr uint32_t CLUSTERS_X = 16;
+        static constexpr uint32_t CLUSTERS_Y = 9;
+        static constexpr uint32_t CLUSTERS_Z = 24;
+        static constexpr uint32_t CLUSTER_MAX_LIGHTS = 127;
+        static constexpr uint32_t CLUSTERS_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+        LightClustersRenderer(VulkanDevice& device, const std::string& shaderDirectory);
+
+        // Create the lights buffers for at most maxLights lights of lightSize bytes each
+        void loadScene(uint32_t maxLights, VkDeviceSize lightSize);
+        void cleanup() override;
+
+        // Upload the lights of the frame, in the fragment shaders point light layout
+        void writeLights(uint32_t currentFrame, Camera& camera, const void* lights, uint32_t count);
+        // Screen size of a cluster, in pixels
+        glm::vec2 getTileSize() const;
+
+        VulkanBuffer& getLightsBuffer(uint32_t currentFrame) const { return *lightsBuffers[currentFrame]; }
+        VulkanBuffer& getClustersBuffer(uint32_t currentFrame) const { return *clustersBuffers[currentFrame]; }
+
+    private:
+        uint32_t maxLights{0};
+        VkDeviceSize lightSize{0};
+        std::vector<std::unique_ptr<VulkanBuffer>> lightsBuffers{MAX_FRAMES_IN_FLIGHT};
+        std::vector<std::unique_ptr<VulkanBuffer>> clustersBuffers{MAX_FRAMES_IN_FLIGHT};
+        std::unique_ptr<VulkanShader> clustersShader;
+
+        void update(uint32_t currentFrame) override {};
+        void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) override;
+        void createDescriptorSetLayout() override;
+        void loadShaders() override;
+        void createImagesResources() override {};
+        void cleanupImagesResources() override {};
+        void recreateImagesResources() override {};
+        void beginRendering(VkCommandBuffer commandBuffer) override {};
+        void endRendering(VkCommandBuffer commandBuffer) override {};
+        void declareResources(RenderGraphPass& pass, uint32_t currentFrame) override;
+
+    public:
+        LightClustersRenderer(const LightClustersRenderer&) = delete;
+        LightClustersRenderer &operator=(const LightClustersRenderer&) = delete;
+        LightClustersRenderer(const LightClustersRenderer&&) = delete;
+        LightClustersRenderer &&operator=(const LightClustersRenderer&&) = delete;
+    };
+
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "z0/vulkan/renderers/base_renderpass.hpp"
+#include "z0/vulkan/framebuffers/depth_buffer.hpp"
+#include "z0/vulkan/framebuffers/shadow_map.hpp"
+#include "z0/nodes/mesh_instance.hpp"
+#include "z0/nodes/camera.hpp"
+
+#include <map>
+
+namespace z0 {
+
+    // GPU culling of the meshes meshlets for the camera and the shadow maps views.
+    // A compute pass tests the meshlets against the view frustum, the backface normal cone and, for the camera,
+    // the Hi-Z pyramid built from the depth prepass of the previous frame, then writes the indexed indirect
+    // draws of the visible meshlets, compacted, and their count. The meshes renderers draw theses commands
+    // in place of the surfaces index ranges.
+    // https://vkguide.dev/docs/gpudriven/compute_culling/
+    // https://zeux.io/2023/01/12/approximate-projected-bounds/
+    class MeshletCullingRenderer: public BaseRenderpass, public VulkanRenderer {
+    public:
+        struct ViewUniform {
+            glm::mat4 viewProjection;
+            glm::mat4 hizViewProjection;
+            glm::vec4 frustum[6];
+            glm::vec4 position;
+            glm::vec4 hizSize;
+        };
+        struct MeshletData {
+            glm::vec4 sphere;
+            glm::vec4 coneApex;
+            glm::vec4 coneAxis;
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            int32_t vertexOffset;
+            uint32_t padding;
+        };
+        struct CullingJob {
+            uint32_t firstMeshlet;
+            uint32_t meshletCount;
+            uint32_t firstCommand;
+            uint32_t model;
+            uint32_t view;
+            uint32_t coneCulling;
+            // index of the visible meshlets count in the draw counts buffer
+            uint32_t drawCount;
+            uint32_t padding;
+        };
+
+        // View of the camera, the shadow maps cascades views follows in the shadow maps order
+        static constexpr uint32_t CAMERA_VIEW = 0;
+        static constexpr uint32_t HIZ_MAX_LEVELS = 16;
+
+        MeshletCullingRenderer(VulkanDevice& device, const std::string& shaderDirectory);
+
+        void loadScene(Camera* camera,
+                       std::shared_ptr<DepthBuffer>& depthBuffer,
+                       std::vector<std::shared_ptr<ShadowMap>>& shadowMaps,
+                       std::vector<MeshInstance*>& meshes);
+        void cleanup() override;
+
+        // Draw the visible meshlets of a mesh instance surface for a view, with the mesh of the frame snapshot.
+        // Returns false if the mesh have no meshlets and must be drawn by the caller.
+        bool drawSurface(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t view,
+                         Node::id_t meshInstanceId, Mesh& mesh, uint32_t surfaceIndex);
+        // Build the Hi-Z pyramid from the depth prepass buffer, used by the culling of the next frame.
+        // Must be recorded after the depth prepass, outside of the rendering, by the renderer of the pass
+        // which declared the build.
+        void buildHiZ(VkCommandBuffer commandBuffer, const VulkanRenderer& renderer);
+        // Render graph declarations of the passes drawing the culled meshlets
+        void readCommands(RenderGraphPass& pass, uint32_t currentFrame) const;
+        // Render graph declaration of the Hi-Z pyramid build, one phase per level after the accesses of the pass
+        void declareHiZBuild(RenderGraphPass& pass);
+
+    private:
+        Camera* currentCamera{nullptr};
+        std::vector<MeshInstance*> meshes{};
+        std::vector<std::shared_ptr<ShadowMap>> shadowMaps{};
+        std::shared_ptr<DepthBuffer> depthBuffer;
+        std::map<Node::id_t, uint32_t> modelIndices{};
+        std::map<Resource::rid_t, uint32_t> meshletsOffsets{};
+        uint32_t viewsCount{0};
+        uint32_t surfacesCount{0};
+        uint32_t commandsCount{0};
+        // Index of the first surface of each mesh instance
+        std::vector<uint32_t> modelsFirstSurface{};
+        // First command and maximum meshlets count of each surface, for each view
+        std::vector<uint32_t> surfacesFirstCommand{};
+        std::vector<uint32_t> surfacesDrawCount{};
+        std::vector<CullingJob> jobs{};
+        uint32_t recordingFrame{0};
+
+        std::unique_ptr<VulkanBuffer> meshletsBuffer;
+        std::vector<std::unique_ptr<VulkanBuffer>> viewsBuffers{MAX_FRAMES_IN_FLIGHT};
+        std::vector<std::unique_ptr<VulkanBuffer>> modelsBuffers{MAX_FRAMES_IN_FLIGHT};
+        std::vector<std::unique_ptr<VulkanBuffer>> jobsBuffers{MAX_FRAMES_IN_FLIGHT};
+        std::vector<std::unique_ptr<VulkanBuffer>> commandsBuffers{MAX_FRAMES_IN_FLIGHT};
+        // Visible meshlets count of each surface, for each view
+        std::vector<std::unique_ptr<VulkanBuffer>> drawCountsBuffers{MAX_FRAMES_IN_FLIGHT};
+        std::vector<std::unique_ptr<VulkanBuffer>> hizLevelsBuffers{MAX_FRAMES_IN_FLIGHT};
+        std::unique_ptr<VulkanShader> cullingShader;
+        std::unique_ptr<VulkanShader> hizShader;
+
+        // Hi-Z pyramid of the farthest depths
+        bool occlusionCulling{false};
+        bool hizBuilt{false};
+        bool hizDirty{false};
+        // Render graph phase of the first level of this frame, 0 if the build is not declared
+        uint32_t hizPhase{0};
+        uint32_t hizWidth{0};
+        uint32_t hizHeight{0};
+        uint32_t hizLevels{0};
+        VkImage hizImage{VK_NULL_HANDLE};
+        VmaAllocation hizImageAllocation{VK_NULL_HANDLE};
+        VkImageView hizImageView{VK_NULL_HANDLE};
+        std::vector<VkImageView> hizLevelsViews{};
+        VkSampler hizSampler{VK_NULL_HANDLE};
+        glm::mat4 lastViewProjection{1.0f};
+
+        void update(uint32_t currentFrame) override;
+        void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) override;
+        void createDescriptorSetLayout() override;
+        void loadShaders() override;
+        void createImagesResources() override;
+        void cleanupImagesResources() override;
+        void recreateImagesResources() override;
+        void beginRendering(VkCommandBuffer commandBuffer) override;
+        void endRendering(VkCommandBuffer commandBuffer) override;
+        void declareResources(RenderGraphPass& pass, uint32_t currentFrame) override;
+
+        void writeDescriptorSets();
+        static ViewUniform makeView(const glm::mat4& viewProjection);
+
+    public:
+        MeshletCullingRenderer(const MeshletCullingRenderer&) = delete;
+        MeshletCullingRenderer &operator=(const MeshletCullingRenderer&) = delete;
+        MeshletCullingRenderer(const MeshletCullingRenderer&&) = delete;
+        MeshletCullingRenderer &&operator=(const MeshletCullingRenderer&&) = delete;
+    };
+
+}
@@ -3,14 +3,23 @@
 #include "z0/vulkan/renderers/shadowmap_renderer.hpp"
 #include "z0/vulkan/renderers/depth_prepass_renderer.hpp"
 #include "z0/vulkan/renderers/skybox_renderer.hpp"
+#include "z0/vulkan/renderers/light_clusters_renderer.hpp"
+#include "z0/vulkan/renderers/deferred_lighting_renderer.hpp"
+#include "z0/vulkan/framebuffers/gbuffer.hpp"
 #include "z0/vulkan/framebuffers/color_attachment.hpp"
 #include "z0/vulkan/framebuffers/color_attachment_hdr.hpp"
 #include "z0/nodes/camera.hpp"
 #include "z0/nodes/directional_light.hpp"
 #include "z0/nodes/environment.hpp"
 #include "z0/nodes/omni_light.hpp"
+#include "z0/utils/light_culling.hpp"
+#include "z0/vulkan/vulkan_texture_table.hpp"
+#include "z0/vulkan/vulkan_texture_streamer.hpp"
 
+#include <functional>
 #include <map>
+#include <mutex>
+#include <span>
 
 namespace z0 {
 
@@ -32,10 +41,15 @@ namespace z0 {
             alignas(16) glm::vec3 direction = glm::normalize(glm::vec3{0.f, .0f, .0f});
             alignas(4) float cutOff = { glm::cos(glm::radians(10.f)) };
             alignas(4) float outerCutOff = { glm::cos(glm::radians(15.f)) };
+            alignas(4) float range{0.0f};
         };
         struct ShadowMapUniform {
-            glm::mat4 lightSpace;
+            glm::mat4 lightSpace[ShadowMap::MAX_CASCADES];
+            // Offset (xy) and scale (zw) of the cascades tiles in the shadow atlas
+            glm::vec4 tiles[ShadowMap::MAX_CASCADES];
+            glm::vec4 cascadeSplits;
             alignas(16) glm::vec3 lightPos;
+            alignas(4) uint32_t cascadesCount;
         };
         struct GobalUniformBufferObject {
             glm::mat4 projection{1.0f};
@@ -46,6 +60,9 @@ namespace z0 {
             alignas(4) bool haveDirectionalLight{false};
             alignas(4) uint32_t pointLightsCount{0};
             alignas(4) uint32_t shadowMapsCount{0};
+            alignas(4) float clustersNear;
+            alignas(4) float clustersFar;
+            alignas(8) glm::vec2 clustersTileSize;
         };
         struct ModelUniformBufferObject {
             glm::mat4 matrix;
@@ -60,6 +77,20 @@ namespace z0 {
             alignas(4) float shininess{32.0f};
         };
 
+        // Fragment shaders permutations bits, used as specialization constants.
+        // Must be in the same order as permutations.glsl
+        enum Permutation : uint32_t {
+            PERMUTATION_DIFFUSE_TEXTURE     = 1 << 0,
+            PERMUTATION_NORMAL_TEXTURE      = 1 << 1,
+            PERMUTATION_SPECULAR_TEXTURE    = 1 << 2,
+            PERMUTATION_ALPHA_SCISSOR       = 1 << 3,
+            PERMUTATION_ALPHA_BLENDING      = 1 << 4,
+            PERMUTATION_DIRECTIONAL_LIGHT   = 1 << 5,
+            PERMUTATION_POINT_LIGHTS        = 1 << 6,
+            PERMUTATION_SHADOWS             = 1 << 7,
+        };
+        static constexpr uint32_t PERMUTATIONS_COUNT = 8;
+
         SceneRenderer(VulkanDevice& device, std::string shaderDirectory);
 
         std::shared_ptr<ColorAttachmentHDR>& getColorAttachment() { return colorAttachmentHdr; }
@@ -78,24 +109,61 @@ namespace z0 {
         std::vector<MeshInstance*> opaquesMeshes {};
         std::vector<MeshInstance*> transparentsMeshes {};
         std::vector<OmniLight*> omniLights;
-        std::vector<std::unique_ptr<VulkanBuffer>> pointLightBuffers{MAX_FRAMES_IN_FLIGHT};
+        // Only the visible lights are uploaded
+        LightCuller lightCuller;
+        std::vector<PointLightUniform> pointLightsArray;
+        // Clustered lighting, owns the point lights buffers
+        std::shared_ptr<LightClustersRenderer> lightClusters;
+        // Bindless textures, indexed by the surfaces
+        static constexpr uint32_t TEXTURES_BINDING = 8;
+        VulkanTextureTable textureTable;
+        // Finer mip levels of the streamed textures, requested by the visible meshes
+        VulkanTextureStreamer textureStreamer;
         std::map<Resource::rid_t, int32_t> imagesIndices {};
-        std::unordered_set<std::shared_ptr<VulkanImage>> images {};
-        std::map<Resource::rid_t, uint32_t> surfacesIndices {};
         std::vector<std::unique_ptr<VulkanBuffer>> surfacesBuffers{MAX_FRAMES_IN_FLIGHT};
 
-        // Offscreen frame buffers
-        ColorAttachment colorAttachmentMultisampled;
+        // Offscreen frame buffers. The multisampled attachment is only used by the forward renderer.
+        // Memory aliasing : the resolved G-buffer albedo in deferred mode, or the multisampled color attachment in
+        // forward mode, no longer used after the scene pass, shares its memory with the first postprocessing output
+        // and the HDR color attachment with the second one. The transient attachments of the tile based GPUs
+        // are lazily allocated instead
+        static constexpr uint32_t SCENE_ALIASING_SLOT = 0;
+        static constexpr uint32_t COLOR_ALIASING_SLOT = 1;
+        std::unique_ptr<ColorAttachment> colorAttachmentMultisampled;
         std::shared_ptr<ColorAttachmentHDR> colorAttachmentHdr;
-        // Depth prepass buffer
+        // Depth prepass buffer, without depth prepass for a transient multisampled depth buffer
         std::shared_ptr<DepthPrepassRenderer> depthPrepassRenderer;
         std::shared_ptr<DepthBuffer> resolvedDepthBuffer;
-        // Shadow mapping
+        // Shadow mapping, all the shadow maps are rendered in the tiles of a single atlas
         std::vector<std::shared_ptr<ShadowMap>> shadowMaps;
-        std::vector<std::shared_ptr<ShadowMapRenderer>> shadowMapRenderers;
+        std::shared_ptr<ShadowAtlas> shadowAtlas;
+        std::shared_ptr<ShadowMapRenderer> shadowMapRenderer;
         std::vector<std::unique_ptr<VulkanBuffer>> shadowMapsBuffers{MAX_FRAMES_IN_FLIGHT};
         // Skybox
         std::unique_ptr<SkyboxRenderer> skyboxRenderer {nullptr};
+        // Deferred shading : opaques meshes in the G-buffer, lighted in compute
+        bool deferred{false};
+        std::shared_ptr<GBuffer> gBuffer;
+        std::unique_ptr<DeferredLightingRenderer> deferredLightingRenderer {nullptr};
+        // Render graph phases of the lighting & forward passes after the G-buffer pass
+        static constexpr uint32_t LIGHTING_PHASE = 1;
+        static constexpr uint32_t FORWARD_PHASE = 2;
+        // Fragment shaders permutations, built on demand for the surfaces materials
+        uint32_t lightingPermutation{0};
+        std::map<uint32_t, std::unique_ptr<VulkanShader>> forwardShaders;
+        std::map<uint32_t, std::unique_ptr<VulkanShader>> gBufferShaders;
+        // The permutations are looked up by the recording threads
+        std::mutex shadersMutex;
+
+        // The draws of a rendering are recorded in parallel in secondary command buffers of this number of meshes
+        static constexpr uint32_t MESHES_PER_COMMAND_BUFFER = 64;
+        // Meshes drawn with the same states
+        struct DrawList {
+            const std::vector<MeshInstance*>& meshes;
+            bool toGBuffer;
+            // Set in each command buffer of the list, after the initial states
+            std::function<void(VkCommandBuffer)> setStates;
+        };
 
         void update(uint32_t currentFrame) override;
         void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) override;
@@ -105,12 +173,27 @@ namespace z0 {
         void cleanupImagesResources() override;
         void recreateImagesResources() override;
         void beginRendering(VkCommandBuffer commandBuffer) override;
-        void endRendering(VkCommandBuffer commandBuffer, bool isLast) override;
+        void endRendering(VkCommandBuffer commandBuffer) override;
+        void declareResources(RenderGraphPass& pass, uint32_t currentFrame) override;
 
         void loadNode(std::shared_ptr<Node>& parent);
-        void createImagesList(std::shared_ptr<Node>& node);
         void createImagesIndex(std::shared_ptr<Node>& node);
-        void drawMeshes(VkCommandBuffer commandBuffer, uint32_t currentFrame, const std::vector<MeshInstance*>& meshesToDraw);
+        void addImage(Image& image);
+        void requestTexturesLevels();
+        void drawMeshes(VkCommandBuffer commandBuffer, uint32_t currentFrame, std::span<MeshInstance* const> meshesToDraw,
+                        bool toGBuffer = false);
+        // Record the draw lists, then the skybox with the states of the last list, in secondary command buffers
+        // executed in order by the rendering. The rendering must be begun for secondary command buffers contents
+        void recordDrawLists(VkCommandBuffer commandBuffer, uint32_t currentFrame,
+                             const VkCommandBufferInheritanceRenderingInfo& renderingInfo,
+                             const std::vector<DrawList>& drawLists, bool drawSkybox);
+        // Depth states of the opaques surfaces, tested against the depth prepass if any
+        void setOpaquesDepthStates(VkCommandBuffer commandBuffer) const;
+        uint32_t getPermutation(const Material* material, bool toGBuffer) const;
+        VulkanShader& getShaderPermutation(uint32_t permutation, bool toGBuffer);
+        std::unique_ptr<VulkanShader> createShaderPermutation(uint32_t permutation, bool toGBuffer);
+        void beginGBufferRendering(VkCommandBuffer commandBuffer);
+        void recordDeferredCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame);
 
     public:
         SceneRenderer(const SceneRenderer&) = delete;
@@ -1,11 +1,20 @@
 #pragma once
 
 #include "base_renderpass.hpp"
+#include "z0/vulkan/renderers/meshlet_culling_renderer.hpp"
+#include "z0/vulkan/framebuffers/shadow_atlas.hpp"
 #include "z0/vulkan/framebuffers/shadow_map.hpp"
 #include "z0/nodes/mesh_instance.hpp"
+#include "z0/nodes/camera.hpp"
+#include "z0/utils/frustum.hpp"
 
 namespace z0 {
 
+    // Render the shadow casters of all the shadow maps in the tiles of the shadow atlas, in a single pass
+    // with one viewport per tile. The tiles sizes of the spot lights are chosen each frame from their screen coverage.
+    // The static casters are rendered in a cached atlas, only when the light space or the tile of a cascade or
+    // a static caster changes. Each frame the cached tiles are copied in the atlas and the dynamic casters are drawn
+    // on top, nothing is recorded when neither the static casters nor the dynamic casters changed.
     class ShadowMapRenderer: public BaseRenderpass, public VulkanRenderer {
     public:
         struct GlobalUniformBufferObject {
@@ -14,10 +23,40 @@ namespace z0 {
         struct ModelUniformBufferObject {
             glm::mat4 matrix;
         };
+        // Last state of a mesh instance. A caster is dynamic when its transform or mesh changed recently.
+        // Also the snapshot of the mesh instance drawn by the render thread
+        struct CasterState {
+            glm::mat4 transform;
+            std::shared_ptr<Mesh> mesh;
+            uint32_t lod;
+            // Faces culling of the surfaces, the materials can be changed during the recording
+            std::vector<VkCullModeFlags> cullModes;
+            uint32_t unchangedFrames;
+            bool dynamic;
+        };
+        // A cascade of a shadow map
+        struct ViewState {
+            ShadowMap* shadowMap;
+            uint32_t cascade;
+            // Light space and tile used by the static layer
+            glm::mat4 lightSpace{1.0f};
+            ShadowAtlas::Tile tile{};
+            bool staticValid{false};
+            // Dynamic casters drawn on top of the static layer in the atlas
+            bool dynamicDrawn{false};
+            // Work of the current frame
+            bool renderStatic{false};
+            bool renderDynamic{false};
+            bool update{false};
+        };
+        // Number of frames without changes before a dynamic caster goes back in the static layer
+        static constexpr uint32_t STATIC_CASTER_FRAMES = 120;
 
         ShadowMapRenderer(VulkanDevice& device, const std::string& shaderDirectory);
 
-        void loadScene(std::shared_ptr<ShadowMap>& shadowMap, std::vector<MeshInstance*>& meshes);
+        void loadScene(std::shared_ptr<ShadowAtlas>& shadowAtlas, std::vector<std::shared_ptr<ShadowMap>>& shadowMaps,
+                       Camera* camera, std::vector<MeshInstance*>& meshes,
+                       const std::shared_ptr<MeshletCullingRenderer>& meshletCulling = nullptr, uint32_t cullingView = 0);
         void cleanup() override;
 
         // Depth bias (and slope) are used to avoid shadowing artifacts
@@ -26,9 +65,28 @@ namespace z0 {
         // Slope depth bias factor, applied depending on polygon's slope
         const float depthBiasSlope = 1.75f;
 
+        Camera* currentCamera {nullptr};
         std::vector<MeshInstance*> meshes {};
-        std::shared_ptr<ShadowMap> shadowMap;
+        std::shared_ptr<ShadowAtlas> shadowAtlas;
+        std::vector<std::shared_ptr<ShadowMap>> shadowMaps;
+        // GPU meshlets culling and the culling view of the first cascade of the first shadow map
+        std::shared_ptr<MeshletCullingRenderer> meshletCulling;
+        uint32_t cullingView{0};
         std::vector<std::unique_ptr<VulkanBuffer>> modelsBuffers{MAX_FRAMES_IN_FLIGHT};
+        std::vector<CasterState> casters{};
+        std::vector<ViewState> views{};
+        std::vector<Frustum> viewsFrustums{};
+        std::vector<ShadowAtlas::Tile> tiles{};
+        // Tiles sizes requested by the last packing, before the over budget reductions
+        std::vector<uint32_t> requestedSizes{};
+        // Work of the frame, the atlas is cleared at least once after the scene loading
+        bool atlasRendered{false};
+        bool renderStaticLayer{false};
+        bool copyStaticTiles{false};
+        bool renderAtlas{false};
+        // Render graph phases of the copy of the static tiles and of the atlas rendering
+        static constexpr uint32_t COPY_PHASE = 1;
+        static constexpr uint32_t ATLAS_PHASE = 2;
 
         void update(uint32_t currentFrame) override;
         void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) override;
@@ -37,8 +95,17 @@ namespace z0 {
         void createImagesResources() override;
         void cleanupImagesResources() override;
         void recreateImagesResources() override;
-        void beginRendering(VkCommandBuffer commandBufferw) override;
-        void endRendering(VkCommandBuffer commandBuffer, bool isLast) override;
+        void beginRendering(VkCommandBuffer commandBuffer) override;
+        void endRendering(VkCommandBuffer commandBuffer) override;
+        void declareResources(RenderGraphPass& pass, uint32_t currentFrame) override;
+        void beginAtlasRendering(VkCommandBuffer commandBuffer, VkImageView imageView, VkAttachmentLoadOp loadOp);
+        // Draw the static or the dynamic casters of a cascade in its tile
+        void drawView(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t view, bool dynamic);
+        bool isInView(const CasterState& caster, uint32_t view) const;
+        // Choose the tiles sizes and pack them in the atlas, only when a size changes.
+        // Called before the shadow maps tiles are read for the frame uniforms.
+        void allocateTiles();
+        uint32_t getSpotTileSize(const ShadowMap& shadowMap);
 
     public:
         ShadowMapRenderer(const ShadowMapRenderer&) = delete;
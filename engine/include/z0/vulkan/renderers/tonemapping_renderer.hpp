@@ -23,6 +23,7 @@ namespace z0 {
         void loadShaders() override;
         void createDescriptorSetLayout() override;
         void recreateImagesResources();
+        void declareResources(RenderGraphPass& pass, uint32_t currentFrame) override;
 
     private:
         std::shared_ptr<DepthBuffer> resolvedDepthBuffer;
@@ -18,6 +18,7 @@ namespace z0 {
 
         VkBuffer getBuffer() const { return buffer; }
         VkDeviceSize getAlignmentSize() const { return alignmentSize; }
+        VkDeviceSize getBufferSize() const { return bufferSize; }
         VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const;
 
         VkResult map();
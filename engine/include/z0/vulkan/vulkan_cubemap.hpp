@@ -23,7 +23,7 @@ namespace z0 {
 
         VulkanDevice& vulkanDevice;
         VkImage textureImage;
-        VkDeviceMemory textureImageMemory;
+        VmaAllocation textureImageAllocation;
         VkImageView textureImageView;
         VkSampler textureSampler;
 
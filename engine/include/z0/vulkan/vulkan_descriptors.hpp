@@ -18,16 +18,20 @@ namespace z0 {
                     uint32_t binding,
                     VkDescriptorType descriptorType,
                     VkShaderStageFlags stageFlags,
-                    uint32_t count = 1);
+                    uint32_t count = 1,
+                    VkDescriptorBindingFlags bindingFlags = 0);
             std::unique_ptr<VulkanDescriptorSetLayout> build() const;
 
         private:
             VulkanDevice &vulkanDevice;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingsFlags{};
         };
 
         VulkanDescriptorSetLayout(
-                VulkanDevice &VulkanDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+                VulkanDevice &VulkanDevice,
+                std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+                const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingsFlags = {});
         ~VulkanDescriptorSetLayout();
         VulkanDescriptorSetLayout(const VulkanDescriptorSetLayout &) = delete;
         VulkanDescriptorSetLayout &operator=(const VulkanDescriptorSetLayout &) = delete;
@@ -69,7 +73,9 @@ namespace z0 {
         VulkanDescriptorPool(const VulkanDescriptorPool &) = delete;
         VulkanDescriptorPool &operator=(const VulkanDescriptorPool &) = delete;
 
-        bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor) const;
+        // variableDescriptorCount is the size of the VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT binding, if any
+        bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor,
+                                uint32_t variableDescriptorCount = 0) const;
         void freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const;
         void resetPool();
         VkDescriptorPool getPool() const { return descriptorPool; }
@@ -87,8 +93,11 @@ namespace z0 {
 
         VulkanDescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
         VulkanDescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
+        // Write some elements of an array binding
+        VulkanDescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo,
+                                           uint32_t arrayElement, uint32_t count);
 
-        bool build(VkDescriptorSet &set);
+        bool build(VkDescriptorSet &set, uint32_t variableDescriptorCount = 0);
         void overwrite(VkDescriptorSet &set);
 
     private:
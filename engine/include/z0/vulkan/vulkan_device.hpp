@@ -3,11 +3,19 @@
 #include "z0/vulkan/vulkan_instance.hpp"
 #include "z0/helpers/window_helper.hpp"
 #include "z0/vulkan/vulkan_renderer.hpp"
+#include "z0/vulkan/vulkan_shader_cache.hpp"
+#include "z0/vulkan/vulkan_stats.hpp"
+#include "z0/vulkan/vulkan_residency.hpp"
+#include "z0/vulkan/vulkan_render_graph.hpp"
 #include "z0/ui/debug_ui.hpp"
 
 #include "vk_mem_alloc.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 
@@ -33,7 +41,8 @@ namespace z0 {
 
     class VulkanDevice {
     public:
-        VulkanDevice(VulkanInstance& instance, WindowHelper &window, bool autoMSAA = false, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+        VulkanDevice(VulkanInstance& instance, WindowHelper &window, bool autoMSAA = false, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT,
+                     const std::filesystem::path& shaderCacheDirectory = {});
         ~VulkanDevice();
 
         inline VkDevice getDevice() { return device; }
@@ -44,34 +53,78 @@ namespace z0 {
         inline VkFormat getSwapChainImageFormat() const { return swapChainImageFormat; }
 
         VkPhysicalDeviceProperties getDeviceProperties() const { return deviceProperties; }
+        // Enabled device features
+        const VkPhysicalDeviceFeatures& getDeviceFeatures() const { return deviceFeatures; }
+        // VK_KHR_draw_indirect_count enabled, required by the meshlets culling
+        bool isDrawIndirectCountSupported() const { return drawIndirectCountSupported; }
+        // Memory type backed by the on-chip tile memory, for the transient attachments of the tile based GPUs
+        bool isLazilyAllocatedSupported() const { return lazilyAllocatedSupported; }
         VkSurfaceKHR getSurface() const { return surface; };
         VkQueue getGraphicsQueue() const { return graphicsQueue; }
         VulkanInstance& getInstance() const { return vulkanInstance; }
         float getAspectRatio() const {return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);}
         DebugUI& getDebugUI() const { return *debugUI; }
-
-        void drawFrame();
+        VulkanShaderCache& getShaderCache() const { return *shaderCache; }
+        VulkanResidency& getResidency() const { return *residency; }
+
+        // A frame is drawn in two steps, on two threads when the rendering is pipelined.
+        // prepareFrame() runs on the main thread when no frame is recorded : it acquires the swap chain image and
+        // takes the snapshot of the scene, the renderers update(). Returns false if the frame must be skipped.
+        // The input time is the sampling time of the input events used for the snapshot.
+        bool prepareFrame(std::chrono::steady_clock::time_point inputTime);
+        // Record, submit & present the prepared frame, without reading the nodes
+        void renderFrame();
+        // Time between the input events sampling and the presentation of the last frame, in milliseconds
+        float getFrameLatency() const { return frameLatency.load(std::memory_order_relaxed); }
         void wait();
+        // Renderers passes are ordered by the render graph, the registration order is kept between independent passes
         void registerRenderer(const std::shared_ptr<VulkanRenderer>& renderer);
+        // The image of this renderer is copied to the swap chain
+        void setOutputRenderer(const std::shared_ptr<VulkanRenderer>& renderer) { outputRenderer = renderer; }
+
+        // Secondary command buffer of the recorded frame, executed inside a rendering with the given formats.
+        // Thread safe, used by the renderers recording their draws in parallel
+        VkCommandBuffer beginFrameSecondaryCommandBuffer(const VkCommandBufferInheritanceRenderingInfo& renderingInfo);
+        // Default dynamic states of the shader objects, the secondary command buffers do not inherit them
+        void setInitialState(VkCommandBuffer commandBuffer);
 
         VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+        // Submit single time commands without waiting for the queue. Returns the fence signaled when the
+        // commands are completed, the command buffer & the fence are then freed with releaseSingleTimeCommands()
+        VkFence submitSingleTimeCommands(VkCommandBuffer commandBuffer);
+        void releaseSingleTimeCommands(VkCommandBuffer commandBuffer, VkFence fence);
 
+        // Device local image suballocated by VMA, the large render targets get a dedicated allocation
         void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples,
                          VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                         VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory,
+                         MemoryCategory category, VkImage& image, VmaAllocation& allocation,
                          VkImageCreateFlags flags = 0, uint32_t layers = 1);
+        void destroyImage(VkImage image, VmaAllocation allocation);
+        // Attachments memory aliasing : images bound to the memory of a slot instead of their own allocation.
+        // The images of a slot must not be used at the same time in a frame. The memory of a slot is sized for
+        // a resolved full screen RGBA16F attachment, or for the first image of the slot if larger, and reallocated
+        // when the swap chain is resized.
+        // Returns false if the image does not fit in the slot. The image is destroyed with destroyAliasedImage()
+        static constexpr uint32_t ALIASING_SLOTS = 2;
+        bool createAliasedImage(uint32_t slot, uint32_t width, uint32_t height, VkSampleCountFlagBits samples,
+                                VkFormat format, VkImageUsageFlags usage, VkImage& image);
+        void destroyAliasedImage(VkImage image);
         VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
-                                    uint32_t mipLevels = 1, VkImageViewType type = VK_IMAGE_VIEW_TYPE_2D);
+                                    uint32_t mipLevels = 1, VkImageViewType type = VK_IMAGE_VIEW_TYPE_2D,
+                                    uint32_t baseArrayLayer = 0, uint32_t layers = 1);
 
         void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image,
                                    VkImageLayout oldLayout, VkImageLayout newLayout,
                                    VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
                                    VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
                                    VkImageAspectFlags aspectMask, uint32_t mipLevels = 1);
+        // Barriers of a phase declared by a renderer in its render graph pass, recorded between its commands
+        void beginPassPhase(VkCommandBuffer commandBuffer, const VulkanRenderer& renderer, uint32_t phase) const {
+            renderGraph.beginPhase(commandBuffer, renderer, phase);
+        }
 
         static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice vkPhysicalDevice, VkSurfaceKHR surface);
-        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
         // Returns if a given format support LINEAR filtering
         VkBool32 formatIsFilterable(VkFormat format, VkImageTiling tiling);
         // Find a suitable IMAGE_TILING format (for the Depth buffering image)
@@ -80,7 +133,11 @@ namespace z0 {
     private:
         VulkanInstance& vulkanInstance;
         std::vector<std::shared_ptr<VulkanRenderer>> renderers;
+        std::shared_ptr<VulkanRenderer> outputRenderer;
+        VulkanRenderGraph renderGraph;
         std::unique_ptr<DebugUI> debugUI;
+        std::unique_ptr<VulkanShaderCache> shaderCache;
+        std::unique_ptr<VulkanResidency> residency;
 
         // Physical & logical device management
         WindowHelper &window;
@@ -89,22 +146,61 @@ namespace z0 {
         VkSurfaceKHR surface;
         VkQueue graphicsQueue;
         VkQueue presentQueue;
+        // Resolved by createDevice(), used for the command pools
+        uint32_t graphicsQueueFamily;
         VkCommandPool commandPool;
         VkPhysicalDeviceProperties deviceProperties;
+        VkPhysicalDeviceFeatures deviceFeatures;
         void createDevice();
 
         // Vulkan Memory Allocator
+        // Render targets of at least this size get their own memory block
+        static constexpr VkDeviceSize DEDICATED_ALLOCATION_MIN_SIZE = 8 * 1024 * 1024;
         VmaAllocator allocator;
+        bool memoryBudgetSupported{false};
+        bool drawIndirectCountSupported{false};
+        // Memory type only backed by the on-chip tile memory, for the transient attachments
+        bool lazilyAllocatedSupported{false};
+        uint32_t frameIndex{0};
         void createAllocator();
+        VkMemoryRequirements getImageMemoryRequirements(const VkImageCreateInfo& imageInfo) const;
+
+        // Attachments aliasing
+        struct AliasingSlot {
+            VmaAllocation allocation{VK_NULL_HANDLE};
+            VkExtent2D extent{0, 0};
+        };
+        std::array<AliasingSlot, ALIASING_SLOTS> aliasingSlots;
+        void releaseAliasingSlot(AliasingSlot& slot);
 
         // Drawing a frame
         uint32_t currentFrame = 0;
-        std::vector<VkCommandBuffer> commandBuffers;
+        // Swap chain image of the prepared frame
+        uint32_t imageIndex{0};
+        // Set by the render thread, the swap chain is recreated by the next prepareFrame() (GLFW)
+        bool swapChainOutdated{false};
+        std::chrono::steady_clock::time_point frameInputTime;
+        std::atomic<float> frameLatency{0.0f};
+        // The single time commands may be submitted by the main thread while a frame is submitted
+        std::mutex queueMutex;
+        // Command buffer with its own pool, the pool is reset once per frame
+        struct FrameCommandBuffer {
+            VkCommandPool commandPool{VK_NULL_HANDLE};
+            VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+        };
+        // One command buffer per render graph pass, recorded in parallel, plus the last one for the copy
+        // to the swap chain & the UI. A pool is only used by one recording thread at a time.
+        std::vector<std::vector<FrameCommandBuffer>> frameCommandBuffers{MAX_FRAMES_IN_FLIGHT};
+        // Secondary command buffers taken by the passes during the recording of the frame
+        std::vector<std::vector<FrameCommandBuffer>> frameSecondaryCommandBuffers{MAX_FRAMES_IN_FLIGHT};
+        uint32_t frameSecondaryCommandBuffersCount{0};
+        std::mutex frameSecondaryCommandBuffersMutex;
+        FrameCommandBuffer createFrameCommandBuffer(VkCommandBufferLevel level);
+        VkCommandBuffer beginFrameCommandBuffer(uint32_t index);
         std::vector<VkSemaphore> imageAvailableSemaphores;
         std::vector<VkSemaphore> renderFinishedSemaphores;
         std::vector<VkFence> inFlightFences;
         VkImageBlit colorImageBlit{};
-        void setInitialState(VkCommandBuffer commandBuffer);
 
         // Swap chain management
         VkSwapchainKHR swapChain;
@@ -4,6 +4,22 @@
 
 namespace z0 {
 
+    class VulkanBuffer;
+
+    // Full resolution pixels of a streamed image, kept in memory to upload the finer mip levels on demand
+    struct VulkanImageSource {
+        uint32_t width;
+        uint32_t height;
+        VkFormat format;
+        std::vector<unsigned char> pixels;
+
+        uint32_t getMipLevels() const;
+        // RGBA pixels of a mip level, box filtered from the full resolution pixels
+        std::vector<unsigned char> getLevel(uint32_t level, uint32_t& levelWidth, uint32_t& levelHeight) const;
+        // Video memory used by the mip chain starting at a level
+        VkDeviceSize getMipChainSize(uint32_t level) const;
+    };
+
     class VulkanImage {
     public:
         VulkanImage(VulkanDevice& device,
@@ -12,29 +28,59 @@ namespace z0 {
                     VkDeviceSize imageSize,
                     void* data,
                     VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+        // Upload & mip levels generation recorded in a command buffer submitted by the caller.
+        // The staging buffer is kept until releaseStagingBuffer(), once the commands are completed
+        VulkanImage(VulkanDevice& device,
+                    VkCommandBuffer commandBuffer,
+                    uint32_t width,
+                    uint32_t height,
+                    VkDeviceSize imageSize,
+                    void* data,
+                    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
         ~VulkanImage();
 
+        void releaseStagingBuffer();
+
         VkDescriptorImageInfo imageInfo();
 
-        static std::shared_ptr<VulkanImage> createFromFile(VulkanDevice &device, const std::string &filepath);
+        // Maximum size of the mip tail of the streamed images, always resident
+        static constexpr uint32_t STREAMING_TAIL_SIZE = 128;
+
+        // Create an image with only the mip tail resident, the full resolution pixels are kept for the streaming
+        static std::shared_ptr<VulkanImage> createStreamed(VulkanDevice& device,
+                                                           uint32_t width,
+                                                           uint32_t height,
+                                                           const void* data,
+                                                           VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+        static std::shared_ptr<VulkanImage> createFromFile(VulkanDevice &device, const std::string &filepath, bool streamed = false);
         //static void saveToFile(VkCommandBuffer commandBuffer, VulkanDevice &device, VkImage image, VkFormat format, int width, int height, const std::string &filepath);
         //static VkDeviceSize calculateImageSize(VkFormat format, int width, int height);
 
-        uint32_t getWidth() const { return width; }
-        uint32_t getHeight() const { return height; }
+        // Full resolution size, even when streamed
+        uint32_t getWidth() const { return source != nullptr ? source->width : width; }
+        uint32_t getHeight() const { return source != nullptr ? source->height : height; }
+        // Pixels of a streamed image, nullptr if all the mip levels are resident
+        const std::shared_ptr<const VulkanImageSource>& getSource() const { return source; }
+        // Mip level of the source uploaded as the first level of this image
+        uint32_t getBaseLevel() const { return baseLevel; }
 
     private:
         uint32_t width, height;
+        std::shared_ptr<const VulkanImageSource> source{nullptr};
+        uint32_t baseLevel{0};
 
         VulkanDevice& vulkanDevice;
         uint32_t mipLevels;
         VkImage textureImage;
-        VkDeviceMemory textureImageMemory;
+        VmaAllocation textureImageAllocation;
         VkImageView textureImageView;
         VkSampler textureSampler;
+        std::unique_ptr<VulkanBuffer> stagingBuffer;
 
         void createTextureSampler();
-        void generateMipmaps(VkFormat imageFormat);
+        // Record the copy of the staging buffer in the first level and the generation of the other levels
+        void recordUpload(VkCommandBuffer commandBuffer, VkDeviceSize imageSize, void* data, VkFormat format);
+        void generateMipmaps(VkCommandBuffer commandBuffer, VkFormat imageFormat);
     };
 
 }
\ No newline at end of file
@@ -9,14 +9,38 @@
 
 namespace z0 {
 
+    // Vertices count addressable with VK_INDEX_TYPE_UINT16
+    const uint32_t MAX_16BIT_VERTICES = 65536;
+
     class VulkanModel {
     public:
-        VulkanModel(VulkanDevice &device, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+        // Part of the index buffer addressing at most 65536 vertices starting from vertexOffset
+        struct IndexChunk {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            int32_t vertexOffset;
+        };
+
+        // The index buffer is only split in chunks at the optional sorted cut indices
+        VulkanModel(VulkanDevice &device,
+                    const std::vector<Vertex> &vertices,
+                    const std::vector<uint32_t> &indices,
+                    const std::vector<uint32_t> &cutIndices = {});
 
         static std::vector<VkVertexInputBindingDescription2EXT> getBindingDescription();
         static std::vector<VkVertexInputAttributeDescription2EXT> getAttributeDescription();
 
         void draw(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count);
+        // Draw VkDrawIndexedIndirectCommand from a buffer, the number of commands is read from countBuffer
+        void drawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                               VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCount);
+
+        // Vertex offset to use with a range of indices starting at firstIndex
+        int32_t getVertexOffset(uint32_t firstIndex) const;
+
+        VkIndexType getIndexType() const { return indexType; }
+        // Size of the vertex & index buffers
+        VkDeviceSize getMemorySize() const { return vertexBuffer->getBufferSize() + indexBuffer->getBufferSize(); }
 
     private:
         VulkanDevice& device;
@@ -24,10 +48,14 @@ namespace z0 {
         uint32_t indexCount{0};
         std::unique_ptr<VulkanBuffer> vertexBuffer;
         std::unique_ptr<VulkanBuffer> indexBuffer;
+        VkIndexType indexType{VK_INDEX_TYPE_UINT32};
+        std::vector<IndexChunk> indexChunks;
 
         void bind(VkCommandBuffer commandBuffer);
         void createVertexBuffers(const std::vector<Vertex> &vertices);
-        void createIndexBuffers(const std::vector<uint32_t> &indices);
+        void createIndexBuffers(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &cutIndices);
+        void uploadIndexBuffer(const void* indices, uint32_t indexSize);
+        bool splitIndexChunks(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &cutIndices);
 
     public:
         VulkanModel(const VulkanModel&) = delete;
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <volk.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace z0 {
+
+    class VulkanRenderer;
+
+    // Images & buffers accesses of a renderer in the frame, declared by VulkanRenderer::declareResources().
+    // The accesses made after some commands of the pass, like the reads of the attachments written by a previous
+    // rendering of the same renderer, are declared in the following phases of the pass.
+    class RenderGraphPass {
+    public:
+        // A history read uses the content written by the previous frame : the pass is executed before the writers
+        RenderGraphPass& readImage(VkImage image, VkImageLayout layout,
+                                   VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                                   VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, bool history = false);
+        // With discard the previous content is not preserved (cleared or fully overwritten attachments)
+        RenderGraphPass& writeImage(VkImage image, VkImageLayout layout,
+                                    VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                                    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, bool discard = false);
+        RenderGraphPass& readBuffer(VkBuffer buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access);
+        RenderGraphPass& writeBuffer(VkBuffer buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access);
+        // Never culled, even if nothing reads the outputs of the pass
+        RenderGraphPass& setSideEffects();
+        // The next accesses are declared in a new phase, the barriers of a phase are recorded by the renderer
+        // with VulkanDevice::beginPassPhase() before the commands of the phase
+        RenderGraphPass& nextPhase();
+        uint32_t getPhase() const { return phase; }
+
+        VulkanRenderer& getRenderer() const { return renderer; }
+
+        explicit RenderGraphPass(VulkanRenderer& renderer): renderer{renderer} {}
+
+    private:
+        friend class VulkanRenderGraph;
+        struct Resource {
+            uint64_t handle;
+            bool image;
+            auto operator<=>(const Resource&) const = default;
+        };
+        struct Access {
+            Resource resource;
+            VkImageLayout layout;
+            VkPipelineStageFlags2 stages;
+            VkAccessFlags2 access;
+            VkImageAspectFlags aspect;
+            bool write;
+            bool discard;
+            bool history;
+            uint32_t phase;
+        };
+        struct Barriers {
+            std::vector<VkImageMemoryBarrier2> images;
+            std::vector<VkBufferMemoryBarrier2> buffers;
+        };
+
+        VulkanRenderer& renderer;
+        std::vector<Access> accesses;
+        bool sideEffects{false};
+        uint32_t phase{0};
+        // Barriers of the phases after the first one
+        std::vector<Barriers> phasesBarriers;
+
+        RenderGraphPass& add(const Access& access);
+        static Resource toResource(VkImage image);
+        static Resource toResource(VkBuffer buffer);
+
+    public:
+        RenderGraphPass(const RenderGraphPass&) = delete;
+        RenderGraphPass &operator=(const RenderGraphPass&) = delete;
+        RenderGraphPass(const RenderGraphPass&&) = delete;
+        RenderGraphPass &&operator=(const RenderGraphPass&&) = delete;
+    };
+
+    // Frame render graph : the renderers declare the resources they read & write, the graph orders the passes,
+    // culls the passes whose outputs are not used by the frame image and records the barriers between the passes
+    // in one vkCmdPipelineBarrier2() per pass. The images layouts & last accesses are tracked across the frames.
+    // The aliased images of a memory slot are discarded on their first use after another image of the slot, their
+    // lifetimes in the frame are checked against each other.
+    // https://www.gdcvault.com/play/1024612/FrameGraph-Extensible-Rendering-Architecture-in
+    // https://themaister.net/blog/2017/08/15/render-graphs-and-vulkan-a-deep-dive/
+    class VulkanRenderGraph {
+    public:
+        VulkanRenderGraph() = default;
+
+        // Passes are added in the renderers registration order, kept between the independent passes
+        RenderGraphPass& addPass(VulkanRenderer& renderer);
+        // Image copied to the swap chain at the end of the frame
+        void setOutput(VkImage image) { output = image; }
+        // Order & cull the passes. Must be called once per frame, after the declarations
+        void compile();
+        // Passes to record, in the execution order
+        const std::vector<RenderGraphPass*>& getPasses() const { return executionOrder; }
+        // Record the barriers needed before a pass. The barriers of the next phases of the pass are computed
+        // with them, in the execution order, and recorded later by the renderer with beginPhase()
+        void beginPass(VkCommandBuffer commandBuffer, RenderGraphPass& pass);
+        // Record the barriers of a phase of the pass of a renderer, called by the recording threads
+        void beginPhase(VkCommandBuffer commandBuffer, const VulkanRenderer& renderer, uint32_t phase) const;
+        // Transition the output image for the copy to the swap chain and clear the passes for the next frame
+        void endFrame(VkCommandBuffer commandBuffer);
+
+        // Images sharing the memory of an aliasing slot
+        void setAliasingSlot(VkImage image, uint32_t slot);
+        // Forget the state of a destroyed image, the handle can be reused. The buffers have no layout,
+        // a reused buffer handle only costs a redundant barrier
+        void removeImage(VkImage image);
+
+    private:
+        using Resource = RenderGraphPass::Resource;
+        // Last accesses of a resource
+        struct ResourceState {
+            VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+            // last write or layout transition
+            VkPipelineStageFlags2 writeStages{VK_PIPELINE_STAGE_2_NONE};
+            VkAccessFlags2 writeAccess{VK_ACCESS_2_NONE};
+            // accesses the last write have been made visible to
+            VkPipelineStageFlags2 visibleStages{VK_PIPELINE_STAGE_2_NONE};
+            VkAccessFlags2 visibleAccess{VK_ACCESS_2_NONE};
+            // reads since the last write
+            VkPipelineStageFlags2 readStages{VK_PIPELINE_STAGE_2_NONE};
+        };
+        // Passes of the frame, in the declaration order
+        std::vector<std::unique_ptr<RenderGraphPass>> passes;
+        std::vector<RenderGraphPass*> executionOrder;
+        VkImage output{VK_NULL_HANDLE};
+        std::map<Resource, ResourceState> states;
+        std::map<Resource, uint32_t> aliasingSlots;
+        // Last image using the memory of each slot
+        std::map<uint32_t, Resource> slotsOwners;
+        RenderGraphPass::Barriers barriers;
+
+        void addBarrier(const RenderGraphPass::Access& access);
+        void pushBarrier(const RenderGraphPass::Access& access, VkImageLayout oldLayout,
+                         VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess);
+        static void recordBarriers(VkCommandBuffer commandBuffer, const RenderGraphPass::Barriers& barriers);
+        // Check that the images of an aliasing slot are not used at the same time
+        void checkAliasingLifetimes() const;
+
+    public:
+        VulkanRenderGraph(const VulkanRenderGraph&) = delete;
+        VulkanRenderGraph &operator=(const VulkanRenderGraph&) = delete;
+        VulkanRenderGraph(const VulkanRenderGraph&&) = delete;
+        VulkanRenderGraph &&operator=(const VulkanRenderGraph&&) = delete;
+    };
+
+}
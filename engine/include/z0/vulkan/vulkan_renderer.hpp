@@ -1,6 +1,6 @@
 #pragma once
 
-#include <volk.h>
+#include "z0/vulkan/vulkan_render_graph.hpp"
 
 namespace z0 {
 
@@ -10,9 +10,13 @@ namespace z0 {
         virtual VkImageView getImageView() const { return VK_NULL_HANDLE; };
         virtual void cleanup() = 0;
         virtual void update(uint32_t currentFrame) = 0;
+        // Images & buffers read & written by the renderer in the frame, called after update().
+        // The barriers between the renderers are recorded by the render graph from these declarations,
+        // a renderer declaring nothing is never culled
+        virtual void declareResources(RenderGraphPass& pass, uint32_t currentFrame) { pass.setSideEffects(); };
         virtual void beginRendering(VkCommandBuffer commandBuffer) = 0;
         virtual void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) = 0;
-        virtual void endRendering(VkCommandBuffer commandBuffer, bool isLast)  = 0;
+        virtual void endRendering(VkCommandBuffer commandBuffer)  = 0;
         virtual void createImagesResources() = 0;
         virtual void cleanupImagesResources() = 0;
         virtual void recreateImagesResources() = 0;
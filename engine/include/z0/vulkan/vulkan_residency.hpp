@@ -0,0 +1,88 @@
+#pragma once
+
+#include "z0/vulkan/vulkan_stats.hpp"
+
+#include <volk.h>
+#include "vk_mem_alloc.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace z0 {
+
+    // Residency of the evictable GPU resources against the video memory budget of the device local heaps.
+    // When the usage goes over the high watermark, the least recently used resources are evicted until
+    // the usage goes under the low watermark. New data is streamed in only under the low watermark,
+    // and the resources used in the last frames are never evicted, to avoid thrashing.
+    // https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/staying_within_budget.html
+    class VulkanResidency {
+    public:
+        using handle_t = uint32_t;
+        // Release the memory of a resource. Returns the objects to keep alive until the frames in flight are completed
+        using evict_t = std::function<std::shared_ptr<void>()>;
+
+        // Fractions of the budget
+        static constexpr float HIGH_WATERMARK = 0.95f;
+        static constexpr float LOW_WATERMARK = 0.85f;
+        // Frames without use before a resource can be evicted
+        static constexpr uint64_t MIN_UNUSED_FRAMES = 60;
+
+        VulkanResidency(VmaAllocator allocator, uint32_t framesInFlight);
+
+        // Replace the heaps budget reported by the driver, 0 to use the reported one
+        void setBudget(VkDeviceSize bytes) { budgetOverride = bytes; }
+        VkDeviceSize getBudget() const { return budget; }
+        VkDeviceSize getUsage() const { return usage; }
+
+        handle_t add(MemoryCategory category, evict_t evict);
+        void remove(handle_t handle);
+        // Size of the evictable memory of a resource, 0 when not resident
+        void setResidentSize(handle_t handle, VkDeviceSize size);
+        // The resource is needed for the current frame
+        void use(handle_t handle);
+        // Make room under the low watermark to stream size bytes in, evicting the least recently used resources.
+        // Returns false if the bytes can't fit without evicting resources used in the last frames.
+        bool reserve(VkDeviceSize size);
+        // Refresh the budget and evict over the high watermark. Must be called once per frame
+        void update();
+
+    private:
+        struct Resource {
+            MemoryCategory category;
+            evict_t evict;
+            VkDeviceSize size{0};
+            uint64_t lastUsedFrame{0};
+            bool evicted{false};
+            bool valid{false};
+        };
+        struct Releasing {
+            std::shared_ptr<void> object;
+            VkDeviceSize size;
+            uint64_t frame;
+        };
+
+        VmaAllocator allocator;
+        const uint32_t framesInFlight;
+        VkDeviceSize budgetOverride{0};
+        VkDeviceSize budget{0};
+        VkDeviceSize usage{0};
+        // Evicted bytes still used by the frames in flight
+        VkDeviceSize releasingSize{0};
+        uint64_t frameCount{0};
+        std::vector<Resource> resources;
+        std::vector<handle_t> freeHandles;
+        std::vector<Releasing> releasing;
+
+        void refreshUsage();
+        // Evict the least recently used resources until the usage goes under target bytes
+        bool evict(VkDeviceSize target);
+
+    public:
+        VulkanResidency(const VulkanResidency&) = delete;
+        VulkanResidency &operator=(const VulkanResidency&) = delete;
+        VulkanResidency(const VulkanResidency&&) = delete;
+        VulkanResidency &&operator=(const VulkanResidency&&) = delete;
+    };
+
+}
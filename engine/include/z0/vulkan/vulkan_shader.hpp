@@ -12,7 +12,8 @@ namespace z0 {
                      std::string                 name,
                      const std::vector<char>     &code,
                      const VkDescriptorSetLayout *pSetLayouts,
-                     const VkPushConstantRange   *pPushConstantRange);
+                     const VkPushConstantRange   *pPushConstantRange,
+                     const std::vector<uint32_t> &specializationConstants = {});
         ~VulkanShader();
 
         VkShaderCreateInfoEXT getShaderCreateInfo() const { return shaderCreateInfo; };
@@ -20,6 +21,8 @@ namespace z0 {
         VkShaderEXT* getShader() { return &shader; };
 
         void setShader(VkShaderEXT _shader) { shader = _shader; };
+        // Created in one call with the other stages, must always be bound with them
+        void setLinked() { shaderCreateInfo.flags |= VK_SHADER_CREATE_LINK_STAGE_BIT_EXT; };
 
     private:
         VulkanDevice& device;
@@ -29,6 +32,17 @@ namespace z0 {
         std::string           shaderName;
         VkShaderCreateInfoEXT shaderCreateInfo;
         std::vector<char> spirv;
+        // Values of the specialization constants, constant_id is the index in the vector
+        std::vector<uint32_t> specializationData;
+        std::vector<VkSpecializationMapEntry> specializationEntries;
+        VkSpecializationInfo specializationInfo;
+
+    public:
+        // The create info points to the members
+        VulkanShader(const VulkanShader&) = delete;
+        VulkanShader &operator=(const VulkanShader&) = delete;
+        VulkanShader(const VulkanShader&&) = delete;
+        VulkanShader &&operator=(const VulkanShader&&) = delete;
     };
 
 }
\ No newline at end of file
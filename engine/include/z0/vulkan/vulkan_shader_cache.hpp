@@ -0,0 +1,76 @@
+#pragma once
+
+#include <volk.h>
+
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace z0 {
+
+    // On-disk cache of the device specific shader objects binaries, one file per shader.
+    // The files are keyed by a hash of the SPIR-V code, stages, specialization constants, descriptor set layouts
+    // and push constant ranges, and are only used with the same device, driver and shader binary version,
+    // otherwise the shader is created from SPIR-V and the file replaced.
+    // The shaders can be created from several threads.
+    // https://docs.vulkan.org/samples/latest/samples/extensions/shader_object/README.html
+    class VulkanShaderCache {
+    public:
+        // The cache is disabled if the directory is empty
+        VulkanShaderCache(VkPhysicalDevice physicalDevice, VkDevice device, std::filesystem::path directory);
+
+        // Create shader objects from the cached binaries or, if not available, from the SPIR-V code.
+        // Linked shaders (VK_SHADER_CREATE_LINK_STAGE_BIT_EXT) are all loaded from the cache or all created from SPIR-V.
+        VkResult createShaders(uint32_t count, const VkShaderCreateInfoEXT* createInfos, VkShaderEXT* shaders);
+        // Log the number of shaders loaded from the cache and the total shaders creation time
+        void logStats() const;
+        // Content key of a descriptor set layout, the handles are different for each run.
+        // Shaders using an unknown layout are only cached for the current run
+        void addSetLayout(VkDescriptorSetLayout setLayout, uint64_t key);
+        void removeSetLayout(VkDescriptorSetLayout setLayout);
+        static uint64_t hash(const void* data, size_t size, uint64_t seed);
+
+    private:
+        static constexpr uint32_t MAGIC{ 0x7a307363 }; // "z0sc"
+        static constexpr uint32_t VERSION{ 1 };
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint8_t  binaryUUID[VK_UUID_SIZE];
+            uint32_t binaryVersion;
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint32_t driverVersion;
+            uint64_t key;
+            uint64_t dataSize;
+            uint64_t dataHash;
+        };
+
+        VkDevice device;
+        std::filesystem::path directory;
+        // Identification of the device & driver, copied in the header of each file
+        Header deviceHeader{};
+        std::mutex statsMutex;
+        mutable std::mutex setLayoutsMutex;
+        std::unordered_map<VkDescriptorSetLayout, uint64_t> setLayoutsKeys;
+        uint32_t hits{0};
+        uint32_t misses{0};
+        double creationTime{0.0};
+
+        bool load(uint32_t count, const VkShaderCreateInfoEXT* createInfos, const uint64_t* keys, VkShaderEXT* shaders) const;
+        bool read(uint64_t key, std::vector<char>& data) const;
+        void save(uint64_t key, VkShaderEXT shader) const;
+        std::filesystem::path getFilename(uint64_t key) const;
+
+        uint64_t hash(const VkShaderCreateInfoEXT& createInfo, uint64_t seed) const;
+
+    public:
+        VulkanShaderCache(const VulkanShaderCache&) = delete;
+        VulkanShaderCache &operator=(const VulkanShaderCache&) = delete;
+        VulkanShaderCache(const VulkanShaderCache&&) = delete;
+        VulkanShaderCache &&operator=(const VulkanShaderCache&&) = delete;
+    };
+
+}
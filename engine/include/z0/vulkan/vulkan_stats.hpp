@@ -1,10 +1,22 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 
 namespace z0 {
 
+    // Video memory usage categories of the allocations
+    enum MemoryCategory : uint32_t {
+        MEMORY_BUFFERS          = 0,
+        MEMORY_TEXTURES         = 1,
+        MEMORY_CUBEMAPS         = 2,
+        MEMORY_ATTACHMENTS      = 3,
+        MEMORY_SHADOW_MAPS      = 4,
+        MEMORY_CATEGORIES_COUNT = 5,
+    };
+
 #ifdef VULKAN_STATS
     class VulkanStats {
     public:
@@ -12,6 +24,14 @@ namespace z0 {
         uint32_t descriptorSetsCount{0};
         uint32_t imagesCount{0};
         uint32_t averageFps{0};
+        std::atomic<uint32_t> trianglesCount{0}; // drawn during the last frame, by the recording threads
+        std::atomic<uint32_t> shaderBindsCount{0}; // during the last frame, by the recording threads
+        std::atomic<uint32_t> barriersCount{0}; // render graph pipeline barriers, during the last frame, by the recording threads
+        std::array<uint64_t, MEMORY_CATEGORIES_COUNT> memoryUsage{}; // allocated bytes per category
+        uint64_t memoryHeapsUsage{0}; // device local heaps, from VK_EXT_memory_budget when supported
+        uint64_t memoryHeapsBudget{0};
+        std::array<uint32_t, MEMORY_CATEGORIES_COUNT> evictionsCount{}; // resources evicted over the budget
+        std::array<uint32_t, MEMORY_CATEGORIES_COUNT> restreamsCount{}; // evicted resources streamed in again
 
         void display() const;
 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "z0/vulkan/vulkan_texture_table.hpp"
+
+#include <future>
+#include <unordered_map>
+
+namespace z0 {
+
+    // Mip levels streaming of the images created with VulkanImage::createStreamed().
+    // The mip tail stays resident in the slot of the image in the textures table, the finer levels requested
+    // by the visible surfaces are box filtered from the source pixels by worker threads then uploaded
+    // as a new image, swapped in the same slot once the upload commands are completed on the GPU. The streamed levels are evictable resources of the device
+    // residency : when evicted, the images fall back to their mip tail.
+    // https://developer.nvidia.com/gpugems/gpugems2/part-iii-high-quality-rendering/chapter-28-mipmap-level-measurement
+    class VulkanTextureStreamer {
+    public:
+        // Images uploads submitted per frame, to limit the frame time hitches
+        static constexpr uint32_t MAX_UPLOADS_PER_FRAME = 2;
+        // Mip levels prepared at the same time by the worker threads
+        static constexpr uint32_t MAX_PENDING_LOADS = 4;
+
+        VulkanTextureStreamer(VulkanDevice& device, VulkanTextureTable& table);
+
+        // Stream the mip levels of an image of the textures table, ignored if the image is not streamed
+        void add(const std::shared_ptr<VulkanImage>& image);
+        // Request the mip level of an image needed for a surface covering screenSize pixels in this frame
+        void request(const VulkanImage* image, float screenSize);
+        // Swap the loaded levels and start the loads of the requested levels, if they fit in the budget.
+        // Must be called once per frame, after the requests & before the table update
+        void update();
+        void cleanup();
+
+    private:
+        struct Level {
+            uint32_t width;
+            uint32_t height;
+            std::vector<unsigned char> pixels;
+        };
+        struct StreamedImage {
+            // Mip tail, always resident
+            std::shared_ptr<VulkanImage> tail;
+            // Finer levels swapped in the table slot, nullptr if only the tail is resident
+            std::shared_ptr<VulkanImage> resident{nullptr};
+            uint32_t residentLevel;
+            uint32_t requestedLevel;
+            uint64_t lastUsedFrame{0};
+            std::future<Level> pending;
+            uint32_t pendingLevel{0};
+            // Image of the pending level while uploaded, not used by the frames before the fence is signaled
+            std::shared_ptr<VulkanImage> uploading{nullptr};
+            VkCommandBuffer uploadCommands{VK_NULL_HANDLE};
+            VkFence uploadFence{VK_NULL_HANDLE};
+            VulkanResidency::handle_t residencyHandle;
+        };
+
+        VulkanDevice& vulkanDevice;
+        VulkanTextureTable& textureTable;
+        std::unordered_map<const VulkanImage*, StreamedImage> images;
+        uint64_t frameCount{1};
+
+        void setResident(StreamedImage& streamed, const std::shared_ptr<VulkanImage>& image, uint32_t level);
+        void endUpload(StreamedImage& streamed);
+        // Video memory needed to replace the resident levels of an image with a finer level
+        static VkDeviceSize getStreamingSize(const StreamedImage& streamed, uint32_t level);
+
+    public:
+        VulkanTextureStreamer(const VulkanTextureStreamer&) = delete;
+        VulkanTextureStreamer &operator=(const VulkanTextureStreamer&) = delete;
+        VulkanTextureStreamer(const VulkanTextureStreamer&&) = delete;
+        VulkanTextureStreamer &&operator=(const VulkanTextureStreamer&&) = delete;
+    };
+
+}
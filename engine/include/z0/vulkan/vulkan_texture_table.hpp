@@ -0,0 +1,72 @@
+#pragma once
+
+#include "z0/vulkan/vulkan_image.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace z0 {
+
+    // Bindless table of the textures sampled by the shaders, an array of combined image samplers
+    // indexed by the materials. The slots are allocated from a free-list and written in the
+    // descriptor sets without rebuilding them (partially bound & update-after-bind descriptors).
+    // A released slot is reused only when the frames in flight no longer reference it.
+    // https://docs.vulkan.org/samples/latest/samples/extensions/descriptor_indexing/README.html
+    class VulkanTextureTable {
+    public:
+        // Upper bound of the variable size array, lowered to the device limits
+        static constexpr uint32_t MAX_TEXTURES{ 4096 };
+        // Samplers of the shaders outside of the table, and minimum size of the table
+        static constexpr uint32_t RESERVED_SAMPLERS{ 16 };
+        static constexpr uint32_t MIN_TEXTURES{ 64 };
+
+        explicit VulkanTextureTable(VulkanDevice& device);
+
+        // Size of the descriptors array
+        uint32_t getCapacity() const { return capacity; }
+        // Slot of an image, allocated on the first use
+        int32_t add(const std::shared_ptr<VulkanImage>& image);
+        // Release one use of an image slot
+        void remove(const std::shared_ptr<VulkanImage>& image);
+        // Sample another image in the slot of an image, used to swap the streamed mip levels.
+        // The previous content is destroyed when the frames in flight no longer reference it.
+        void replace(const std::shared_ptr<VulkanImage>& image, const std::shared_ptr<VulkanImage>& content);
+        // Write the slots changed since the last update of this frame in its descriptor set.
+        // Must be called once per frame before recording the commands of the frame.
+        void update(VkDescriptorSet descriptorSet, uint32_t binding, uint32_t currentFrame);
+        void cleanup();
+
+    private:
+        struct Slot {
+            int32_t index;
+            uint32_t useCount;
+        };
+        struct ReleasedSlot {
+            int32_t index;
+            uint64_t frame;
+        };
+        struct RetiredImage {
+            std::shared_ptr<VulkanImage> image;
+            uint64_t frame;
+        };
+
+        VulkanDevice& vulkanDevice;
+        uint32_t capacity;
+        std::vector<std::shared_ptr<VulkanImage>> images;
+        std::unordered_map<const VulkanImage*, Slot> slots;
+        std::vector<int32_t> freeSlots;
+        std::vector<ReleasedSlot> releasedSlots;
+        std::vector<RetiredImage> retiredImages;
+        // Slots to write in the descriptor set of each frame in flight
+        std::vector<std::vector<int32_t>> dirtySlots{MAX_FRAMES_IN_FLIGHT};
+        uint64_t frameCount{0};
+
+    public:
+        VulkanTextureTable(const VulkanTextureTable&) = delete;
+        VulkanTextureTable &operator=(const VulkanTextureTable&) = delete;
+        VulkanTextureTable(const VulkanTextureTable&&) = delete;
+        VulkanTextureTable &&operator=(const VulkanTextureTable&&) = delete;
+    };
+
+}
@@ -0,0 +1,33 @@
+// Clustered forward lighting : the view frustum is divided in CLUSTERS_X * CLUSTERS_Y screen tiles
+// and CLUSTERS_Z exponential depth slices, each cluster references the lights touching it.
+// https://www.aortiz.me/2018/12/21/CG.html
+// Must be the same values as LightClustersRenderer
+const uint CLUSTERS_X = 16;
+const uint CLUSTERS_Y = 9;
+const uint CLUSTERS_Z = 24;
+const uint CLUSTER_MAX_LIGHTS = 127;
+
+struct ClusterLights {
+    uint count;
+    uint indices[CLUSTER_MAX_LIGHTS];
+};
+
+// Depth slice of a view space depth
+uint clusterSlice(float viewDepth, float near, float far) {
+    float slice = floor(log(max(viewDepth, near) / near) / log(far / near) * float(CLUSTERS_Z));
+    return uint(clamp(slice, 0.0, float(CLUSTERS_Z - 1)));
+}
+
+// Depth of the near plane of a slice
+float clusterSliceDepth(uint slice, float near, float far) {
+    return near * pow(far / near, float(slice) / float(CLUSTERS_Z));
+}
+
+uint clusterIndex(uvec3 cluster) {
+    return cluster.x + CLUSTERS_X * (cluster.y + CLUSTERS_Y * cluster.z);
+}
+
+uint clusterIndex(vec2 fragCoord, float viewDepth, vec2 tileSize, float near, float far) {
+    uvec2 tile = min(uvec2(fragCoord / tileSize), uvec2(CLUSTERS_X - 1, CLUSTERS_Y - 1));
+    return clusterIndex(uvec3(tile, clusterSlice(viewDepth, near, far)));
+}
@@ -1,54 +1,28 @@
 #version 450
 
 #include "input_datas.glsl"
+#include "permutations.glsl"
 layout (location = 0) in VertexOut fs_in;
 layout (location = 0) out vec4 COLOR;
 
-vec3 normal;
-vec4 color;
-
 #include "lighting.glsl"
-
-// https://learnopengl.com/Advanced-Lighting/Shadows/Shadow-Mapping
-float shadowFactor(int shadowMapIndex) {
-    vec4 ShadowCoord = shadowMapsInfos.shadowMaps[shadowMapIndex].lightSpace * fs_in.GLOBAL_POSITION;
-
-    vec3 projCoords = ShadowCoord.xyz / ShadowCoord.w;
-    if (projCoords.z > 1.0) return 1.0f;
-    // Remap xy to [0.0, 1.0]
-    projCoords.xy = projCoords.xy * 0.5 + 0.5;
-    const bool outOfView = (projCoords.x < 0.001f || projCoords.x > 0.999f || projCoords.y < 0.001f || projCoords.y > 0.999f);
-    if (outOfView) return 1.0f;
-
-    float currentDepth = projCoords.z;
-    float closestDepth = texture(shadowMaps[shadowMapIndex], projCoords.xy).r;
-
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMaps[shadowMapIndex], 0);
-    for(int x = -1; x <= 1; ++x)  {
-        for(int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(shadowMaps[shadowMapIndex], projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += currentDepth > pcfDepth ? 1.0 : 0.0;
-        }
-    }
-    shadow /= 9.0;
-    return 1.0 - shadow;
-}
-
+#include "shadows.glsl"
 
 void main() {
-    if (material.diffuseIndex != -1) {
+    vec4 color;
+    if (HAS_DIFFUSE_TEXTURE) {
         color = texture(texSampler[material.diffuseIndex], fs_in.UV);
     } else {
         color = material.albedoColor;
     }
     COLOR = color;
 
-    if (((material.transparency == 2) || (material.transparency == 3)) && (color.a < material.alphaScissor)) {
+    if (ALPHA_SCISSOR && (color.a < material.alphaScissor)) {
         discard;
     }
 
-    if (material.normalIndex != -1) {
+    vec3 normal;
+    if (HAS_NORMAL_TEXTURE) {
         normal = texture(texSampler[material.normalIndex], fs_in.UV).rgb * 2.0 - 1.0;
         normal = normalize(fs_in.TBN * normal);
     } else {
@@ -56,20 +30,38 @@ void main() {
     }
     //COLOR = vec4(normal, 1.0);
 
+    LightingSurface surface = LightingSurface(
+        fs_in.GLOBAL_POSITION.xyz,
+        normal,
+        fs_in.VIEW_DIRECTION,
+        color.rgb,
+        HAS_SPECULAR_TEXTURE ? texture(texSampler[material.specularIndex], fs_in.UV).rgb : vec3(0.0),
+        material.shininess
+    );
+
     vec3 ambient = global.ambient.w * global.ambient.rgb * color.rgb;
     vec3 diffuse = vec3(0, 0, 0);
-    if (global.haveDirectionalLight) {
-        diffuse = calcDirectionalLight(global.directionalLight);
+    if (HAS_DIRECTIONAL_LIGHT) {
+        diffuse = calcDirectionalLight(global.directionalLight, surface);
     }
-    for(int i = 0; i < global.pointLightsCount; i++) {
-        diffuse += calcPointLight(pointLights.lights[i]);
+    // only the lights touching the cluster of the fragment
+    float viewDepth = (global.view * fs_in.GLOBAL_POSITION).z;
+    if (HAS_POINT_LIGHTS) {
+        uint cluster = clusterIndex(gl_FragCoord.xy, viewDepth, global.clustersTileSize, global.clustersNear, global.clustersFar);
+        for(uint i = 0; i < lightClusters.clusters[cluster].count; i++) {
+            diffuse += calcPointLight(pointLights.lights[lightClusters.clusters[cluster].indices[i]], surface);
+        }
     }
     vec3 result = ambient + diffuse;
 
-    for (int i = 0; i < global.shadowMapsCount; i++) {
-        float shadows = shadowFactor(i);
-        result = (ambient + shadows) * result;
+    if (HAS_SHADOWS) {
+        for (int i = 0; i < global.shadowMapsCount; i++) {
+            // cascade selection for the directional light, spot lights have a single cascade
+            uint cascade = shadowCascade(i, viewDepth);
+            float shadows = shadowFactor(i, cascade, fs_in.GLOBAL_POSITION, gl_FragCoord.xy);
+            result = (ambient + shadows) * result;
+        }
     }
 
-    COLOR = vec4(result, material.transparency == 1 || material.transparency == 3 ? color.a : 1.0);
-}
\ No newline at end of file
+    COLOR = vec4(result, ALPHA_BLENDING ? color.a : 1.0);
+}
@@ -21,6 +21,6 @@ void main() {
     vec3 T = (vec3(model.matrix * vec4(tangent.xyz, 0.0)));
     vec3 N = (vec3(model.matrix * vec4(normal, 0.0)));
     //T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
+    vec3 B = cross(N, T) * tangent.w;
     vs_out.TBN = mat3(T, B, N);
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#version 450
+
+// Deferred renderer geometry pass : opaque surfaces attributes, lit later by deferred_lighting.comp
+
+#include "input_datas.glsl"
+#include "gbuffer.glsl"
+#include "permutations.glsl"
+layout (location = 0) in VertexOut fs_in;
+layout (location = 0) out vec4 ALBEDO;
+layout (location = 1) out vec2 NORMAL;
+layout (location = 2) out vec4 MATERIAL;
+
+void main() {
+    vec4 color;
+    if (HAS_DIFFUSE_TEXTURE) {
+        color = texture(texSampler[material.diffuseIndex], fs_in.UV);
+    } else {
+        color = material.albedoColor;
+    }
+    if (ALPHA_SCISSOR && (color.a < material.alphaScissor)) {
+        discard;
+    }
+
+    vec3 normal;
+    if (HAS_NORMAL_TEXTURE) {
+        normal = texture(texSampler[material.normalIndex], fs_in.UV).rgb * 2.0 - 1.0;
+        normal = normalize(fs_in.TBN * normal);
+    } else {
+        normal = fs_in.NORMAL;
+    }
+
+    ALBEDO = vec4(color.rgb, 1.0);
+    NORMAL = encodeNormal(normal);
+    MATERIAL = vec4(
+        HAS_SPECULAR_TEXTURE ? texture(texSampler[material.specularIndex], fs_in.UV).rgb : vec3(0.0),
+        material.shininess / GBUFFER_SHININESS_SCALE);
+}
@@ -0,0 +1,22 @@
+// G-buffer of the deferred renderer, must be the same formats as GBuffer
+//  0 : albedo RGB                                  R8G8B8A8_UNORM
+//  1 : octahedral encoded world space normal       R16G16_SFLOAT
+//  2 : specular map color RGB, shininess / 256     R8G8B8A8_UNORM
+// https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+const float GBUFFER_SHININESS_SCALE = 256.0;
+
+vec2 octahedronWrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeNormal(vec3 n) {
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z >= 0.0 ? n.xy : octahedronWrap(n.xy);
+}
+
+vec3 decodeNormal(vec2 f) {
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
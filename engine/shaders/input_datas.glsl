@@ -1,26 +1,7 @@
-struct DirectionalLight {
-    vec3 direction;
-    vec4 color;
-    float specular;
-};
+#extension GL_EXT_nonuniform_qualifier : require
 
-struct PointLight {
-    vec3 position;
-    vec4 color;
-    float specular;
-    float constant;
-    float linear;
-    float quadratic;
-    bool isSpot;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-};
-
-struct ShadowMap {
-    mat4 lightSpace;
-    vec3 lightPos;
-};
+#include "clusters.glsl"
+#include "lights.glsl"
 
 layout(set = 0, binding = 0) uniform GlobalUniformBufferObject  {
     mat4 projection;
@@ -31,9 +12,13 @@ layout(set = 0, binding = 0) uniform GlobalUniformBufferObject  {
     bool haveDirectionalLight;
     int pointLightsCount;
     int shadowMapsCount;
+    float clustersNear;
+    float clustersFar;
+    vec2 clustersTileSize;
 } global;
 
-layout(set = 0, binding = 1) uniform sampler2D texSampler[100];
+// Shadow atlas depths without comparison, for the PCSS blockers search
+layout (set = 0, binding = 1) uniform sampler2D shadowAtlasDepth;
 
 layout(set = 0, binding = 2) uniform ModelUniformBufferObject  {
     mat4 matrix;
@@ -49,15 +34,22 @@ layout(set = 0, binding = 3) uniform SurfaceUniformBufferObject  {
     float shininess;
 } material;
 
-layout(set = 0, binding = 4) uniform PointLightArray {
-    PointLight lights[1];
+layout(set = 0, binding = 4) readonly buffer PointLightArray {
+    PointLight lights[];
 } pointLights;
 
 layout(set = 0, binding = 5) uniform ShadowMapArray {
     ShadowMap shadowMaps[1];
 } shadowMapsInfos;
 
-layout (set = 0, binding = 6) uniform sampler2D shadowMaps[1];
+layout (set = 0, binding = 6) uniform sampler2DShadow shadowAtlas;
+
+layout(set = 0, binding = 7) readonly buffer ClusterArray {
+    ClusterLights clusters[];
+} lightClusters;
+
+// Bindless textures table, indexed by the surfaces materials
+layout(set = 0, binding = 8) uniform sampler2D texSampler[];
 
 struct VertexOut {
     vec2 UV;
@@ -1,22 +1,31 @@
-vec3 calcDirectionalLight(DirectionalLight light) {
+// Blinn-Phong lighting of a surface point, shared by the forward and the deferred renderers
+// https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
+struct LightingSurface {
+    vec3 position;
+    vec3 normal;
+    vec3 viewDirection;
+    vec3 albedo;
+    vec3 specular;      // specular map color, no specular light if black
+    float shininess;
+};
+
+vec3 calcDirectionalLight(DirectionalLight light, LightingSurface surface) {
     vec3 lightDir = normalize(-light.direction);
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = diff * light.color.rgb * light.color.w * color.rgb;
-    if (material.specularIndex != -1) {
-        // Blinn-Phong
-        // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
-        vec3 halfwayDir = normalize(lightDir + fs_in.VIEW_DIRECTION);
-        float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess*3);
-        vec3 specular = light.specular * spec * light.color.rgb * texture(texSampler[material.specularIndex], fs_in.UV).rgb;
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+    vec3 diffuse = diff * light.color.rgb * light.color.w * surface.albedo;
+    if (surface.specular != vec3(0.0)) {
+        vec3 halfwayDir = normalize(lightDir + surface.viewDirection);
+        float spec = pow(max(dot(surface.normal, halfwayDir), 0.0), surface.shininess*3);
+        vec3 specular = light.specular * spec * light.color.rgb * surface.specular;
         return diffuse + specular;
     }
     return diffuse;
 }
 
-vec3 calcPointLight(PointLight light) {
-    float dist = length(light.position - fs_in.GLOBAL_POSITION.xyz);
+vec3 calcPointLight(PointLight light, LightingSurface surface) {
+    float dist = length(light.position - surface.position);
     float attenuation = 1.0 / (light.constant + light.linear * dist + light.quadratic * (dist * dist));
-    vec3 lightDir = normalize(light.position - fs_in.GLOBAL_POSITION.xyz);
+    vec3 lightDir = normalize(light.position - surface.position);
     float intensity = 1.0f;
     bool cutOff = light.isSpot;
 
@@ -30,12 +39,12 @@ vec3 calcPointLight(PointLight light) {
 
     if (!cutOff)
     {
-        float diff = max(dot(normal, lightDir), 0.0);
-        vec3 diffuse = intensity * attenuation * diff * light.color.rgb * light.color.w * color.rgb;
-        if (material.specularIndex != -1) {
-            vec3 halfwayDir = normalize(lightDir + fs_in.VIEW_DIRECTION);
-            float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess*3);
-            vec3 specular = intensity * attenuation * light.specular * spec * light.color.rgb * texture(texSampler[material.specularIndex], fs_in.UV).rgb;
+        float diff = max(dot(surface.normal, lightDir), 0.0);
+        vec3 diffuse = intensity * attenuation * diff * light.color.rgb * light.color.w * surface.albedo;
+        if (surface.specular != vec3(0.0)) {
+            vec3 halfwayDir = normalize(lightDir + surface.viewDirection);
+            float spec = pow(max(dot(surface.normal, halfwayDir), 0.0), surface.shininess*3);
+            vec3 specular = intensity * attenuation * light.specular * spec * light.color.rgb * surface.specular;
             return diffuse + specular;
         }
         return diffuse;
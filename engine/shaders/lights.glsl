@@ -0,0 +1,31 @@
+// Lights and shadow maps as uploaded by SceneRenderer
+struct DirectionalLight {
+    vec3 direction;
+    vec4 color;
+    float specular;
+};
+
+struct PointLight {
+    vec3 position;
+    vec4 color;
+    float specular;
+    float constant;
+    float linear;
+    float quadratic;
+    bool isSpot;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    float range;
+};
+
+// Must be the same value as ShadowMap::MAX_CASCADES
+const uint SHADOW_MAX_CASCADES = 4;
+
+struct ShadowMap {
+    mat4 lightSpace[SHADOW_MAX_CASCADES];
+    vec4 tiles[SHADOW_MAX_CASCADES]; // offset (xy) and scale (zw) of the cascades tiles in the shadow atlas
+    vec4 cascadeSplits; // farthest view space depth of each cascade
+    vec3 lightPos;
+    uint cascadesCount;
+};
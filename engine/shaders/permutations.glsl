@@ -0,0 +1,10 @@
+// Shader permutations : material features & scene lighting, set by SceneRenderer with specialization constants.
+// Must be in the same order as SceneRenderer::Permutation
+layout (constant_id = 0) const bool HAS_DIFFUSE_TEXTURE = true;
+layout (constant_id = 1) const bool HAS_NORMAL_TEXTURE = true;
+layout (constant_id = 2) const bool HAS_SPECULAR_TEXTURE = true;
+layout (constant_id = 3) const bool ALPHA_SCISSOR = true;
+layout (constant_id = 4) const bool ALPHA_BLENDING = true;
+layout (constant_id = 5) const bool HAS_DIRECTIONAL_LIGHT = true;
+layout (constant_id = 6) const bool HAS_POINT_LIGHTS = true;
+layout (constant_id = 7) const bool HAS_SHADOWS = true;
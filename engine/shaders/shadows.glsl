@@ -0,0 +1,104 @@
+// https://learnopengl.com/Advanced-Lighting/Shadows/Shadow-Mapping
+// Needs the shadowMapsInfos, shadowAtlas and shadowAtlasDepth bindings
+
+// Shadow filtering quality tiers, compiled as shader variants, see ApplicationConfig::shadowFilter
+// Hardware bilinear PCF : one comparison tap, filtered by the sampler
+#define SHADOW_FILTER_HARDWARE_PCF  0
+// Poisson disk of hardware PCF taps, rotated per pixel
+#define SHADOW_FILTER_POISSON       1
+// Percentage-closer soft shadows : Poisson disk sized from the blockers distance
+// https://developer.download.nvidia.com/shaderlibrary/docs/shadow_PCSS.pdf
+#define SHADOW_FILTER_PCSS          2
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER SHADOW_FILTER_HARDWARE_PCF
+#endif
+
+// Filter radius of the Poisson disk, in texels
+const float SHADOW_POISSON_RADIUS = 2.0f;
+// Size of the light and blockers search radius in texels for PCSS
+const float SHADOW_PCSS_LIGHT_SIZE = 12.0f;
+const float SHADOW_PCSS_MAX_RADIUS = 16.0f;
+
+const vec2 POISSON_DISK[16] = vec2[](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+    vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+    vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+    vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+    vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+// Cascade of a shadow map containing a view space depth, cascadesCount if farther than the last cascade
+uint shadowCascade(int shadowMapIndex, float viewDepth) {
+    uint cascadesCount = shadowMapsInfos.shadowMaps[shadowMapIndex].cascadesCount;
+    for (uint cascade = 0; cascade < cascadesCount; cascade++) {
+        if (viewDepth <= shadowMapsInfos.shadowMaps[shadowMapIndex].cascadeSplits[cascade]) {
+            return cascade;
+        }
+    }
+    return cascadesCount;
+}
+
+// https://www.iryoku.com/next-generation-post-processing-in-call-of-duty-advanced-warfare/
+float interleavedGradientNoise(vec2 pixel) {
+    return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+// Lit fraction of a Poisson disk of hardware PCF taps
+float poissonFilter(vec2 uv, float depth, float radius, vec2 texelSize, vec2 tileMin, vec2 tileMax, vec2 pixel) {
+    float angle = 6.28318530 * interleavedGradientNoise(pixel);
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+    float lit = 0.0;
+    for (int i = 0; i < 16; i++) {
+        vec2 offset = rotation * POISSON_DISK[i] * radius * texelSize;
+        lit += texture(shadowAtlas, vec3(clamp(uv + offset, tileMin, tileMax), depth));
+    }
+    return lit / 16.0;
+}
+
+float shadowFactor(int shadowMapIndex, uint cascade, vec4 worldPosition, vec2 pixel) {
+    if (cascade >= shadowMapsInfos.shadowMaps[shadowMapIndex].cascadesCount) return 1.0f;
+    // light without a tile in the atlas
+    vec4 tile = shadowMapsInfos.shadowMaps[shadowMapIndex].tiles[cascade];
+    if (tile.z == 0.0f) return 1.0f;
+    vec4 ShadowCoord = shadowMapsInfos.shadowMaps[shadowMapIndex].lightSpace[cascade] * worldPosition;
+
+    vec3 projCoords = ShadowCoord.xyz / ShadowCoord.w;
+    if (projCoords.z > 1.0) return 1.0f;
+    // Remap xy to [0.0, 1.0]
+    projCoords.xy = projCoords.xy * 0.5 + 0.5;
+    const bool outOfView = (projCoords.x < 0.001f || projCoords.x > 0.999f || projCoords.y < 0.001f || projCoords.y > 0.999f);
+    if (outOfView) return 1.0f;
+
+    float currentDepth = projCoords.z;
+    vec2 texelSize = 1.0 / textureSize(shadowAtlas, 0).xy;
+    // Stay inside the tile of the cascade
+    vec2 tileMin = tile.xy + texelSize * 0.5;
+    vec2 tileMax = tile.xy + tile.zw - texelSize * 0.5;
+    vec2 uv = tile.xy + projCoords.xy * tile.zw;
+#if SHADOW_FILTER == SHADOW_FILTER_POISSON
+    return poissonFilter(uv, currentDepth, SHADOW_POISSON_RADIUS, texelSize, tileMin, tileMax, pixel);
+#elif SHADOW_FILTER == SHADOW_FILTER_PCSS
+    // Average depth of the blockers
+    float blockersDepth = 0.0;
+    int blockersCount = 0;
+    for (int i = 0; i < 16; i++) {
+        vec2 offset = POISSON_DISK[i] * SHADOW_PCSS_LIGHT_SIZE * texelSize;
+        float depth = texture(shadowAtlasDepth, clamp(uv + offset, tileMin, tileMax)).r;
+        if (depth < currentDepth) {
+            blockersDepth += depth;
+            blockersCount += 1;
+        }
+    }
+    if (blockersCount == 0) return 1.0f;
+    blockersDepth /= float(blockersCount);
+    // Penumbra width from the similar triangles of the light, the blockers and the receiver
+    float penumbra = (currentDepth - blockersDepth) / max(blockersDepth, 0.0001) * SHADOW_PCSS_LIGHT_SIZE;
+    return poissonFilter(uv, currentDepth, clamp(penumbra, 1.0, SHADOW_PCSS_MAX_RADIUS),
+                         texelSize, tileMin, tileMax, pixel);
+#else
+    return texture(shadowAtlas, vec3(clamp(uv, tileMin, tileMax), currentDepth));
+#endif
+}
@@ -3,6 +3,7 @@
 #include "z0/viewport.hpp"
 #include "z0/log.hpp"
 #include "z0/input.hpp"
+#include "z0/utils/parallel_for.hpp"
 
 #include <Jolt/RegisterTypes.h>
 
@@ -16,7 +17,8 @@ namespace z0 {
     Application& Application::get() { return *instance; }
 
     Application::Application(const ApplicationConfig& cfg):
-            vulkanInstance{}, applicationConfig{cfg} {
+            vulkanInstance{}, applicationConfig{cfg}, dt{1.0f / static_cast<float>(cfg.physicsTickRate)} {
+        if (cfg.physicsTickRate == 0) die("The physics tick rate must be at least one tick per second");
         viewport = std::make_shared<Viewport>(vulkanInstance, cfg);
         if (instance != nullptr) die("Application already registered");
         instance = this;
@@ -42,19 +44,12 @@ namespace z0 {
                            object_vs_object_layer_filter);
     }
 
-    void worker(BlockingQueue<std::shared_ptr<Node>>& queue) {
-        std::shared_ptr<Node> node;
-        while (queue.pop(node)) {
-            //std::cout << std::this_thread::get_id() << " consumed: " << node->toString() << std::endl;
-            if (node->_needPhysics()) node->_physicsUpdate();
-            node->onPhysicsProcess(dt);
-        }
-    }
-
     void Application::start(const std::shared_ptr<Node>& scene) {
         currentScene = scene;
         ready(currentScene);
         physicsSystem.OptimizeBroadPhase();
+        // the renderers are loaded with the transforms used by the rendering
+        interpolate(currentScene, 1.0f, glm::mat4{1.0f}, false);
         viewport->loadScene(currentScene);
 
         // https://gafferongames.com/post/fix_your_timestep/
@@ -65,11 +60,6 @@ namespace z0 {
         uint32_t frameCount = 0;
         float elapsedSeconds = 0.0;
 
-        constexpr int maxWorkers = 2;
-        std::vector<std::jthread> workers{maxWorkers};
-        for (int i = 0; i < maxWorkers; i++) {
-            workers.push_back(std::jthread{worker, std::ref(queue)});
-        }
         while (!viewport->shouldClose()) {
             while(Input::haveInputEvent()) {
                 auto event = Input::consumeInputEvent();
@@ -82,15 +72,16 @@ namespace z0 {
             currentTime = newTime;
             accumulator += frameTime;
             while (accumulator >= dt) {
-                physicsProcess(currentScene, dt);
-                while ((!queue.isEmpty()) && (!viewport->shouldClose())) {}; //queue.waitWhileNotEmpty();
+                physicsProcess(dt);
                 physicsSystem.Update(dt, 1, temp_allocator.get(), job_system.get());
+                physicsUpdate();
                 t += dt;
                 accumulator -= dt;
             }
 
             const double alpha = accumulator / dt;
             process(currentScene, static_cast<float>(alpha));
+            interpolate(currentScene, static_cast<float>(alpha), glm::mat4{1.0f}, false);
             viewport->drawFrame();
 
             elapsedSeconds += static_cast<float>(frameTime);
@@ -105,7 +96,6 @@ namespace z0 {
                 elapsedSeconds = 0;
             }
         }
-        queue.shutdown();
         viewport->wait();
         JPH::UnregisterTypes();
 #ifdef VULKAN_STATS
@@ -134,13 +124,50 @@ namespace z0 {
             process(child, delta);
         }
     }
-    void Application::physicsProcess(const std::shared_ptr<Node>& node, float delta) {
-        if (node->isProcessed()) {
-            queue.push(node);
-            //node->onPhysicsProcess(delta);
+    void Application::interpolate(const std::shared_ptr<Node>& node, float alpha, const glm::mat4& correction, bool corrected) {
+        glm::mat4 interpolated;
+        if (node->_interpolateTransform(alpha, interpolated)) {
+            node->_setInterpolatedTransform(interpolated);
+            // moves the children from the world transform of the body to the interpolated one
+            const auto bodyCorrection = interpolated * glm::inverse(node->worldTransform);
+            for(auto& child: node->getChildren()) {
+                interpolate(child, alpha, bodyCorrection, true);
+            }
+            return;
+        }
+        node->_setInterpolatedTransform(corrected ? correction * node->worldTransform : node->worldTransform);
+        for(auto& child: node->getChildren()) {
+            interpolate(child, alpha, correction, corrected);
         }
+    }
+
+    void Application::physicsProcess(float delta) {
+        physicsNodes.clear();
+        addPhysicsNodes(currentScene);
+        // the main thread executes jobs until all the nodes are processed
+        parallelFor(static_cast<uint32_t>(physicsNodes.size()), PHYSICS_NODES_CHUNK, [&](uint32_t begin, uint32_t end) {
+            for (auto index = begin; index < end; index++) {
+                auto* node = physicsNodes[index];
+                node->onPhysicsProcess(delta);
+                if (node->_needPhysics()) node->_prePhysicsUpdate();
+            }
+        });
+    }
+
+    void Application::physicsUpdate() {
+        // the nodes follow the bodies moved by the physics step
+        parallelFor(static_cast<uint32_t>(physicsNodes.size()), PHYSICS_NODES_CHUNK, [&](uint32_t begin, uint32_t end) {
+            for (auto index = begin; index < end; index++) {
+                auto* node = physicsNodes[index];
+                if (node->_needPhysics()) node->_physicsUpdate();
+            }
+        });
+    }
+
+    void Application::addPhysicsNodes(const std::shared_ptr<Node>& node) {
+        if (node->isProcessed()) physicsNodes.push_back(node.get());
         for(auto& child: node->getChildren()) {
-            physicsProcess(child, delta);
+            addPhysicsNodes(child);
         }
     }
 }
\ No newline at end of file
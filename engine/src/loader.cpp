@@ -3,6 +3,7 @@
 #include "z0/log.hpp"
 #include "z0/viewport.hpp"
 #include "z0/application.hpp"
+#include "z0/utils/parallel_for.hpp"
 
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -14,8 +15,24 @@
 
 #include <stb_image.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <limits>
+
 namespace z0 {
 
+    // Only the mip tail is uploaded when the textures are streamed
+    std::shared_ptr<VulkanImage> createImage(int width, int height, unsigned char* data, VkFormat format) {
+        auto& device = Application::getViewport()._getDevice();
+        if (Application::getConfig().textureStreaming) {
+            return VulkanImage::createStreamed(device, width, height, data, format);
+        }
+        VkDeviceSize imageSize = width * height * STBI_rgb_alpha;
+        return std::make_shared<VulkanImage>(device, width, height, imageSize, data, format);
+    }
+
     // https://fastgltf.readthedocs.io/v0.7.x/tools.html
     // https://github.com/vblanco20-1/vulkan-guide/blob/all-chapters-1.3-wip/chapter-5/vk_loader.cpp
     std::shared_ptr<Image> loadImage(fastgltf::Asset& asset, fastgltf::Image& image, VkFormat format) {
@@ -33,10 +50,7 @@ namespace z0 {
                     unsigned char* data = stbi_load(path.c_str(), &width, &height,
                                                     &nrChannels, STBI_rgb_alpha);
                     if (data) {
-                        VkDeviceSize imageSize = width * height * STBI_rgb_alpha;
-                        newImage = std::make_shared<VulkanImage>(Application::getViewport()._getDevice(),
-                                                                 width, height,
-                                                                 imageSize, data, format);
+                        newImage = createImage(width, height, data, format);
                         stbi_image_free(data);
                     }
                 },
@@ -45,10 +59,7 @@ namespace z0 {
                                                                 &width, &height,
                                                                 &nrChannels, STBI_rgb_alpha);
                     if (data) {
-                        VkDeviceSize imageSize = width * height * STBI_rgb_alpha;
-                        newImage = std::make_shared<VulkanImage>(Application::getViewport()._getDevice(),
-                                                                 width, height,
-                                                                 imageSize, data, format);
+                        newImage = createImage(width, height, data, format);
                         stbi_image_free(data);
                     }
                 },
@@ -67,10 +78,7 @@ namespace z0 {
                                                                            &width, &height,
                                                                            &nrChannels, STBI_rgb_alpha);
                                if (data) {
-                                   VkDeviceSize imageSize = width * height * STBI_rgb_alpha;
-                                   newImage = std::make_shared<VulkanImage>(Application::getViewport()._getDevice(),
-                                                                            width, height,
-                                                                            imageSize, data, format);
+                                   newImage = createImage(width, height, data, format);
                                    stbi_image_free(data);
                                }
                            },
@@ -80,10 +88,7 @@ namespace z0 {
                                                                            &width, &height,
                                                                            &nrChannels, STBI_rgb_alpha);
                                if (data) {
-                                   VkDeviceSize imageSize = width * height * STBI_rgb_alpha;
-                                   newImage = std::make_shared<VulkanImage>(Application::getViewport()._getDevice(),
-                                                                            width, height,
-                                                                            imageSize, data, format);
+                                   newImage = createImage(width, height, data, format);
                                    stbi_image_free(data);
                                }
                            },
@@ -96,6 +101,137 @@ namespace z0 {
         return newImage == nullptr ? nullptr : std::make_shared<Image>(newImage, name);
     }
 
+    // A primitive without TANGENT attribute
+    struct TangentsJob {
+        Mesh* mesh;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+    };
+
+    // Per-vertex tangents of a primitive : triangle tangents accumulated on each vertex, weighted by the corner angle,
+    // then orthonormalized against the vertex normal. The bitangent sign is stored in w.
+    // https://github.com/mmikk/MikkTSpace
+    // https://terathon.com/blog/tangent-space.html
+    void generateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                          uint32_t firstIndex, uint32_t indexCount, uint32_t firstVertex, uint32_t vertexCount) {
+        std::vector<glm::vec3> tangents(vertexCount, glm::vec3{0.0f});
+        std::vector<glm::vec3> bitangents(vertexCount, glm::vec3{0.0f});
+        for (uint32_t i = firstIndex; (i + 2) < (firstIndex + indexCount); i += 3) {
+            const uint32_t triangle[3] = { indices[i], indices[i + 1], indices[i + 2] };
+            const auto& vertex1 = vertices[triangle[0]];
+            const auto& vertex2 = vertices[triangle[1]];
+            const auto& vertex3 = vertices[triangle[2]];
+            const glm::vec3 edge1 = vertex2.position - vertex1.position;
+            const glm::vec3 edge2 = vertex3.position - vertex1.position;
+            const glm::vec2 deltaUV1 = vertex2.uv - vertex1.uv;
+            const glm::vec2 deltaUV2 = vertex3.uv - vertex1.uv;
+            const float det = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+            if (std::abs(det) < std::numeric_limits<float>::epsilon()) { continue; }
+            const float f = 1.0f / det;
+            const glm::vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) * f;
+            const glm::vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) * f;
+            for (uint32_t k = 0; k < 3; k++) {
+                const auto& corner = vertices[triangle[k]].position;
+                const auto e1 = vertices[triangle[(k + 1) % 3]].position - corner;
+                const auto e2 = vertices[triangle[(k + 2) % 3]].position - corner;
+                const auto lengths = glm::length(e1) * glm::length(e2);
+                if (lengths == 0.0f) { continue; }
+                const auto angle = std::acos(std::clamp(glm::dot(e1, e2) / lengths, -1.0f, 1.0f));
+                tangents[triangle[k] - firstVertex] += tangent * angle;
+                bitangents[triangle[k] - firstVertex] += bitangent * angle;
+            }
+        }
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            auto& vertex = vertices[firstVertex + i];
+            const auto& normal = vertex.normal;
+            // Gram-Schmidt orthogonalize
+            auto tangent = tangents[i] - normal * glm::dot(normal, tangents[i]);
+            if (glm::dot(tangent, tangent) < std::numeric_limits<float>::epsilon()) {
+                // degenerated UVs : use any direction orthogonal to the normal
+                tangent = glm::cross(normal, std::abs(normal.x) > 0.9f ? AXIS_Y : AXIS_X);
+                if (glm::dot(tangent, tangent) < std::numeric_limits<float>::epsilon()) {
+                    tangent = AXIS_X;
+                }
+            }
+            tangent = glm::normalize(tangent);
+            const float handedness = glm::dot(glm::cross(normal, tangent), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+            vertex.tangent = glm::vec4(tangent, handedness);
+        }
+    }
+
+    // Optimize all the meshes of a model
+    void optimizeMeshes(std::vector<std::shared_ptr<Mesh>>& meshes, const std::filesystem::path& filename) {
+        std::vector<MeshOptimizer::Stats> stats(meshes.size());
+        parallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t index) {
+            stats[index] = meshes[index]->_optimize();
+        });
+        MeshOptimizer::Stats total{};
+        for (const auto& meshStats : stats) {
+            total.verticesBefore += meshStats.verticesBefore;
+            total.verticesAfter += meshStats.verticesAfter;
+            total.triangles += meshStats.triangles;
+            total.acmrBefore += meshStats.acmrBefore * static_cast<float>(meshStats.triangles);
+            total.acmrAfter += meshStats.acmrAfter * static_cast<float>(meshStats.triangles);
+        }
+        if (total.triangles > 0) {
+            log(filename.string(),
+                std::format("{} meshes optimized : {} -> {} vertices, ACMR {:.3f} -> {:.3f}",
+                            meshes.size(),
+                            total.verticesBefore, total.verticesAfter,
+                            total.acmrBefore / static_cast<float>(total.triangles),
+                            total.acmrAfter / static_cast<float>(total.triangles)));
+        }
+    }
+
+    // Generate the levels of detail of all the meshes of a model
+    void buildMeshesLods(std::vector<std::shared_ptr<Mesh>>& meshes, const std::filesystem::path& filename) {
+        const auto& lodErrors = Application::getConfig().lodErrors;
+        std::vector<std::vector<uint32_t>> trianglesCount(meshes.size());
+        const auto start = std::chrono::steady_clock::now();
+        parallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t index) {
+            trianglesCount[index] = meshes[index]->_buildLods(lodErrors);
+        });
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // triangles per level for the whole model, the meshes with less LODs keep their coarsest level
+        std::vector<uint32_t> total;
+        for (const auto& meshTriangles : trianglesCount) {
+            total.resize(std::max(total.size(), meshTriangles.size()), 0);
+        }
+        for (const auto& meshTriangles : trianglesCount) {
+            for (uint32_t lod = 0; lod < total.size(); lod++) {
+                total[lod] += meshTriangles[std::min(lod, static_cast<uint32_t>(meshTriangles.size() - 1))];
+            }
+        }
+        if (total.size() > 1) {
+            std::string levels;
+            for (uint32_t lod = 0; lod < total.size(); lod++) {
+                levels += std::format("{}LOD{} {}", lod == 0 ? "" : ", ", lod, total[lod]);
+            }
+            log(filename.string(), "triangles :", levels);
+        }
+        // each level is simplified from the LOD 0 triangles, the discarded levels included
+        if (!total.empty() && !lodErrors.empty() && (seconds > 0.0)) {
+            const auto simplified = static_cast<double>(total[0]) * static_cast<double>(lodErrors.size());
+            log(filename.string(), std::format("LODs built in {:.1f} ms, {:.2f} M simplified triangles/s",
+                                               seconds * 1000.0, simplified / seconds / 1e6));
+        }
+    }
+
+    // Split all the meshes of a model in meshlets for the GPU culling
+    void buildMeshesMeshlets(std::vector<std::shared_ptr<Mesh>>& meshes, const std::filesystem::path& filename) {
+        std::vector<uint32_t> meshletsCount(meshes.size());
+        parallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t index) {
+            meshletsCount[index] = meshes[index]->_buildMeshlets();
+        });
+        uint32_t total = 0;
+        for (const auto count : meshletsCount) {
+            total += count;
+        }
+        log(filename.string(), std::format("{} meshlets", total));
+    }
+
     // https://fastgltf.readthedocs.io/v0.7.x/overview.html
     // https://github.com/vblanco20-1/vulkan-guide/blob/all-chapters-1.3-wip/chapter-5/vk_loader.cpp
     std::shared_ptr<Node> Loader::loadModelFromFile(const std::filesystem::path& filename, bool forceBackFaceCulling) {
@@ -151,6 +287,7 @@ namespace z0 {
         }
 
         std::vector<std::shared_ptr<Mesh>> meshes;
+        std::vector<TangentsJob> tangentsJobs;
         for (fastgltf::Mesh& glftMesh : gltf.meshes) {
             std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(glftMesh.name.data());
             std::vector<Vertex>& vertices = mesh->getVertices();
@@ -216,32 +353,35 @@ namespace z0 {
                     mesh->_getMaterials().insert(material);
 
                 }
-                // calculate tangent for each triangle
+                // tangents will be calculated for each vertex of this primitive
                 if (!haveTangents) {
-                    for (uint32_t i = 0; i < indices.size(); i += 3) {
-                        auto &vertex1 = vertices[indices[i]];
-                        auto &vertex2 = vertices[indices[i + 1]];
-                        auto &vertex3 = vertices[indices[i + 2]];
-                        glm::vec3 edge1 = vertex2.position - vertex1.position;
-                        glm::vec3 edge2 = vertex3.position - vertex1.position;
-                        glm::vec2 deltaUV1 = vertex2.uv - vertex1.uv;
-                        glm::vec2 deltaUV2 = vertex3.uv - vertex1.uv;
-
-                        float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-                        glm::vec3 tangent {
-                                f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x),
-                                f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y),
-                                f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z),
-                        };
-                        vertex1.tangent = glm::vec4(tangent, 1.0);
-                        vertex2.tangent = glm::vec4(tangent, 1.0);
-                        vertex3.tangent = glm::vec4(tangent, 1.0);
-                    }
+                    tangentsJobs.push_back({
+                        .mesh = mesh.get(),
+                        .firstIndex = surface->firstVertexIndex,
+                        .indexCount = surface->indexCount,
+                        .firstVertex = static_cast<uint32_t>(initial_vtx),
+                        .vertexCount = static_cast<uint32_t>(vertices.size() - initial_vtx),
+                    });
                 }
                 mesh->getSurfaces().push_back(surface);
             }
             meshes.push_back(mesh);
         }
+        // primitives have their own vertices, they can be processed in parallel
+        parallelFor(static_cast<uint32_t>(tangentsJobs.size()), [&](uint32_t index) {
+            const auto& job = tangentsJobs[index];
+            generateTangents(job.mesh->getVertices(), job.mesh->getIndices(),
+                             job.firstIndex, job.indexCount, job.firstVertex, job.vertexCount);
+        });
+        if (Application::getConfig().optimizeMeshes) {
+            optimizeMeshes(meshes, filename);
+        }
+        if (!Application::getConfig().lodErrors.empty()) {
+            buildMeshesLods(meshes, filename);
+        }
+        if (Application::getConfig().meshletCulling) {
+            buildMeshesMeshlets(meshes, filename);
+        }
 
         // load all nodes and their meshes
         std::vector<std::shared_ptr<Node>> nodes;
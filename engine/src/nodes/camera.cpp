@@ -12,7 +12,7 @@ namespace z0 {
 
     Camera::Camera(const std::string nodeName): Node{nodeName} {
         setPerspectiveProjection(fov, nearDistance, farDistance);
-        setViewDirection();
+        setViewDirection(worldTransform);
     }
 
     void Camera::setOrthographicProjection(float left, float right, float top, float bottom, float _near, float _far) {
@@ -50,18 +50,23 @@ namespace z0 {
 
     void Camera::updateTransform(const glm::mat4& parentMatrix) {
         Node::updateTransform(parentMatrix);
-        setViewDirection();
+        setViewDirection(worldTransform);
     }
 
     void Camera::updateTransform() {
         Node::updateTransform();
-        setViewDirection();
+        setViewDirection(worldTransform);
     }
 
-    void Camera::setViewDirection() {
-        auto rotationQuat = glm::toQuat(glm::mat3(worldTransform));
+    void Camera::_setInterpolatedTransform(const glm::mat4& transform) {
+        Node::_setInterpolatedTransform(transform);
+        setViewDirection(interpolatedTransform);
+    }
+
+    void Camera::setViewDirection(const glm::mat4& transform) {
+        auto rotationQuat = glm::toQuat(glm::mat3(transform));
         auto newDirection = rotationQuat * direction;
-        auto position = getPositionGlobal();
+        auto position = glm::vec3{transform[3]};
 
         glm::vec3 w{glm::normalize(newDirection)};
         w *= -1;
@@ -1,4 +1,7 @@
 #include "z0/nodes/mesh_instance.hpp"
+#include "z0/nodes/camera.hpp"
+
+#include <algorithm>
 
 namespace z0 {
 
@@ -7,6 +10,41 @@ namespace z0 {
         return n + (mesh != nullptr ? "[" + mesh->getName() + "]" : "[]");
     }*/
 
+    uint32_t MeshInstance::getLod(const Camera& camera, float viewportHeight, float threshold) const {
+        const auto lodCount = mesh->getLodCount();
+        if (lodCount <= 1) { return 0; }
+        const auto scale = std::max({glm::length(glm::vec3{interpolatedTransform[0]}),
+                                     glm::length(glm::vec3{interpolatedTransform[1]}),
+                                     glm::length(glm::vec3{interpolatedTransform[2]})});
+        const auto pixelsPerUnit = getPixelsPerUnit(camera, viewportHeight);
+        for (auto lod = lodCount - 1; lod > 0; lod--) {
+            if ((mesh->getLodError(lod) * scale * pixelsPerUnit) <= threshold) {
+                return lod;
+            }
+        }
+        return 0;
+    }
+
+    glm::vec4 MeshInstance::getWorldBounds() const {
+        const auto scale = std::max({glm::length(glm::vec3{interpolatedTransform[0]}),
+                                     glm::length(glm::vec3{interpolatedTransform[1]}),
+                                     glm::length(glm::vec3{interpolatedTransform[2]})});
+        const auto center = glm::vec3{interpolatedTransform * glm::vec4{mesh->getBoundsCenter(), 1.0f}};
+        return glm::vec4{center, mesh->getBoundsRadius() * scale};
+    }
+
+    float MeshInstance::getScreenSize(const Camera& camera, float viewportHeight) const {
+        return 2.0f * getWorldBounds().w * getPixelsPerUnit(camera, viewportHeight);
+    }
+
+    float MeshInstance::getPixelsPerUnit(const Camera& camera, float viewportHeight) const {
+        const auto bounds = getWorldBounds();
+        const auto distance = std::max(glm::distance(glm::vec3{bounds}, camera.getPositionInterpolated()) - bounds.w,
+                                       camera.getNearDistance());
+        // size in pixels of one world unit at this distance
+        return viewportHeight / (2.0f * distance * std::tan(glm::radians(camera.getFov()) / 2.0f));
+    }
+
     std::shared_ptr<Node> MeshInstance::duplicateInstance() {
         return std::make_shared<MeshInstance>(*this);
     }
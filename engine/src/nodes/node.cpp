@@ -15,6 +15,7 @@ namespace z0 {
         std::replace(name.begin(), name.end(),  '/', '_');
         localTransform = glm::mat4 {1.0};
         updateTransform(glm::mat4{1.0f});
+        interpolatedTransform = worldTransform;
     }
 
     Node::Node(const Node& orig) {
@@ -22,6 +23,7 @@ namespace z0 {
         parent = orig.parent;
         localTransform = orig.localTransform;
         worldTransform = orig.worldTransform;
+        interpolatedTransform = orig.interpolatedTransform;
         processMode = orig.processMode;
     }
 
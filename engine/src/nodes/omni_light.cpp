@@ -1,5 +1,8 @@
 #include "z0/nodes/omni_light.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace z0 {
 
     OmniLight::OmniLight(float _linear,
@@ -11,4 +14,21 @@ namespace z0 {
     {
     }
 
-}
\ No newline at end of file
+    // Solves intensity / (attenuation + linear * d + quadratic * d^2) = LIGHT_CUTOFF
+    float OmniLight::getRange() const {
+        const auto& color = getColorAndIntensity();
+        const auto intensity = color.w * std::max({color.r, color.g, color.b});
+        const auto c = attenuation - intensity / LIGHT_CUTOFF;
+        if (c >= 0.0f) {
+            return 0.0f;
+        }
+        if (quadratic > 0.0f) {
+            return std::min((-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic), LIGHT_MAX_RANGE);
+        }
+        if (linear > 0.0f) {
+            return std::min(-c / linear, LIGHT_MAX_RANGE);
+        }
+        return LIGHT_MAX_RANGE;
+    }
+
+}
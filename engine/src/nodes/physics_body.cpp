@@ -31,20 +31,46 @@ namespace z0 {
         //bodyInterface.DestroyBody(bodyId);
     }
 
+    // the state before the step, including the moves made by the nodes during the physics process
+    void PhysicsBody::_prePhysicsUpdate() {
+        previousState = currentState;
+    }
+
+    // the state after the step
     void PhysicsBody::_physicsUpdate() {
         updating = true;
         JPH::Vec3 position;
         JPH::Quat rotation;
         bodyInterface.GetPositionAndRotation(bodyId, position, rotation);
-        setPositionGlobal(glm::vec3{position.GetX(), position.GetY(), position.GetZ()});
-        setRotation(glm::quat{rotation.GetW(), rotation.GetX(), rotation.GetY(), rotation.GetZ(), });
+        currentState = {
+            .position = glm::vec3{position.GetX(), position.GetY(), position.GetZ()},
+            .rotation = glm::quat{rotation.GetW(), rotation.GetX(), rotation.GetY(), rotation.GetZ(), },
+        };
+        setPositionGlobal(currentState.position);
+        setRotation(currentState.rotation);
         updating = false;
     }
 
+    // https://gafferongames.com/post/fix_your_timestep/#the-final-touch
+    bool PhysicsBody::_interpolateTransform(float alpha, glm::mat4& transform) const {
+        // a body at rest is rendered with its world transform
+        if (previousState == currentState) return false;
+        const glm::vec3 scale{glm::length(glm::vec3{worldTransform[0]}),
+                              glm::length(glm::vec3{worldTransform[1]}),
+                              glm::length(glm::vec3{worldTransform[2]})};
+        transform = glm::translate(glm::mat4{1.0f}, glm::mix(previousState.position, currentState.position, alpha)) *
+                    glm::toMat4(glm::slerp(previousState.rotation, currentState.rotation, alpha)) *
+                    glm::scale(glm::mat4{1.0f}, scale);
+        return true;
+    }
+
     void PhysicsBody::setPositionAndRotation() {
         if (updating || (parent == nullptr)) return;
         auto position = getPositionGlobal();
         auto quat = glm::toQuat(glm::mat3(worldTransform));
+        // moved outside of the physics : no interpolation from the previous position
+        currentState = { .position = position, .rotation = quat };
+        previousState = currentState;
         bodyInterface.SetPositionAndRotation(
                 bodyId,
                 JPH::RVec3(position.x, position.y, position.z),
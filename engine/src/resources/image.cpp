@@ -10,7 +10,8 @@ namespace z0 {
     void Image::loadFromFile(const std::filesystem::path& filename) {
         vulkanImage = VulkanImage::createFromFile(
                 Application::getViewport()._getDevice(),
-                (Application::getDirectory() / filename).string()
+                (Application::getDirectory() / filename).string(),
+                Application::getConfig().textureStreaming
         );
     }
 
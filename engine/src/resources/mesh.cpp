@@ -1,8 +1,17 @@
 #include "z0/resources/mesh.hpp"
 #include "z0/application.hpp"
 
+#include <algorithm>
+
 namespace z0 {
 
+    MeshSurfaceRange MeshSurface::getLod(uint32_t lod) const {
+        if ((lod == 0) || lods.empty()) {
+            return {firstVertexIndex, indexCount, firstMeshlet, meshletCount};
+        }
+        return lods[std::min(lod, static_cast<uint32_t>(lods.size())) - 1];
+    }
+
     std::shared_ptr<Material>& Mesh::getSurfaceMaterial(uint32_t surfaceIndex) {
         return surfaces[surfaceIndex]->material;
     }
@@ -12,7 +21,125 @@ namespace z0 {
     }
 
     void Mesh::_buildModel() {
-        _model = std::make_shared<VulkanModel>(Application::getViewport()._getDevice(), vertices, indices);
+        // the 16-bit index chunks must not split a meshlet
+        std::vector<uint32_t> meshletsStarts;
+        meshletsStarts.reserve(meshlets.size());
+        for (const auto& meshlet : meshlets) {
+            meshletsStarts.push_back(meshlet.firstIndex);
+        }
+        std::sort(meshletsStarts.begin(), meshletsStarts.end());
+        auto& device = Application::getViewport()._getDevice();
+        _model = std::make_shared<VulkanModel>(device, vertices, indices, meshletsStarts);
+        if (!modelBuilt) {
+            residency = &device.getResidency();
+            residencyHandle = residency->add(MEMORY_BUFFERS, [this]() {
+                std::shared_ptr<void> evicted = std::move(_model);
+                _model.reset();
+                return evicted;
+            });
+            modelBuilt = true;
+        }
+        residency->setResidentSize(residencyHandle, _model->getMemorySize());
+    }
+
+    VulkanModel& Mesh::_useModel() {
+        if (_model == nullptr) {
+            _buildModel();
+        }
+        residency->use(residencyHandle);
+        return *_model;
+    }
+
+    Mesh::~Mesh() {
+        if (modelBuilt) {
+            residency->remove(residencyHandle);
+        }
+    }
+
+    MeshOptimizer::Stats Mesh::_optimize() {
+        std::vector<MeshOptimizer::IndexRange> ranges;
+        ranges.reserve(surfaces.size());
+        for (const auto& surface : surfaces) {
+            ranges.push_back({surface->firstVertexIndex, surface->indexCount});
+        }
+        return MeshOptimizer::optimize(vertices, indices, ranges);
+    }
+
+    void Mesh::computeBounds() {
+        if (vertices.empty()) { return; }
+        glm::vec3 min{vertices[0].position};
+        glm::vec3 max{vertices[0].position};
+        for (const auto& vertex : vertices) {
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+        }
+        boundsCenter = (min + max) * 0.5f;
+        boundsRadius = 0.0f;
+        for (const auto& vertex : vertices) {
+            boundsRadius = std::max(boundsRadius, glm::distance(boundsCenter, vertex.position));
+        }
+    }
+
+    std::vector<uint32_t> Mesh::_buildLods(const std::vector<float>& errorBudgets) {
+        computeBounds();
+        uint32_t lod0IndexCount = 0;
+        for (const auto& surface : surfaces) {
+            lod0IndexCount += surface->indexCount;
+        }
+        std::vector<uint32_t> trianglesCount{lod0IndexCount / 3};
+        uint32_t previousIndexCount = lod0IndexCount;
+        for (auto errorBudget : errorBudgets) {
+            const auto levelStart = static_cast<uint32_t>(indices.size());
+            float levelError = 0.0f;
+            uint32_t levelIndexCount = 0;
+            std::vector<MeshSurfaceRange> ranges;
+            for (const auto& surface : surfaces) {
+                // each level targets half the triangles of the previous one
+                const auto previous = surface->getLod(static_cast<uint32_t>(lodErrors.size() - 1));
+                float error;
+                auto lodIndices = MeshOptimizer::simplify(vertices,
+                                                          indices.data() + surface->firstVertexIndex,
+                                                          surface->indexCount,
+                                                          (previous.indexCount / 6) * 3,
+                                                          errorBudget * boundsRadius,
+                                                          error);
+                MeshOptimizer::optimizeVertexCache(lodIndices.data(), static_cast<uint32_t>(lodIndices.size()));
+                ranges.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size())});
+                indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+                levelError = std::max(levelError, error);
+                levelIndexCount += static_cast<uint32_t>(lodIndices.size());
+            }
+            // discard the levels that does not reduce enough the triangles count
+            if ((levelIndexCount == 0) || (levelIndexCount > (previousIndexCount * 9 / 10))) {
+                indices.resize(levelStart);
+                continue;
+            }
+            for (uint32_t i = 0; i < surfaces.size(); i++) {
+                surfaces[i]->lods.push_back(ranges[i]);
+            }
+            lodErrors.push_back(levelError);
+            trianglesCount.push_back(levelIndexCount / 3);
+            previousIndexCount = levelIndexCount;
+        }
+        return trianglesCount;
+    }
+
+    uint32_t Mesh::_buildMeshlets() {
+        computeBounds();
+        meshlets.clear();
+        const auto build = [&](uint32_t firstIndex, uint32_t indexCount, uint32_t& firstMeshlet, uint32_t& meshletCount) {
+            const auto rangeMeshlets = MeshOptimizer::buildMeshlets(vertices, indices.data(), firstIndex, indexCount);
+            firstMeshlet = static_cast<uint32_t>(meshlets.size());
+            meshletCount = static_cast<uint32_t>(rangeMeshlets.size());
+            meshlets.insert(meshlets.end(), rangeMeshlets.begin(), rangeMeshlets.end());
+        };
+        for (const auto& surface : surfaces) {
+            build(surface->firstVertexIndex, surface->indexCount, surface->firstMeshlet, surface->meshletCount);
+            for (auto& lod : surface->lods) {
+                build(lod.firstIndex, lod.indexCount, lod.firstMeshlet, lod.meshletCount);
+            }
+        }
+        return static_cast<uint32_t>(meshlets.size());
     }
 
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "z0/vulkan/vulkan_device.hpp"
+#include "z0/vulkan/vulkan_stats.hpp"
 #include "z0/log.hpp"
 #include "z0/viewport.hpp"
 #include "z0/application.hpp"
@@ -27,6 +28,15 @@ namespace z0 {
     void DebugUI::statsPanel() {
         ImGui::Begin("##FPS", nullptr, invisibleWindowFlags);
         ImGui::Text("FPS %.0f", Application::getViewport().getFPS());
+        ImGui::Text("Latency %.1f ms", Application::getViewport().getFrameLatency());
+#ifdef VULKAN_STATS
+        ImGui::Text("Triangles %u", VulkanStats::get().trianglesCount.load());
+        ImGui::Text("Shader binds %u", VulkanStats::get().shaderBindsCount.load());
+        ImGui::Text("Barriers %u", VulkanStats::get().barriersCount.load());
+        ImGui::Text("VRAM %llu/%llu MB",
+                    static_cast<unsigned long long>(VulkanStats::get().memoryHeapsUsage / (1024 * 1024)),
+                    static_cast<unsigned long long>(VulkanStats::get().memoryHeapsBudget / (1024 * 1024)));
+#endif
         ImGui::SetWindowPos(ImVec2(windowHelper.getWidth() - ImGui::GetWindowWidth() , 0), ImGuiCond_Always);
         ImGui::End();
     }
@@ -120,13 +130,15 @@ namespace z0 {
         vkDestroyDescriptorPool(device.getDevice(), imguiPool, nullptr);
     }
 
-    void DebugUI::drawFrame(VkCommandBuffer commandBuffer, VkImageView targetImageView,VkExtent2D extent) {
+    void DebugUI::newFrame() {
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
         drawUI();
         ImGui::Render();
+    }
 
+    void DebugUI::drawFrame(VkCommandBuffer commandBuffer, VkImageView targetImageView,VkExtent2D extent) {
         VkRenderingAttachmentInfo colorAttachment{
                 .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
                 .pNext = nullptr,
@@ -0,0 +1,29 @@
+#include "z0/utils/frustum.hpp"
+
+namespace z0 {
+
+    Frustum::Frustum(const glm::mat4& viewProjection) {
+        const auto row = [&](int i) {
+            return glm::vec4{viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]};
+        };
+        planes[0] = row(3) + row(0);
+        planes[1] = row(3) - row(0);
+        planes[2] = row(3) + row(1);
+        planes[3] = row(3) - row(1);
+        planes[4] = row(2);
+        planes[5] = row(3) - row(2);
+        for (auto& plane : planes) {
+            plane /= glm::length(glm::vec3{plane});
+        }
+    }
+
+    bool Frustum::isOutside(const glm::vec3& center, float radius) const {
+        for (const auto& plane : planes) {
+            if ((glm::dot(glm::vec3{plane}, center) + plane.w) < -radius) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+}
@@ -0,0 +1,148 @@
+#include "z0/utils/job_system.hpp"
+#include "z0/log.hpp"
+
+#include <algorithm>
+
+namespace z0 {
+
+    // Queue of the calling thread
+    struct ThreadQueue {
+        JobSystem* jobSystem{nullptr};
+        uint32_t queueIndex{0};
+        void release() {
+            if (jobSystem != nullptr && queueIndex >= jobSystem->workersCount) {
+                jobSystem->releaseExternalQueue(queueIndex);
+            }
+            jobSystem = nullptr;
+        }
+        // the queue of a non-worker thread is given back when the thread ends
+        ~ThreadQueue() { release(); }
+    };
+    static thread_local ThreadQueue threadQueue;
+
+    JobSystem& JobSystem::get() {
+        static JobSystem jobSystem{std::max(1u, std::thread::hardware_concurrency()) - 1};
+        return jobSystem;
+    }
+
+    JobSystem::JobSystem(const uint32_t workersCount):
+        workersCount{workersCount},
+        externalQueuesUsed(MAX_EXTERNAL_THREADS, false) {
+        for (uint32_t i = 0; i < (workersCount + MAX_EXTERNAL_THREADS); i++) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (uint32_t i = 0; i < workersCount; i++) {
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        stopping.store(true, std::memory_order_release);
+        pushedJobs.fetch_add(1, std::memory_order_release);
+        pushedJobs.notify_all();
+        workers.clear();
+    }
+
+    void JobSystem::run(JobCounter& counter, Job job) {
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        auto& queue = *queues[getQueueIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back({ std::move(job), &counter });
+        }
+        pushedJobs.fetch_add(1, std::memory_order_release);
+        pushedJobs.notify_one();
+    }
+
+    void JobSystem::wait(JobCounter& counter) {
+        const auto queueIndex = getQueueIndex();
+        while (true) {
+            // loaded before the counter : a group completed after this load wakes up the thread
+            const auto completed = completedGroups.load(std::memory_order_acquire);
+            if (counter.pending.load(std::memory_order_acquire) == 0) break;
+            if (!tryExecute(queueIndex)) completedGroups.wait(completed, std::memory_order_acquire);
+        }
+        if (counter.exception) {
+            std::rethrow_exception(counter.exception);
+        }
+    }
+
+    void JobSystem::workerLoop(uint32_t index) {
+        threadQueue.jobSystem = this;
+        threadQueue.queueIndex = index;
+        while (!stopping.load(std::memory_order_acquire)) {
+            // a job pushed after this load wakes up the worker
+            const auto pushed = pushedJobs.load(std::memory_order_acquire);
+            if (!tryExecute(index)) pushedJobs.wait(pushed, std::memory_order_acquire);
+        }
+    }
+
+    uint32_t JobSystem::getQueueIndex() {
+        if (threadQueue.jobSystem != this) {
+            threadQueue.release();
+            threadQueue.jobSystem = this;
+            threadQueue.queueIndex = acquireExternalQueue();
+        }
+        return threadQueue.queueIndex;
+    }
+
+    uint32_t JobSystem::acquireExternalQueue() {
+        std::lock_guard<std::mutex> lock(externalQueuesMutex);
+        const auto it = std::find(externalQueuesUsed.begin(), externalQueuesUsed.end(), false);
+        if (it == externalQueuesUsed.end()) {
+            die("Too many threads using the job system");
+        }
+        *it = true;
+        return workersCount + static_cast<uint32_t>(it - externalQueuesUsed.begin());
+    }
+
+    void JobSystem::releaseExternalQueue(const uint32_t queueIndex) {
+        std::lock_guard<std::mutex> lock(externalQueuesMutex);
+        externalQueuesUsed[queueIndex - workersCount] = false;
+    }
+
+    bool JobSystem::tryExecute(uint32_t queueIndex) {
+        Task task;
+        auto found = false;
+        {
+            // own queue : the last pushed job, its data is still in the cache
+            auto& queue = *queues[queueIndex];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                found = true;
+            }
+        }
+        // steal the oldest job of another queue, the non-worker threads only steal from the workers
+        const auto external = queueIndex >= workersCount;
+        const auto queuesCount = static_cast<uint32_t>(queues.size());
+        for (uint32_t i = 1; (i < queuesCount) && !found; i++) {
+            const auto index = (queueIndex + i) % queuesCount;
+            if (external && (index >= workersCount)) continue;
+            auto& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                found = true;
+            }
+        }
+        if (!found) return false;
+        try {
+            task.job();
+        } catch (...) {
+            // the job ends anyway, the waiting thread rethrows the first exception of the group
+            if (!task.counter->failed.test_and_set(std::memory_order_relaxed)) {
+                task.counter->exception = std::current_exception();
+            }
+        }
+        // the counter may be destroyed by the waiting thread as soon as it reaches zero
+        if (task.counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            completedGroups.fetch_add(1, std::memory_order_release);
+            completedGroups.notify_all();
+        }
+        return true;
+    }
+
+}
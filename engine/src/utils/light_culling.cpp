@@ -0,0 +1,103 @@
+#include "z0/utils/light_culling.hpp"
+#include "z0/utils/frustum.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define Z0_LIGHT_CULLING_SSE
+#endif
+
+namespace z0 {
+
+    void LightCuller::resize(uint32_t count) {
+        positionsX.resize(count);
+        positionsY.resize(count);
+        positionsZ.resize(count);
+        ranges.resize(count);
+        intensities.resize(count);
+        importances.resize(count);
+        visibles.reserve(count);
+    }
+
+    void LightCuller::setLight(uint32_t index, const glm::vec3& position, float range, float intensity) {
+        positionsX[index] = position.x;
+        positionsY[index] = position.y;
+        positionsZ[index] = position.z;
+        ranges[index] = range;
+        intensities[index] = intensity;
+    }
+
+    const std::vector<uint32_t>& LightCuller::cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+                                                   float nearDistance, uint32_t budget) {
+        const Frustum frustum{viewProjection};
+        const auto& planes = frustum.planes;
+        const auto minDistance2 = nearDistance * nearDistance;
+        const auto count = static_cast<uint32_t>(positionsX.size());
+
+        visibles.clear();
+        uint32_t i = 0;
+#ifdef Z0_LIGHT_CULLING_SSE
+        const auto cameraX = _mm_set1_ps(cameraPosition.x);
+        const auto cameraY = _mm_set1_ps(cameraPosition.y);
+        const auto cameraZ = _mm_set1_ps(cameraPosition.z);
+        const auto minDistance = _mm_set1_ps(minDistance2);
+        for (; i + 4 <= count; i += 4) {
+            const auto x = _mm_loadu_ps(&positionsX[i]);
+            const auto y = _mm_loadu_ps(&positionsY[i]);
+            const auto z = _mm_loadu_ps(&positionsZ[i]);
+            const auto range = _mm_loadu_ps(&ranges[i]);
+            const auto minusRange = _mm_sub_ps(_mm_setzero_ps(), range);
+            // sphere not entirely behind one of the planes
+            auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const auto& plane : planes) {
+                const auto distance = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), z), _mm_set1_ps(plane.w)));
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, minusRange));
+            }
+            const auto mask = _mm_movemask_ps(inside);
+            if (mask == 0) continue;
+            // intensity * (range / distance)², proportional to the projected area of the light sphere
+            const auto dx = _mm_sub_ps(x, cameraX);
+            const auto dy = _mm_sub_ps(y, cameraY);
+            const auto dz = _mm_sub_ps(z, cameraZ);
+            const auto distance2 = _mm_max_ps(
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)),
+                    minDistance);
+            const auto importance = _mm_div_ps(
+                    _mm_mul_ps(_mm_loadu_ps(&intensities[i]), _mm_mul_ps(range, range)),
+                    distance2);
+            _mm_storeu_ps(&importances[i], importance);
+            for (uint32_t lane = 0; lane < 4; lane++) {
+                if (mask & (1 << lane)) visibles.push_back(i + lane);
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            const glm::vec3 position{positionsX[i], positionsY[i], positionsZ[i]};
+            auto inside = true;
+            for (const auto& plane : planes) {
+                if (glm::dot(glm::vec3{plane}, position) + plane.w <= -ranges[i]) {
+                    inside = false;
+                    break;
+                }
+            }
+            if (!inside) continue;
+            const auto delta = position - cameraPosition;
+            const auto distance2 = std::max(glm::dot(delta, delta), minDistance2);
+            importances[i] = intensities[i] * ranges[i] * ranges[i] / distance2;
+            visibles.push_back(i);
+        }
+
+        // The clusters keep the first lights when full, so the list is always sorted
+        const auto byImportance = [&](uint32_t a, uint32_t b) { return importances[a] > importances[b]; };
+        if (visibles.size() > budget) {
+            std::nth_element(visibles.begin(), visibles.begin() + budget, visibles.end(), byImportance);
+            visibles.resize(budget);
+        }
+        std::sort(visibles.begin(), visibles.end(), byImportance);
+        return visibles;
+    }
+
+}
@@ -0,0 +1,707 @@
+#include "z0/utils/mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+namespace z0 {
+
+    // Symmetric 4x4 matrix of the sum of squared distances to a set of planes
+    struct Quadric {
+        double a00{0}, a01{0}, a02{0}, a03{0};
+        double a11{0}, a12{0}, a13{0};
+        double a22{0}, a23{0};
+        double a33{0};
+
+        void addPlane(const glm::vec3& n, float d) {
+            a00 += n.x * n.x; a01 += n.x * n.y; a02 += n.x * n.z; a03 += n.x * d;
+            a11 += n.y * n.y; a12 += n.y * n.z; a13 += n.y * d;
+            a22 += n.z * n.z; a23 += n.z * d;
+            a33 += d * d;
+        }
+
+        Quadric& operator+=(const Quadric& q) {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+            return *this;
+        }
+
+        double error(const glm::vec3& p) const {
+            const double x = p.x, y = p.y, z = p.z;
+            return std::max(0.0, x * x * a00 + 2 * x * y * a01 + 2 * x * z * a02 + 2 * x * a03 +
+                                 y * y * a11 + 2 * y * z * a12 + 2 * y * a13 +
+                                 z * z * a22 + 2 * z * a23 +
+                                 a33);
+        }
+    };
+
+    MeshOptimizer::Stats MeshOptimizer::optimize(std::vector<Vertex>& vertices,
+                                                 std::vector<uint32_t>& indices,
+                                                 const std::vector<IndexRange>& ranges) {
+        Stats stats {
+            .verticesBefore = static_cast<uint32_t>(vertices.size()),
+            .triangles = static_cast<uint32_t>(indices.size() / 3),
+            .acmrBefore = computeACMR(indices, static_cast<uint32_t>(vertices.size())),
+        };
+        deduplicateVertices(vertices, indices);
+        for (const auto& range : ranges) {
+            optimizeVertexCache(indices.data() + range.first, range.count);
+            optimizeOverdraw(indices.data() + range.first, range.count, vertices);
+        }
+        optimizeVertexFetch(vertices, indices);
+        stats.verticesAfter = static_cast<uint32_t>(vertices.size());
+        stats.acmrAfter = computeACMR(indices, static_cast<uint32_t>(vertices.size()));
+        return stats;
+    }
+
+    // https://github.com/zeux/meshoptimizer/blob/master/src/vcacheanalyzer.cpp
+    float MeshOptimizer::computeACMR(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+        if (indices.size() < 3) { return 0.0f; }
+        std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+        uint32_t timestamp = cacheSize + 1;
+        uint32_t misses = 0;
+        for (auto index : indices) {
+            if (timestamp - cacheTimestamps[index] > cacheSize) {
+                cacheTimestamps[index] = timestamp++;
+                misses += 1;
+            }
+        }
+        return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    }
+
+    void MeshOptimizer::deduplicateVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+        std::unordered_map<Vertex, uint32_t> uniqueVertices;
+        uniqueVertices.reserve(vertices.size());
+        std::vector<Vertex> newVertices;
+        newVertices.reserve(vertices.size());
+        std::vector<uint32_t> remap(vertices.size());
+        for (uint32_t i = 0; i < vertices.size(); i++) {
+            auto [it, inserted] = uniqueVertices.try_emplace(vertices[i], static_cast<uint32_t>(newVertices.size()));
+            if (inserted) {
+                newVertices.push_back(vertices[i]);
+            }
+            remap[i] = it->second;
+        }
+        for (auto& index : indices) {
+            index = remap[index];
+        }
+        vertices = std::move(newVertices);
+    }
+
+    // https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+    void MeshOptimizer::optimizeVertexCache(uint32_t* indices, uint32_t indexCount) {
+        constexpr int32_t MAX_CACHE_SIZE = 32;
+        constexpr float CACHE_DECAY_POWER = 1.5f;
+        constexpr float LAST_TRI_SCORE = 0.75f;
+        constexpr float VALENCE_BOOST_SCALE = 2.0f;
+        constexpr float VALENCE_BOOST_POWER = 0.5f;
+        const auto triangleCount = indexCount / 3;
+        if (triangleCount < 2) { return; }
+
+        // work with indices local to the range
+        const auto [minIt, maxIt] = std::minmax_element(indices, indices + indexCount);
+        const uint32_t base = *minIt;
+        const uint32_t vertexCount = *maxIt - base + 1;
+
+        // vertex -> triangles adjacency
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for (uint32_t i = 0; i < indexCount; i++) {
+            liveTriangles[indices[i] - base] += 1;
+        }
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+        }
+        std::vector<uint32_t> adjacency(indexCount);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t t = 0; t < triangleCount; t++) {
+                for (uint32_t k = 0; k < 3; k++) {
+                    adjacency[fill[indices[t * 3 + k] - base]++] = t;
+                }
+            }
+        }
+
+        const auto vertexScore = [&](int32_t cachePosition, uint32_t live) {
+            if (live == 0) { return -1.0f; }
+            float score = 0.0f;
+            if (cachePosition >= 0) {
+                if (cachePosition < 3) {
+                    score = LAST_TRI_SCORE;
+                } else {
+                    const float scaler = 1.0f / static_cast<float>(MAX_CACHE_SIZE - 3);
+                    score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+                }
+            }
+            return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(live), -VALENCE_BOOST_POWER);
+        };
+
+        std::vector<int32_t> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            vertexScores[v] = vertexScore(-1, liveTriangles[v]);
+        }
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            triangleScores[t] = vertexScores[indices[t * 3] - base] +
+                                vertexScores[indices[t * 3 + 1] - base] +
+                                vertexScores[indices[t * 3 + 2] - base];
+        }
+
+        std::vector<uint32_t> output;
+        output.reserve(indexCount);
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> newCache;
+        cache.reserve(MAX_CACHE_SIZE + 3);
+        newCache.reserve(MAX_CACHE_SIZE + 3);
+        uint32_t scanCursor = 0;
+        auto bestTriangle = static_cast<uint32_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+
+        for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+            if (bestTriangle == UINT32_MAX) {
+                // nothing adjacent in the cache : take the next triangle in the input order
+                while (emitted[scanCursor]) { scanCursor += 1; }
+                bestTriangle = scanCursor;
+            }
+            emitted[bestTriangle] = true;
+            const uint32_t* triangle = &indices[bestTriangle * 3];
+            for (uint32_t k = 0; k < 3; k++) {
+                const auto v = triangle[k] - base;
+                output.push_back(triangle[k]);
+                // remove the triangle from the vertex live triangles list
+                auto* first = &adjacency[adjacencyOffsets[v]];
+                auto* last = first + liveTriangles[v];
+                std::iter_swap(std::find(first, last, bestTriangle), last - 1);
+                liveTriangles[v] -= 1;
+            }
+
+            // LRU cache update, the new triangle goes in front
+            newCache.clear();
+            for (uint32_t k = 0; k < 3; k++) {
+                newCache.push_back(triangle[k] - base);
+            }
+            for (auto v : cache) {
+                if (v != newCache[0] && v != newCache[1] && v != newCache[2]) {
+                    newCache.push_back(v);
+                }
+            }
+            for (uint32_t i = 0; i < newCache.size(); i++) {
+                const auto v = newCache[i];
+                cachePositions[v] = i < MAX_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+                vertexScores[v] = vertexScore(cachePositions[v], liveTriangles[v]);
+            }
+
+            // update the scores of the triangles touching the cache and find the best one
+            bestTriangle = UINT32_MAX;
+            float bestScore = -1.0f;
+            for (auto v : newCache) {
+                for (uint32_t i = 0; i < liveTriangles[v]; i++) {
+                    const auto t = adjacency[adjacencyOffsets[v] + i];
+                    const float score = vertexScores[indices[t * 3] - base] +
+                                        vertexScores[indices[t * 3 + 1] - base] +
+                                        vertexScores[indices[t * 3 + 2] - base];
+                    triangleScores[t] = score;
+                    if (score > bestScore) {
+                        bestScore = score;
+                        bestTriangle = t;
+                    }
+                }
+            }
+            if (newCache.size() > MAX_CACHE_SIZE) {
+                newCache.resize(MAX_CACHE_SIZE);
+            }
+            std::swap(cache, newCache);
+        }
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    // https://gfx.cs.princeton.edu/pubs/Sander_2007_%3ETR/tipsy.pdf
+    // https://github.com/zeux/meshoptimizer/blob/master/src/overdrawoptimizer.cpp
+    void MeshOptimizer::optimizeOverdraw(uint32_t* indices, uint32_t indexCount, const std::vector<Vertex>& vertices, float threshold) {
+        const auto triangleCount = indexCount / 3;
+        if (triangleCount < 2) { return; }
+
+        // simulate the cache to find the cluster boundaries
+        std::unordered_map<uint32_t, uint32_t> cacheTimestamps;
+        cacheTimestamps.reserve(indexCount);
+        uint32_t timestamp = CACHE_SIZE + 1;
+        const auto triangleMisses = [&](uint32_t t) {
+            uint32_t misses = 0;
+            for (uint32_t k = 0; k < 3; k++) {
+                auto& time = cacheTimestamps[indices[t * 3 + k]];
+                if (timestamp - time > CACHE_SIZE) {
+                    time = timestamp++;
+                    misses += 1;
+                }
+            }
+            return misses;
+        };
+
+        // hard boundaries : triangles where the cache is fully flushed
+        std::vector<uint32_t> hardClusters;
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            if (triangleMisses(t) == 3) {
+                hardClusters.push_back(t);
+            }
+        }
+        hardClusters.push_back(triangleCount);
+
+        // soft boundaries : split the hard clusters where the ACMR stays in the threshold
+        std::vector<uint32_t> clusters;
+        for (uint32_t c = 0; c + 1 < hardClusters.size(); c++) {
+            const auto start = hardClusters[c];
+            const auto end = hardClusters[c + 1];
+            cacheTimestamps.clear();
+            uint32_t clusterMisses = 0;
+            for (uint32_t t = start; t < end; t++) {
+                clusterMisses += triangleMisses(t);
+            }
+            const float clusterACMR = static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+            clusters.push_back(start);
+            cacheTimestamps.clear();
+            uint32_t misses = 0;
+            uint32_t softStart = start;
+            for (uint32_t t = start; t < end; t++) {
+                misses += triangleMisses(t);
+                const float acmr = static_cast<float>(misses) / static_cast<float>(t + 1 - softStart);
+                if ((t + 1 < end) && (acmr <= clusterACMR * threshold)) {
+                    clusters.push_back(t + 1);
+                    cacheTimestamps.clear();
+                    misses = 0;
+                    softStart = t + 1;
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        // sort clusters by the dot product between the cluster normal and the direction from the mesh centroid
+        glm::vec3 meshCentroid{0.0f};
+        for (uint32_t i = 0; i < indexCount; i++) {
+            meshCentroid += vertices[indices[i]].position;
+        }
+        meshCentroid /= static_cast<float>(indexCount);
+        const auto clusterCount = static_cast<uint32_t>(clusters.size() - 1);
+        std::vector<float> sortKeys(clusterCount);
+        for (uint32_t c = 0; c < clusterCount; c++) {
+            glm::vec3 centroid{0.0f};
+            glm::vec3 normal{0.0f};
+            float area = 0.0f;
+            for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+                const auto& p0 = vertices[indices[t * 3]].position;
+                const auto& p1 = vertices[indices[t * 3 + 1]].position;
+                const auto& p2 = vertices[indices[t * 3 + 2]].position;
+                const auto n = glm::cross(p1 - p0, p2 - p0);
+                const auto triangleArea = glm::length(n);
+                centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+                normal += n;
+                area += triangleArea;
+            }
+            if (area > 0.0f) { centroid /= area; }
+            const auto normalLength = glm::length(normal);
+            sortKeys[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+        }
+        std::vector<uint32_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<uint32_t> output;
+        output.reserve(indexCount);
+        for (auto c : order) {
+            output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+        }
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+        std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+        std::vector<Vertex> newVertices;
+        newVertices.reserve(vertices.size());
+        for (auto& index : indices) {
+            if (remap[index] == UINT32_MAX) {
+                remap[index] = static_cast<uint32_t>(newVertices.size());
+                newVertices.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices = std::move(newVertices);
+    }
+
+    std::vector<uint32_t> MeshOptimizer::simplify(const std::vector<Vertex>& vertices,
+                                                  const uint32_t* indices, uint32_t indexCount,
+                                                  uint32_t targetIndexCount, float targetError, float& resultError) {
+        resultError = 0.0f;
+        if (indexCount <= targetIndexCount) {
+            return {indices, indices + indexCount};
+        }
+        // work with indices local to the range
+        const auto [minIt, maxIt] = std::minmax_element(indices, indices + indexCount);
+        const uint32_t base = *minIt;
+        const uint32_t vertexCount = *maxIt - base + 1;
+        std::vector<uint32_t> triangles(indexCount);
+        for (uint32_t i = 0; i < indexCount; i++) {
+            triangles[i] = indices[i] - base;
+        }
+        const auto position = [&](uint32_t v) -> const glm::vec3& { return vertices[v + base].position; };
+
+        // The collapses move all the vertices sharing a position (the wedges of a position) at once
+        std::vector<uint32_t> groups(vertexCount, UINT32_MAX);
+        std::vector<std::vector<uint32_t>> groupVertices;
+        {
+            std::unordered_map<glm::vec3, uint32_t> positions;
+            for (auto v : triangles) {
+                if (groups[v] != UINT32_MAX) { continue; }
+                auto [it, inserted] = positions.try_emplace(position(v), static_cast<uint32_t>(groupVertices.size()));
+                if (inserted) { groupVertices.emplace_back(); }
+                groups[v] = it->second;
+                groupVertices[it->second].push_back(v);
+            }
+        }
+        const auto groupCount = static_cast<uint32_t>(groupVertices.size());
+        const auto groupPosition = [&](uint32_t g) -> const glm::vec3& { return position(groupVertices[g][0]); };
+
+        // Positions on a border or on a non-manifold edge must not move
+        std::vector<bool> locked(groupCount, false);
+        {
+            std::unordered_map<uint64_t, uint32_t> edges;
+            edges.reserve(indexCount);
+            const auto edgeKey = [&](uint32_t a, uint32_t b) {
+                a = groups[a];
+                b = groups[b];
+                return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+            };
+            for (uint32_t i = 0; i < indexCount; i += 3) {
+                for (uint32_t k = 0; k < 3; k++) {
+                    edges[edgeKey(triangles[i + k], triangles[i + (k + 1) % 3])] += 1;
+                }
+            }
+            for (uint32_t i = 0; i < indexCount; i += 3) {
+                for (uint32_t k = 0; k < 3; k++) {
+                    const auto a = triangles[i + k];
+                    const auto b = triangles[i + (k + 1) % 3];
+                    if (edges[edgeKey(a, b)] != 2) {
+                        locked[groups[a]] = true;
+                        locked[groups[b]] = true;
+                    }
+                }
+            }
+        }
+
+        // vertex -> triangles adjacency, the removed triangles are skipped
+        const auto triangleCount = indexCount / 3;
+        std::vector<bool> removed(triangleCount, false);
+        std::vector<std::vector<uint32_t>> adjacency(vertexCount);
+        std::vector<Quadric> quadrics(groupCount);
+        auto remainingTriangles = triangleCount;
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            const auto* triangle = &triangles[t * 3];
+            if ((groups[triangle[0]] == groups[triangle[1]]) || (groups[triangle[1]] == groups[triangle[2]]) ||
+                (groups[triangle[0]] == groups[triangle[2]])) {
+                removed[t] = true;
+                remainingTriangles -= 1;
+                continue;
+            }
+            for (uint32_t k = 0; k < 3; k++) { adjacency[triangle[k]].push_back(t); }
+            const auto& p0 = position(triangle[0]);
+            const auto n = glm::cross(position(triangle[1]) - p0, position(triangle[2]) - p0);
+            const auto length = glm::length(n);
+            if (length == 0.0f) { continue; }
+            const auto normal = n / length;
+            const auto d = -glm::dot(normal, p0);
+            for (uint32_t k = 0; k < 3; k++) {
+                quadrics[groups[triangle[k]]].addPlane(normal, d);
+            }
+        }
+
+        // Attributes seams : a wedge of the collapsed position without a wedge of the target position in its
+        // triangles is moved to the target wedge with the closest attributes. The attributes discontinuity is
+        // added to the cost, weighted relative to the size of the range, instead of locking the seams
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
+        for (uint32_t g = 0; g < groupCount; g++) {
+            boundsMin = glm::min(boundsMin, groupPosition(g));
+            boundsMax = glm::max(boundsMax, groupPosition(g));
+        }
+        // a range without extent would divide the penalties by zero
+        const auto seamWeight = std::max(static_cast<double>(SEAM_PENALTY * glm::distance(boundsMin, boundsMax) * 0.5f),
+                                         MIN_SEAM_WEIGHT);
+        const auto attributesDistance = [&](uint32_t a, uint32_t b) {
+            const auto& va = vertices[a + base];
+            const auto& vb = vertices[b + base];
+            const auto normal = va.normal - vb.normal;
+            const auto uv = va.uv - vb.uv;
+            return static_cast<double>(glm::dot(normal, normal) + glm::dot(uv, uv));
+        };
+        // wedge of the target position replacing a wedge of the collapsed position, the search stops
+        // when the penalty exceeds the maximum cost
+        std::vector<uint32_t> targetWedges(vertexCount);
+        const auto findTargetWedges = [&](uint32_t from, uint32_t to, double maxPenalty) {
+            const auto maxDistance = maxPenalty / (seamWeight * seamWeight);
+            double penalty = 0.0;
+            for (auto v : groupVertices[from]) {
+                auto target = UINT32_MAX;
+                for (auto t : adjacency[v]) {
+                    if (removed[t]) { continue; }
+                    for (uint32_t k = 0; (k < 3) && (target == UINT32_MAX); k++) {
+                        if (groups[triangles[t * 3 + k]] == to) { target = triangles[t * 3 + k]; }
+                    }
+                    if (target != UINT32_MAX) { break; }
+                }
+                if (target == UINT32_MAX) {
+                    auto closest = std::numeric_limits<double>::max();
+                    for (auto w : groupVertices[to]) {
+                        const auto distance = attributesDistance(v, w);
+                        if (distance < closest) {
+                            closest = distance;
+                            target = w;
+                        }
+                    }
+                    penalty = std::max(penalty, closest);
+                    if (penalty > maxDistance) { break; }
+                }
+                targetWedges[v] = target;
+            }
+            return penalty * seamWeight * seamWeight;
+        };
+
+        // Greedy collapses, cheapest first. The entries of the heap are invalidated lazily : the target position of
+        // a collapse gets a new version and new entries, the entries of the previous versions are skipped.
+        // The other costs do not change, the triangles of the other positions only reference the target instead
+        // of the collapsed position
+        const double maxCost = static_cast<double>(targetError) * static_cast<double>(targetError);
+        struct Collapse {
+            double cost;
+            // geometric part of the cost, without the seam penalty
+            double error;
+            uint32_t from;
+            uint32_t to;
+            uint32_t fromVersion;
+            uint32_t toVersion;
+            bool operator>(const Collapse& other) const { return cost > other.cost; }
+        };
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> heap;
+        std::vector<uint32_t> versions(groupCount, 0);
+        std::vector<bool> alive(groupCount, true);
+        std::vector<uint32_t> neighbors;
+        const auto getNeighbors = [&](uint32_t g) {
+            neighbors.clear();
+            for (auto v : groupVertices[g]) {
+                for (auto t : adjacency[v]) {
+                    if (removed[t]) { continue; }
+                    for (uint32_t k = 0; k < 3; k++) {
+                        const auto n = groups[triangles[t * 3 + k]];
+                        if (n != g) { neighbors.push_back(n); }
+                    }
+                }
+            }
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        };
+        // the collapses above the maximum cost are never applied and not pushed
+        const auto pushCollapse = [&](uint32_t from, uint32_t to) {
+            if (locked[from]) { return; }
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            const auto error = q.error(groupPosition(to));
+            if (error > maxCost) { return; }
+            const auto cost = error + findTargetWedges(from, to, maxCost - error);
+            if (cost > maxCost) { return; }
+            heap.push({cost, error, from, to, versions[from], versions[to]});
+        };
+        for (uint32_t g = 0; g < groupCount; g++) {
+            getNeighbors(g);
+            for (auto n : neighbors) { pushCollapse(g, n); }
+        }
+
+        double reachedError = 0.0;
+        const auto targetTriangles = targetIndexCount / 3;
+        while (!heap.empty() && (remainingTriangles > targetTriangles)) {
+            const auto collapse = heap.top();
+            heap.pop();
+            if (!alive[collapse.from] || !alive[collapse.to] ||
+                (versions[collapse.from] != collapse.fromVersion) || (versions[collapse.to] != collapse.toVersion)) {
+                continue;
+            }
+            // reject the collapse if it flips a triangle, the entry is pushed again when the neighborhood changes
+            findTargetWedges(collapse.from, collapse.to, std::numeric_limits<double>::max());
+            const auto& target = groupPosition(collapse.to);
+            bool flip = false;
+            for (auto v : groupVertices[collapse.from]) {
+                for (auto t : adjacency[v]) {
+                    if (removed[t]) { continue; }
+                    const auto* triangle = &triangles[t * 3];
+                    glm::vec3 p[3];
+                    glm::vec3 moved[3];
+                    bool collapsed = false;
+                    for (uint32_t k = 0; k < 3; k++) {
+                        collapsed |= groups[triangle[k]] == collapse.to;
+                        p[k] = position(triangle[k]);
+                        moved[k] = triangle[k] == v ? target : p[k];
+                    }
+                    if (collapsed) { continue; }
+                    const auto before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    const auto after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                    if (glm::dot(before, after) <= 0.0f) {
+                        flip = true;
+                        break;
+                    }
+                }
+                if (flip) { break; }
+            }
+            if (flip) { continue; }
+
+            // move the wedges and remove the triangles collapsed to a segment
+            for (auto v : groupVertices[collapse.from]) {
+                const auto w = targetWedges[v];
+                for (auto t : adjacency[v]) {
+                    if (removed[t]) { continue; }
+                    auto* triangle = &triangles[t * 3];
+                    for (uint32_t k = 0; k < 3; k++) {
+                        if (triangle[k] == v) { triangle[k] = w; }
+                    }
+                    if ((groups[triangle[0]] == groups[triangle[1]]) || (groups[triangle[1]] == groups[triangle[2]]) ||
+                        (groups[triangle[0]] == groups[triangle[2]])) {
+                        removed[t] = true;
+                        remainingTriangles -= 1;
+                    } else {
+                        adjacency[w].push_back(t);
+                    }
+                }
+                adjacency[v].clear();
+            }
+            for (auto w : groupVertices[collapse.to]) {
+                std::erase_if(adjacency[w], [&](uint32_t t) { return removed[t]; });
+            }
+            quadrics[collapse.to] += quadrics[collapse.from];
+            alive[collapse.from] = false;
+            reachedError = std::max(reachedError, collapse.error);
+
+            // new costs around the target position
+            versions[collapse.to] += 1;
+            getNeighbors(collapse.to);
+            for (auto n : neighbors) {
+                pushCollapse(collapse.to, n);
+                pushCollapse(n, collapse.to);
+            }
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(remainingTriangles * 3);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            if (!removed[t]) {
+                result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+            }
+        }
+        triangles = std::move(result);
+
+        resultError = static_cast<float>(std::sqrt(reachedError));
+        for (auto& index : triangles) {
+            index += base;
+        }
+        return triangles;
+    }
+
+    // Greedy scan : a new meshlet starts when the next triangle does not fit in the current one.
+    // The vertex cache order keeps the triangles of a meshlet spatially close.
+    std::vector<MeshOptimizer::Meshlet> MeshOptimizer::buildMeshlets(const std::vector<Vertex>& vertices,
+                                                                      const uint32_t* indices,
+                                                                      uint32_t firstIndex, uint32_t indexCount) {
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> meshletVertices;
+        meshletVertices.reserve(MESHLET_MAX_VERTICES);
+        const auto lastIndex = firstIndex + indexCount - (indexCount % 3);
+        uint32_t meshletStart = firstIndex;
+        for (uint32_t i = firstIndex; i < lastIndex; i += 3) {
+            uint32_t newVertices = 0;
+            for (uint32_t j = 0; j < 3; j++) {
+                if (std::find(meshletVertices.begin(), meshletVertices.end(), indices[i + j]) == meshletVertices.end()) {
+                    newVertices += 1;
+                }
+            }
+            if (((meshletVertices.size() + newVertices) > MESHLET_MAX_VERTICES) ||
+                (((i - meshletStart) / 3) >= MESHLET_MAX_TRIANGLES)) {
+                meshlets.push_back(computeMeshletBounds(vertices, indices, meshletStart, i - meshletStart));
+                meshletStart = i;
+                meshletVertices.clear();
+            }
+            for (uint32_t j = 0; j < 3; j++) {
+                if (std::find(meshletVertices.begin(), meshletVertices.end(), indices[i + j]) == meshletVertices.end()) {
+                    meshletVertices.push_back(indices[i + j]);
+                }
+            }
+        }
+        if (lastIndex > meshletStart) {
+            meshlets.push_back(computeMeshletBounds(vertices, indices, meshletStart, lastIndex - meshletStart));
+        }
+        return meshlets;
+    }
+
+    // Bounding sphere from the bounding box center, and normal cone of the triangles normals.
+    // The apex is moved back along the axis so that the backface test is conservative for all the triangles.
+    MeshOptimizer::Meshlet MeshOptimizer::computeMeshletBounds(const std::vector<Vertex>& vertices,
+                                                               const uint32_t* indices,
+                                                               uint32_t firstIndex, uint32_t indexCount) {
+        Meshlet meshlet{
+            .firstIndex = firstIndex,
+            .indexCount = indexCount,
+            .center = vertices[indices[firstIndex]].position,
+            .radius = 0.0f,
+            .coneApex = glm::vec3{0.0f},
+            .coneAxis = glm::vec3{0.0f},
+            .coneCutoff = 1.0f,
+        };
+        glm::vec3 min{meshlet.center};
+        glm::vec3 max{meshlet.center};
+        for (uint32_t i = firstIndex; i < (firstIndex + indexCount); i++) {
+            min = glm::min(min, vertices[indices[i]].position);
+            max = glm::max(max, vertices[indices[i]].position);
+        }
+        meshlet.center = (min + max) * 0.5f;
+        for (uint32_t i = firstIndex; i < (firstIndex + indexCount); i++) {
+            meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, vertices[indices[i]].position));
+        }
+
+        // unit normals of the non degenerated triangles
+        std::vector<std::pair<glm::vec3, glm::vec3>> triangles;
+        triangles.reserve(indexCount / 3);
+        glm::vec3 axis{0.0f};
+        for (uint32_t i = firstIndex; i < (firstIndex + indexCount); i += 3) {
+            const auto& p0 = vertices[indices[i]].position;
+            const auto normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+            const auto area = glm::length(normal);
+            if (area > 0.0f) {
+                triangles.push_back({p0, normal / area});
+                axis += normal / area;
+            }
+        }
+        if (triangles.empty() || (glm::length(axis) == 0.0f)) {
+            return meshlet;
+        }
+        axis = glm::normalize(axis);
+        float minDot = 1.0f;
+        for (const auto& triangle : triangles) {
+            minDot = std::min(minDot, glm::dot(axis, triangle.second));
+        }
+        // cone too wide to ever be entirely backfacing
+        if (minDot <= 0.1f) {
+            return meshlet;
+        }
+        float maxDistance = 0.0f;
+        for (const auto& [p0, normal] : triangles) {
+            maxDistance = std::max(maxDistance, glm::dot(meshlet.center - p0, normal) / glm::dot(axis, normal));
+        }
+        meshlet.coneApex = meshlet.center - axis * maxDistance;
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        return meshlet;
+    }
+
+}
@@ -0,0 +1,26 @@
+#include "z0/utils/parallel_for.hpp"
+#include "z0/utils/job_system.hpp"
+
+#include <algorithm>
+
+namespace z0 {
+
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& function) {
+        parallelFor(count, 1, [&](uint32_t begin, uint32_t end) {
+            for (auto index = begin; index < end; index++) {
+                function(index);
+            }
+        });
+    }
+
+    void parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& function) {
+        auto& jobSystem = JobSystem::get();
+        JobCounter counter;
+        for (uint32_t begin = 0; begin < count; begin += chunkSize) {
+            const auto end = std::min(begin + chunkSize, count);
+            jobSystem.run(counter, [&function, begin, end] { function(begin, end); });
+        }
+        jobSystem.wait(counter);
+    }
+
+}
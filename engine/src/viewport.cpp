@@ -4,6 +4,9 @@
 #include "z0/application.hpp"
 #include "z0/log.hpp"
 
+#include <chrono>
+#include <format>
+
 namespace z0 {
 
     static const std::map<MSAA, VkSampleCountFlagBits> MSAA_VULKAN {
@@ -25,7 +28,9 @@ namespace z0 {
                 instance,
                 window,
                 cfg.msaa == MSAA_AUTO,
-                MSAA_VULKAN.at(cfg.msaa));
+                MSAA_VULKAN.at(cfg.msaa),
+                cfg.shaderCacheDir);
+        vulkanDevice->getResidency().setBudget(static_cast<VkDeviceSize>(cfg.videoMemoryBudget) * 1024 * 1024);
         const std::string sDir{(cfg.appDir / "shaders").string()};
         sceneRenderer = std::make_shared<SceneRenderer>(*vulkanDevice, sDir);
         tonemappingRenderer = std::make_shared<TonemappingRenderer>(*vulkanDevice,
@@ -36,18 +41,67 @@ namespace z0 {
                                                                                 sDir,
                                                                                 "grayscale",
                                                                                 tonemappingRenderer->getColorAttachment());
-        vulkanDevice->registerRenderer(postprocessingRenderer);*/
-        vulkanDevice->registerRenderer(tonemappingRenderer);
+        vulkanDevice->registerRenderer(postprocessingRenderer);
+        vulkanDevice->setOutputRenderer(postprocessingRenderer);*/
         vulkanDevice->registerRenderer(sceneRenderer);
+        vulkanDevice->registerRenderer(tonemappingRenderer);
+        vulkanDevice->setOutputRenderer(tonemappingRenderer);
+        inputTime = std::chrono::steady_clock::now();
+        if (cfg.pipelinedRendering) {
+            renderThread = std::jthread{&Viewport::renderLoop, this};
+        }
+    }
+
+    Viewport::~Viewport() {
+        if (!renderThread.joinable()) return;
+        waitRenderThread();
+        stopRendering.store(true, std::memory_order_release);
+        preparedFrames.fetch_add(1, std::memory_order_release);
+        preparedFrames.notify_one();
+        renderThread.join();
     }
 
     void Viewport::wait() {
+        waitRenderThread();
         vulkanDevice->wait();
     }
 
     void Viewport::drawFrame() {
+        // the previous frame have been recorded, the nodes can be read by the snapshot
+        waitRenderThread();
+        // the input events polled by the previous frame have been consumed by the nodes
+        const auto snapshotInputTime = inputTime;
         window.process();
-        vulkanDevice->drawFrame();
+        inputTime = std::chrono::steady_clock::now();
+        if (!vulkanDevice->prepareFrame(snapshotInputTime)) return;
+        if (renderThread.joinable()) {
+            preparedFrames.fetch_add(1, std::memory_order_release);
+            preparedFrames.notify_one();
+        } else {
+            vulkanDevice->renderFrame();
+        }
+    }
+
+    void Viewport::renderLoop() {
+        uint64_t renderedFrame{0};
+        while (true) {
+            // wait for the next snapshot
+            preparedFrames.wait(renderedFrame, std::memory_order_acquire);
+            if (stopRendering.load(std::memory_order_acquire)) return;
+            vulkanDevice->renderFrame();
+            renderedFrame += 1;
+            renderedFrames.store(renderedFrame, std::memory_order_release);
+            renderedFrames.notify_one();
+        }
+    }
+
+    void Viewport::waitRenderThread() {
+        const auto preparedFrame = preparedFrames.load(std::memory_order_relaxed);
+        auto renderedFrame = renderedFrames.load(std::memory_order_acquire);
+        while (renderedFrame != preparedFrame) {
+            renderedFrames.wait(renderedFrame, std::memory_order_acquire);
+            renderedFrame = renderedFrames.load(std::memory_order_acquire);
+        }
     }
 
     MSAA Viewport::getMSAA() const {
@@ -63,7 +117,13 @@ namespace z0 {
     }
 
     void Viewport::loadScene(std::shared_ptr<Node>& rootNode) {
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
         sceneRenderer->loadScene(rootNode);
+        // all the shaders are created at this point, cold (empty cache) or warm startup
+        vulkanDevice->getShaderCache().logStats();
+        log("scene renderers loaded in", std::format("{:.1f} ms",
+                                                     std::chrono::duration<double, std::milli>(Clock::now() - start).count()));
     }
 
 }
\ No newline at end of file
@@ -3,13 +3,16 @@
 namespace z0 {
 
     void BaseFrameBuffer::cleanupImagesResources() {
-        if (imageMemory != VK_NULL_HANDLE) {
+        if (image != VK_NULL_HANDLE) {
             vkDestroyImageView(vulkanDevice.getDevice(), imageView, nullptr);
-            vkDestroyImage(vulkanDevice.getDevice(), image, nullptr);
-            vkFreeMemory(vulkanDevice.getDevice(), imageMemory, nullptr);
+            if (allocation != VK_NULL_HANDLE) {
+                vulkanDevice.destroyImage(image, allocation);
+            } else {
+                vulkanDevice.destroyAliasedImage(image);
+            }
             imageView = VK_NULL_HANDLE;
             image = VK_NULL_HANDLE;
-            imageMemory = VK_NULL_HANDLE;
+            allocation = VK_NULL_HANDLE;
         }
     }
 
@@ -18,7 +21,17 @@ namespace z0 {
                                       VkFormat format,
                                       VkSampleCountFlagBits samples,
                                       VkImageUsageFlags usage,
-                                      VkImageAspectFlags flags) {
+                                      VkImageAspectFlags flags,
+                                      MemoryCategory category) {
+        imageFormat = format;
+        // the transient attachments are lazily allocated when supported, in the tile memory.
+        // Falls back to an own allocation if the image does not fit in the slot
+        const auto lazy = vulkanDevice.isLazilyAllocatedSupported() && (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+        if ((aliasingSlot != NO_ALIASING) && !lazy &&
+            vulkanDevice.createAliasedImage(aliasingSlot, width, height, samples, format, usage, image)) {
+            imageView = vulkanDevice.createImageView(image, format,flags,1);
+            return;
+        }
         vulkanDevice.createImage(width,
                                  height,
                                  1,
@@ -26,8 +39,8 @@ namespace z0 {
                                  format,
                                  VK_IMAGE_TILING_OPTIMAL,
                                  usage,
-                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                 image, imageMemory);
+                                 category,
+                                 image, allocation);
         imageView = vulkanDevice.createImageView(image, format,flags,1);
     }
 
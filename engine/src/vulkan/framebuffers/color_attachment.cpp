@@ -3,8 +3,8 @@
 
 namespace z0 {
 
-    ColorAttachment::ColorAttachment(VulkanDevice &dev, bool _multisampled) :
-        BaseFrameBuffer{dev}, multisampled{_multisampled} {
+    ColorAttachment::ColorAttachment(VulkanDevice &dev, bool _multisampled, uint32_t aliasingSlot) :
+        BaseFrameBuffer{dev, aliasingSlot}, multisampled{_multisampled} {
          createImagesResources();
      }
 
@@ -14,7 +14,8 @@ namespace z0 {
                     vulkanDevice.getSwapChainExtent().height,
                     multisampled ? ColorAttachmentHDR::renderFormat : vulkanDevice.getSwapChainImageFormat(),
                     multisampled ? vulkanDevice.getSamples() : VK_SAMPLE_COUNT_1_BIT,
-                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+                    multisampled ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT :
+                                   VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
     }
 
 }
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 namespace z0 {
 
-    ColorAttachmentHDR::ColorAttachmentHDR(VulkanDevice &dev) : BaseFrameBuffer{dev } {
+    ColorAttachmentHDR::ColorAttachmentHDR(VulkanDevice &dev, uint32_t aliasingSlot) : BaseFrameBuffer{dev, aliasingSlot} {
          createImagesResources();
      }
 
@@ -29,7 +29,9 @@ namespace z0 {
                     vulkanDevice.getSwapChainExtent().height,
                     renderFormat,
                     VK_SAMPLE_COUNT_1_BIT, // Always resolved, only used for post-processing or display
-                    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+                    // storage for the deferred renderer lighting pass
+                    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                    VK_IMAGE_USAGE_STORAGE_BIT);
 
         VkPhysicalDeviceProperties properties{};
         vkGetPhysicalDeviceProperties(vulkanDevice.getPhysicalDevice(), &properties);
@@ -3,7 +3,10 @@
 
 namespace z0 {
 
-    DepthBuffer::DepthBuffer(VulkanDevice &dev, bool _multisampled) : BaseFrameBuffer{dev}, multisampled{_multisampled} {
+    DepthBuffer::DepthBuffer(VulkanDevice &dev, bool _multisampled) :
+        BaseFrameBuffer{dev},
+        multisampled{_multisampled},
+        transient{_multisampled && dev.isLazilyAllocatedSupported()} {
          createImagesResources();
      }
 
@@ -16,7 +19,9 @@ namespace z0 {
                             VK_IMAGE_TILING_OPTIMAL,
                             VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT),
                     multisampled ? vulkanDevice.getSamples() : VK_SAMPLE_COUNT_1_BIT,
-                    multisampled ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                    // the multisampled buffer is sampled by the Hi-Z pyramid build
+                    transient ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT :
+                                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                     VK_IMAGE_ASPECT_DEPTH_BIT);
     }
 
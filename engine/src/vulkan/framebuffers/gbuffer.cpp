@@ -0,0 +1,42 @@
+#include "z0/vulkan/framebuffers/gbuffer.hpp"
+
+namespace z0 {
+
+    GBufferAttachment::GBufferAttachment(VulkanDevice &dev, VkFormat _format, bool _multisampled, uint32_t aliasingSlot) :
+        BaseFrameBuffer{dev, aliasingSlot}, format{_format}, multisampled{_multisampled} {
+        createImagesResources();
+    }
+
+    void GBufferAttachment::createImagesResources() {
+        createImage(vulkanDevice.getSwapChainExtent().width,
+                    vulkanDevice.getSwapChainExtent().height,
+                    format,
+                    multisampled ? vulkanDevice.getSamples() : VK_SAMPLE_COUNT_1_BIT,
+                    // the multisampled attachments are only used inside the geometry pass
+                    multisampled ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT :
+                                   VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    }
+
+    GBuffer::GBuffer(VulkanDevice &dev, uint32_t albedoAliasingSlot) {
+        for (uint32_t i = 0; i < ATTACHMENTS_COUNT; i++) {
+            attachments[i] = std::make_unique<GBufferAttachment>(dev, formats[i], true);
+            resolvedAttachments[i] = std::make_unique<GBufferAttachment>(dev, formats[i], false,
+                                                                         i == ALBEDO ? albedoAliasingSlot : BaseFrameBuffer::NO_ALIASING);
+        }
+    }
+
+    void GBuffer::createImagesResources() {
+        for (uint32_t i = 0; i < ATTACHMENTS_COUNT; i++) {
+            attachments[i]->createImagesResources();
+            resolvedAttachments[i]->createImagesResources();
+        }
+    }
+
+    void GBuffer::cleanupImagesResources() {
+        for (uint32_t i = 0; i < ATTACHMENTS_COUNT; i++) {
+            attachments[i]->cleanupImagesResources();
+            resolvedAttachments[i]->cleanupImagesResources();
+        }
+    }
+
+}
@@ -0,0 +1,123 @@
+#include "z0/vulkan/framebuffers/shadow_atlas.hpp"
+#include "z0/application.hpp"
+#include "z0/log.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace z0 {
+
+    ShadowAtlas::ShadowAtlas(VulkanDevice &dev) :
+        BaseFrameBuffer{dev} {
+        createImagesResources();
+    }
+
+    bool ShadowAtlas::allocate(std::vector<Tile>& tiles) {
+        std::vector<uint32_t> order(tiles.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return tiles[a].size > tiles[b].size;
+        });
+        uint64_t offset = 0;
+        for (const auto index : order) {
+            auto& tile = tiles[index];
+            tile.x = 0;
+            tile.y = 0;
+            for (uint32_t bit = 0; bit < 16; bit++) {
+                tile.x |= static_cast<uint32_t>((offset >> (2 * bit)) & 1) << bit;
+                tile.y |= static_cast<uint32_t>((offset >> (2 * bit + 1)) & 1) << bit;
+            }
+            offset += static_cast<uint64_t>(tile.size) * tile.size;
+            if (offset > static_cast<uint64_t>(SIZE) * SIZE) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string ShadowAtlas::getFilterShaderVariant() {
+        switch (Application::getConfig().shadowFilter) {
+            case SHADOW_FILTER_POISSON: return ".poisson";
+            case SHADOW_FILTER_PCSS: return ".pcss";
+            default: return "";
+        }
+    }
+
+    // https://github.com/SaschaWillems/Vulkan/blob/master/examples/shadowmapping/shadowmapping.cpp#L192
+    void ShadowAtlas::createImagesResources() {
+        // For shadow mapping we only need a depth attachment
+        auto format = vulkanDevice.findImageTilingSupportedFormat(
+                {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT,},
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        createImage(SIZE, SIZE, format, VK_SAMPLE_COUNT_1_BIT,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                    VK_IMAGE_ASPECT_DEPTH_BIT,
+                    MEMORY_SHADOW_MAPS);
+        if (Application::getConfig().shadowCaching) {
+            vulkanDevice.createImage(SIZE,
+                                     SIZE,
+                                     1,
+                                     VK_SAMPLE_COUNT_1_BIT,
+                                     format,
+                                     VK_IMAGE_TILING_OPTIMAL,
+                                     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                     MEMORY_SHADOW_MAPS,
+                                     staticImage, staticImageAllocation);
+            staticImageView = vulkanDevice.createImageView(staticImage, format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+        }
+
+        // Create sampler to sample from to depth attachment
+        // Used to sample in the fragment shader for shadowed rendering.
+        // The depth comparison is done by the sampler and, with linear filtering,
+        // the four nearest texels results are bilinearly filtered
+        // https://developer.nvidia.com/gpugems/gpugems/part-ii-lighting-and-shadows/chapter-11-shadow-map-antialiasing
+        VkFilter shadowmap_filter = vulkanDevice.formatIsFilterable( format, VK_IMAGE_TILING_OPTIMAL) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        VkSamplerCreateInfo samplerCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .magFilter = shadowmap_filter,
+            .minFilter = shadowmap_filter,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = samplerCreateInfo.addressModeU,
+            .addressModeW = samplerCreateInfo.addressModeU,
+            .mipLodBias = 0.0f,
+            .maxAnisotropy = 1.0f,
+            .compareEnable = VK_TRUE,
+            .compareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+            .minLod = 0.0f,
+            .maxLod = 1.0f,
+            .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE
+        };
+        if (vkCreateSampler(vulkanDevice.getDevice(), &samplerCreateInfo, nullptr, &sampler) != VK_SUCCESS) {
+            die("failed to create shadowmap sampler!");
+        }
+        samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+        samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+        samplerCreateInfo.compareEnable = VK_FALSE;
+        if (vkCreateSampler(vulkanDevice.getDevice(), &samplerCreateInfo, nullptr, &depthSampler) != VK_SUCCESS) {
+            die("failed to create shadowmap depth sampler!");
+        }
+    }
+
+    void ShadowAtlas::cleanupImagesResources() {
+        if (sampler != VK_NULL_HANDLE) {
+            vkDestroySampler(vulkanDevice.getDevice(), sampler, nullptr);
+            sampler = VK_NULL_HANDLE;
+        }
+        if (depthSampler != VK_NULL_HANDLE) {
+            vkDestroySampler(vulkanDevice.getDevice(), depthSampler, nullptr);
+            depthSampler = VK_NULL_HANDLE;
+        }
+        if (staticImageAllocation != VK_NULL_HANDLE) {
+            vkDestroyImageView(vulkanDevice.getDevice(), staticImageView, nullptr);
+            vulkanDevice.destroyImage(staticImage, staticImageAllocation);
+            staticImageView = VK_NULL_HANDLE;
+            staticImage = VK_NULL_HANDLE;
+            staticImageAllocation = VK_NULL_HANDLE;
+        }
+        BaseFrameBuffer::cleanupImagesResources();
+    }
+
+}
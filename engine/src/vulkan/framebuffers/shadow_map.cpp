@@ -1,15 +1,49 @@
 #include "z0/vulkan/framebuffers/shadow_map.hpp"
 #include "z0/nodes/spot_light.hpp"
 #include "z0/nodes/directional_light.hpp"
+#include "z0/application.hpp"
 #include "z0/log.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
 namespace z0 {
 
-    ShadowMap::ShadowMap(VulkanDevice &dev, Light* spotLight) : BaseFrameBuffer{dev}, light(spotLight) {
-         createImagesResources();
+    static uint32_t cascadesCountFor(Light* light) {
+        if (dynamic_cast<DirectionalLight*>(light) == nullptr) return 1;
+        return std::clamp(Application::getConfig().shadowCascades, 1u, ShadowMap::MAX_CASCADES);
+    }
+
+    ShadowMap::ShadowMap(Light* spotLight) :
+        cascadesCount{cascadesCountFor(spotLight)},
+        size{cascadesCount > 1 ? ShadowAtlas::MAX_TILE_SIZE / 2 : ShadowAtlas::MAX_TILE_SIZE},
+        light(spotLight) {
      }
 
-    glm::mat4 ShadowMap::getLightSpace() const {
+    bool ShadowMap::isDirectional() const {
+        return dynamic_cast<DirectionalLight*>(light) != nullptr;
+    }
+
+    // Practical split scheme : blend of the logarithmic and uniform splits
+    float ShadowMap::getCascadeSplit(uint32_t cascade) const {
+        if ((currentCamera == nullptr) || (dynamic_cast<DirectionalLight*>(light) == nullptr)) {
+            return std::numeric_limits<float>::max();
+        }
+        const auto& config = Application::getConfig();
+        const auto near = currentCamera->getNearDistance();
+        const auto far = std::min(currentCamera->getFarDistance(), config.shadowMaxDistance);
+        const auto ratio = static_cast<float>(cascade + 1) / static_cast<float>(cascadesCount);
+        const auto logSplit = near * std::pow(far / near, ratio);
+        const auto uniformSplit = near + (far - near) * ratio;
+        return config.shadowCascadesSplitLambda * logSplit + (1.0f - config.shadowCascadesSplitLambda) * uniformSplit;
+    }
+
+    glm::mat4 ShadowMap::getLightSpace(uint32_t cascade) const {
+        if ((currentCamera != nullptr) && (dynamic_cast<DirectionalLight*>(light) != nullptr)) {
+            return getCascadeLightSpace(cascade);
+        }
         glm::vec3 lightPosition;
         glm::vec3 sceneCenter;
         glm::mat4 lightProjection;
@@ -30,9 +64,10 @@ namespace z0 {
                                          zNear, orthoDepth);
         } else if (auto* spotLight = dynamic_cast<SpotLight*>(light)) {
             auto lightDirection = glm::normalize(spotLight->getDirection());
-            lightPosition = light->getPositionGlobal();
+            lightPosition = light->getPositionInterpolated();
             sceneCenter = lightPosition + lightDirection;
-            lightProjection = glm::perspective(spotLight->getFov(), vulkanDevice.getAspectRatio(), zNear, zFar);
+            // square tiles
+            lightProjection = glm::perspective(spotLight->getFov(), 1.0f, zNear, zFar);
         } else {
             return glm::mat4{};
         }
@@ -40,49 +75,50 @@ namespace z0 {
         return lightProjection * glm::lookAt(lightPosition, sceneCenter, AXIS_UP);
     }
 
-    // https://github.com/SaschaWillems/Vulkan/blob/master/examples/shadowmapping/shadowmapping.cpp#L192
-    void ShadowMap::createImagesResources() {
-        // For shadow mapping we only need a depth attachment
-        auto format = vulkanDevice.findImageTilingSupportedFormat(
-                {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT,},
-                VK_IMAGE_TILING_OPTIMAL,
-                VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-        createImage(size,
-                    size,
-                    format,
-                    VK_SAMPLE_COUNT_1_BIT,
-                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                    VK_IMAGE_ASPECT_DEPTH_BIT);
+    // Orthographic projection around the bounding sphere of the camera frustum slice of the cascade.
+    // The sphere size does not change with the camera orientation and the projection is snapped
+    // to the shadow map texels, so the shadows edges does not shimmer when the camera moves.
+    // https://therealmjp.github.io/posts/shadow-maps/
+    glm::mat4 ShadowMap::getCascadeLightSpace(uint32_t cascade) const {
+        auto* directionalLight = dynamic_cast<DirectionalLight*>(light);
+        const auto lightDirection = glm::normalize(directionalLight->getDirection());
+        const auto near = currentCamera->getNearDistance();
+        const auto far = currentCamera->getFarDistance();
+        const auto nearSplit = cascade == 0 ? near : getCascadeSplit(cascade - 1);
+        const auto farSplit = getCascadeSplit(cascade);
 
-        // Create sampler to sample from to depth attachment
-        // Used to sample in the fragment shader for shadowed rendering
-        VkFilter shadowmap_filter = vulkanDevice.formatIsFilterable( format, VK_IMAGE_TILING_OPTIMAL) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
-        VkSamplerCreateInfo samplerCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-            .magFilter = shadowmap_filter,
-            .minFilter = shadowmap_filter,
-            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
-            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-            .addressModeV = samplerCreateInfo.addressModeU,
-            .addressModeW = samplerCreateInfo.addressModeU,
-            .mipLodBias = 0.0f,
-            .maxAnisotropy = 1.0f,
-            .minLod = 0.0f,
-            .maxLod = 1.0f,
-            .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE
-        };
-        if (vkCreateSampler(vulkanDevice.getDevice(), &samplerCreateInfo, nullptr, &sampler) != VK_SUCCESS) {
-            die("failed to create shadowmap sampler!");
+        // Corners of the slice, interpolated between the corners of the camera near and far planes
+        const auto inverseViewProjection = glm::inverse(currentCamera->getProjection() * currentCamera->getView());
+        std::array<glm::vec3, 8> corners;
+        glm::vec3 center{0.0f};
+        for (uint32_t i = 0; i < 4; i++) {
+            const glm::vec2 ndc{(i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f};
+            auto nearCorner = inverseViewProjection * glm::vec4{ndc, 0.0f, 1.0f};
+            auto farCorner = inverseViewProjection * glm::vec4{ndc, 1.0f, 1.0f};
+            const auto nearPoint = glm::vec3{nearCorner} / nearCorner.w;
+            const auto ray = glm::vec3{farCorner} / farCorner.w - nearPoint;
+            corners[i * 2] = nearPoint + ray * ((nearSplit - near) / (far - near));
+            corners[i * 2 + 1] = nearPoint + ray * ((farSplit - near) / (far - near));
+            center += corners[i * 2] + corners[i * 2 + 1];
         }
-
-    }
-
-    void ShadowMap::cleanupImagesResources() {
-        if (sampler != VK_NULL_HANDLE) {
-            vkDestroySampler(vulkanDevice.getDevice(), sampler, nullptr);
-            sampler = VK_NULL_HANDLE;
+        center /= 8.0f;
+        auto radius = 0.0f;
+        for (const auto& corner : corners) {
+            radius = std::max(radius, glm::distance(corner, center));
         }
-        BaseFrameBuffer::cleanupImagesResources();
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        const auto up = std::abs(glm::dot(lightDirection, AXIS_UP)) > 0.99f ? AXIS_Z : AXIS_UP;
+        const auto lightView = glm::lookAt(center - lightDirection * (radius + cascadeCastersDistance), center, up);
+        auto lightProjection = glm::ortho(-radius, radius, -radius, radius,
+                                          0.0f, 2.0f * radius + cascadeCastersDistance);
+        // Move the world origin on a texel corner
+        const auto halfSize = static_cast<float>(size) / 2.0f;
+        const auto origin = glm::vec2{lightProjection * lightView * glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}} * halfSize;
+        const auto offset = (glm::round(origin) - origin) / halfSize;
+        lightProjection[3][0] += offset.x;
+        lightProjection[3][1] += offset.y;
+        return lightProjection * lightView;
     }
 
-}
\ No newline at end of file
+}
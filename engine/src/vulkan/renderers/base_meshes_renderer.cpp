@@ -1,6 +1,8 @@
 #include "z0/vulkan/renderers/base_meshes_renderer.hpp"
 #include "z0/vulkan/vulkan_model.hpp"
 #include "z0/vulkan/vulkan_descriptors.hpp"
+#include "z0/application.hpp"
+#include "z0/utils/frustum.hpp"
 #include "z0/log.hpp"
 
 #include "glm/gtc/matrix_transform.hpp"
@@ -14,6 +16,9 @@ namespace z0 {
     void BaseMeshesRenderer::cleanup() {
         cleanupImagesResources();
         depthBuffer.reset();
+        meshletCulling.reset();
+        meshesSnapshots.clear();
+        surfacesSnapshots.clear();
         modelsBuffers.clear();
         BaseRenderpass::cleanup();
     }
@@ -32,4 +37,40 @@ namespace z0 {
                                vertexAttribute.data());
     }
 
-}
\ No newline at end of file
+    uint32_t BaseMeshesRenderer::getLod(const MeshInstance* meshInstance, float bias) const {
+        return meshInstance->getLod(*currentCamera,
+                                    static_cast<float>(vulkanDevice.getSwapChainExtent().height),
+                                    Application::getConfig().lodPixelError * bias);
+    }
+
+    void BaseMeshesRenderer::snapshotMeshes(uint32_t currentFrame) {
+        auto& snapshots = meshesSnapshots[currentFrame];
+        auto& surfaces = surfacesSnapshots[currentFrame];
+        snapshots.clear();
+        surfaces.clear();
+        const Frustum frustum{currentCamera->getProjection() * currentCamera->getView()};
+        for (const auto* meshInstance : meshes) {
+            auto mesh = meshInstance->getMesh();
+            const auto firstSurface = static_cast<uint32_t>(surfaces.size());
+            if (mesh->isValid()) {
+                for (const auto& surface : mesh->getSurfaces()) {
+                    surfaces.push_back({ .cullMode = getCullMode(surface->material.get()) });
+                }
+            }
+            auto visible = mesh->isValid();
+            if (visible) {
+                const auto bounds = meshInstance->getWorldBounds();
+                visible = !frustum.isOutside(glm::vec3{bounds}, bounds.w);
+            }
+            // only the drawn models are kept resident, the evicted ones are uploaded again
+            if (visible) mesh->_useModel();
+            snapshots.push_back({
+                .id = meshInstance->getId(),
+                .mesh = visible ? std::move(mesh) : nullptr,
+                .lod = visible ? getLod(meshInstance) : 0,
+                .firstSurface = firstSurface,
+            });
+        }
+    }
+
+}
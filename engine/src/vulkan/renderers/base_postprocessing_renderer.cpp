@@ -16,8 +16,8 @@ namespace z0 {
         BaseRenderpass::cleanup();
     }
 
-    void BasePostprocessingRenderer::loadShaders() {
-        vertShader = createShader("quad.vert", VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT);
+    void BasePostprocessingRenderer::createShaders(const std::string& fragFilename) {
+        createLinkedShaders("quad.vert", fragFilename);
     }
 
     void BasePostprocessingRenderer::recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
@@ -32,7 +32,11 @@ namespace z0 {
     }
 
     void BasePostprocessingRenderer::createImagesResources() {
-        colorAttachmentHdr = std::make_shared<ColorAttachmentHDR>(vulkanDevice);
+        // ping-pong : shares the memory of the input of the input attachment, no longer used by this pass
+        const auto inputSlot = inputColorAttachmentHdr->getAliasingSlot();
+        colorAttachmentHdr = std::make_shared<ColorAttachmentHDR>(
+                vulkanDevice,
+                inputSlot == BaseFrameBuffer::NO_ALIASING ? BaseFrameBuffer::NO_ALIASING : (inputSlot + 1) % VulkanDevice::ALIASING_SLOTS);
     }
 
     void BasePostprocessingRenderer::cleanupImagesResources() {
@@ -81,12 +85,16 @@ namespace z0 {
         }
     }
 
+    void BasePostprocessingRenderer::declareResources(RenderGraphPass& pass, uint32_t currentFrame) {
+        pass.readImage(inputColorAttachmentHdr->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                       VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+        // cleared by the pass
+        pass.writeImage(colorAttachmentHdr->getImage(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_ASPECT_COLOR_BIT, true);
+    }
+
     void BasePostprocessingRenderer::beginRendering(VkCommandBuffer commandBuffer) {
-        vulkanDevice.transitionImageLayout(commandBuffer, colorAttachmentHdr->getImage(),
-                                           VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                                           0, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                           VK_IMAGE_ASPECT_COLOR_BIT);
         const VkRenderingAttachmentInfo colorAttachmentInfo{
                 .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
                 .imageView = colorAttachmentHdr->getImageView(),
@@ -109,16 +117,8 @@ namespace z0 {
     }
 
 
-    void BasePostprocessingRenderer::endRendering(VkCommandBuffer commandBuffer, bool isLast) {
+    void BasePostprocessingRenderer::endRendering(VkCommandBuffer commandBuffer) {
         vkCmdEndRendering(commandBuffer);
-        vulkanDevice.transitionImageLayout(commandBuffer, colorAttachmentHdr->getImage(),
-                                           VK_IMAGE_LAYOUT_UNDEFINED,
-                                           isLast ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                           0,
-                                            isLast ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT,
-                                           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                                           isLast ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                           VK_IMAGE_ASPECT_COLOR_BIT);
     }
 
 }
\ No newline at end of file
@@ -1,8 +1,11 @@
 #include "z0/vulkan/renderers/base_renderpass.hpp"
 #include "z0/vulkan/vulkan_model.hpp"
 #include "z0/vulkan/vulkan_descriptors.hpp"
+#include "z0/vulkan/vulkan_stats.hpp"
+#include "z0/resources/material.hpp"
 #include "z0/log.hpp"
 
+#include <array>
 #include <fstream>
 #include <filesystem>
 
@@ -27,18 +30,23 @@ namespace z0 {
     }
 
     void BaseRenderpass::bindShaders(VkCommandBuffer commandBuffer) {
-        if (vertShader != nullptr) {
-            vkCmdBindShadersEXT(commandBuffer, 1, vertShader->getStage(), vertShader->getShader());
-        } else {
-            VkShaderStageFlagBits stageFlagBits{VK_SHADER_STAGE_VERTEX_BIT};
-            vkCmdBindShadersEXT(commandBuffer, 1, &stageFlagBits, VK_NULL_HANDLE);
-        }
-        if (fragShader != nullptr) {
-            vkCmdBindShadersEXT(commandBuffer, 1, fragShader->getStage(), fragShader->getShader());
-        } else {
-            VkShaderStageFlagBits stageFlagBits{VK_SHADER_STAGE_FRAGMENT_BIT};
-            vkCmdBindShadersEXT(commandBuffer, 1, &stageFlagBits, VK_NULL_HANDLE);
-        }
+        // both stages in one call, linked shaders must be bound together
+        const std::array<VkShaderStageFlagBits, 2> stages{VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT};
+        const std::array<VkShaderEXT, 2> shaders{
+            vertShader != nullptr ? *(vertShader->getShader()) : VK_NULL_HANDLE,
+            fragShader != nullptr ? *(fragShader->getShader()) : VK_NULL_HANDLE,
+        };
+        vkCmdBindShadersEXT(commandBuffer, stages.size(), stages.data(), shaders.data());
+#ifdef VULKAN_STATS
+        VulkanStats::get().shaderBindsCount += 1;
+#endif
+    }
+
+    void BaseRenderpass::bindShader(VkCommandBuffer commandBuffer, VulkanShader& shader) {
+        vkCmdBindShadersEXT(commandBuffer, 1, shader.getStage(), shader.getShader());
+#ifdef VULKAN_STATS
+        VulkanStats::get().shaderBindsCount += 1;
+#endif
     }
 
     void BaseRenderpass::writeUniformBuffer(const std::vector<std::unique_ptr<VulkanBuffer>>& buffers, uint32_t currentFrame, void *data, uint32_t index) {
@@ -59,9 +67,10 @@ namespace z0 {
         }
     }
 
-    void BaseRenderpass::bindDescriptorSets(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t count, uint32_t *offsets) {
+    void BaseRenderpass::bindDescriptorSets(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t count, uint32_t *offsets,
+                                            VkPipelineBindPoint bindPoint) {
         vkCmdBindDescriptorSets(commandBuffer,
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                bindPoint,
                                 pipelineLayout,
                                 0, 1,
                                 &descriptorSets[currentFrame],
@@ -91,7 +100,8 @@ namespace z0 {
 
     std::unique_ptr<VulkanShader> BaseRenderpass::createShader(const std::string& filename,
                                                                VkShaderStageFlagBits stage,
-                                                               VkShaderStageFlags next_stage) {
+                                                               VkShaderStageFlags next_stage,
+                                                               const std::vector<uint32_t>& specializationConstants) {
         auto code = readFile(filename);
         std::unique_ptr<VulkanShader> shader  = std::make_unique<VulkanShader>(
                 vulkanDevice,
@@ -100,16 +110,59 @@ namespace z0 {
                 filename,
                 code,
                 globalSetLayout->getDescriptorSetLayout(),
-                nullptr);
+                nullptr,
+                specializationConstants);
         buildShader(*shader);
         return shader;
     }
 
+    void BaseRenderpass::createLinkedShaders(const std::string& vertFilename, const std::string& fragFilename) {
+        const auto vertCode = readFile(vertFilename);
+        const auto fragCode = readFile(fragFilename);
+        vertShader = std::make_unique<VulkanShader>(
+                vulkanDevice,
+                VK_SHADER_STAGE_VERTEX_BIT,
+                VK_SHADER_STAGE_FRAGMENT_BIT,
+                vertFilename,
+                vertCode,
+                globalSetLayout->getDescriptorSetLayout(),
+                nullptr);
+        fragShader = std::make_unique<VulkanShader>(
+                vulkanDevice,
+                VK_SHADER_STAGE_FRAGMENT_BIT,
+                0,
+                fragFilename,
+                fragCode,
+                globalSetLayout->getDescriptorSetLayout(),
+                nullptr);
+        vertShader->setLinked();
+        fragShader->setLinked();
+        // https://docs.vulkan.org/samples/latest/samples/extensions/shader_object/README.html
+        const std::array<VkShaderCreateInfoEXT, 2> shaderCreateInfos{
+            vertShader->getShaderCreateInfo(),
+            fragShader->getShaderCreateInfo(),
+        };
+        std::array<VkShaderEXT, 2> shaders;
+        if (vulkanDevice.getShaderCache().createShaders(shaderCreateInfos.size(), shaderCreateInfos.data(), shaders.data()) != VK_SUCCESS) {
+            die("vkCreateShadersEXT failed");
+        }
+        vertShader->setShader(shaders[0]);
+        fragShader->setShader(shaders[1]);
+    }
+
+    VkCullModeFlags BaseRenderpass::getCullMode(const Material* material) {
+        if (const auto* standardMaterial = dynamic_cast<const StandardMaterial*>(material)) {
+            return standardMaterial->cullMode == CULLMODE_DISABLED ? VK_CULL_MODE_NONE :
+                   standardMaterial->cullMode == CULLMODE_BACK ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_FRONT_BIT;
+        }
+        return VK_CULL_MODE_NONE;
+    }
+
     // https://docs.vulkan.org/samples/latest/samples/extensions/shader_object/README.html
     void BaseRenderpass::buildShader(VulkanShader& shader) {
         VkShaderEXT shaderEXT;
         VkShaderCreateInfoEXT shaderCreateInfo = shader.getShaderCreateInfo();
-        if (vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &shaderEXT) != VK_SUCCESS) {
+        if (vulkanDevice.getShaderCache().createShaders(1, &shaderCreateInfo, &shaderEXT) != VK_SUCCESS) {
             die("vkCreateShadersEXT failed");
         }
         shader.setShader(shaderEXT);
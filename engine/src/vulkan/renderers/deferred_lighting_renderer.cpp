@@ -0,0 +1,191 @@
+#include "z0/vulkan/renderers/deferred_lighting_renderer.hpp"
+#include "z0/log.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace z0 {
+
+    DeferredLightingRenderer::DeferredLightingRenderer(VulkanDevice &dev, const std::string& sDir) : BaseRenderpass{dev, sDir} {}
+
+    void DeferredLightingRenderer::cleanup() {
+        if (sampler != VK_NULL_HANDLE) {
+            vkDestroySampler(device, sampler, nullptr);
+            sampler = VK_NULL_HANDLE;
+        }
+        lightingShader.reset();
+        gBuffer.reset();
+        resolvedDepthBuffer.reset();
+        colorAttachmentHdr.reset();
+        lightClusters.reset();
+        shadowAtlas.reset();
+        shadowMapsBuffers.clear();
+        BaseRenderpass::cleanup();
+    }
+
+    void DeferredLightingRenderer::loadScene(std::shared_ptr<GBuffer>& _gBuffer,
+                                             std::shared_ptr<DepthBuffer>& _resolvedDepthBuffer,
+                                             std::shared_ptr<ColorAttachmentHDR>& _colorAttachmentHdr,
+                                             std::shared_ptr<LightClustersRenderer>& _lightClusters,
+                                             std::shared_ptr<ShadowAtlas>& _shadowAtlas,
+                                             std::vector<std::unique_ptr<VulkanBuffer>>& _shadowMapsBuffers) {
+        gBuffer = _gBuffer;
+        resolvedDepthBuffer = _resolvedDepthBuffer;
+        colorAttachmentHdr = _colorAttachmentHdr;
+        lightClusters = _lightClusters;
+        shadowAtlas = _shadowAtlas;
+        for (const auto& buffer : _shadowMapsBuffers) {
+            shadowMapsBuffers.push_back(buffer.get());
+        }
+        // G-buffer texels are read with texelFetch()
+        const VkSamplerCreateInfo samplerInfo{
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .magFilter = VK_FILTER_NEAREST,
+            .minFilter = VK_FILTER_NEAREST,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .maxAnisotropy = 1.0f,
+            .minLod = 0.0f,
+            .maxLod = 1.0f,
+        };
+        if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+            die("failed to create G-buffer sampler!");
+        }
+        createResources();
+    }
+
+    void DeferredLightingRenderer::loadShaders() {
+        lightingShader = createShader("deferred_lighting.comp" + ShadowAtlas::getFilterShaderVariant(),
+                                      VK_SHADER_STAGE_COMPUTE_BIT, 0);
+    }
+
+    void DeferredLightingRenderer::update(uint32_t currentFrame, const LightingUniformBufferObject& lightingUbo) {
+        globalBuffers[currentFrame]->writeToBuffer(&lightingUbo, sizeof(LightingUniformBufferObject));
+    }
+
+    void DeferredLightingRenderer::recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+        bindShader(commandBuffer, *lightingShader);
+        uint32_t offset = 0; // lighting UBO
+        bindDescriptorSets(commandBuffer, currentFrame, 1, &offset, VK_PIPELINE_BIND_POINT_COMPUTE);
+        const auto& extent = vulkanDevice.getSwapChainExtent();
+        vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1);
+    }
+
+    void DeferredLightingRenderer::createDescriptorSetLayout() {
+        globalPool = VulkanDescriptorPool::Builder(vulkanDevice)
+                .setMaxSets(MAX_FRAMES_IN_FLIGHT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT) // lighting UBO
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6 * MAX_FRAMES_IN_FLIGHT) // G-buffer, depth & shadow atlas
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * MAX_FRAMES_IN_FLIGHT) // point lights & clusters
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_FRAMES_IN_FLIGHT) // shadow maps infos
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_FRAMES_IN_FLIGHT) // output
+                .build();
+
+        createUniformBuffers(globalBuffers, sizeof(LightingUniformBufferObject));
+
+        globalSetLayout = VulkanDescriptorSetLayout::Builder(vulkanDevice)
+            .addBinding(0, // lighting UBO
+                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, // albedo
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(2, // normal
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(3, // material
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(4, // resolved depth
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(5, // point lights
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(6, // lights clusters
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(7, // shadow maps infos
+                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(8, // shadow atlas
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(9, // HDR output
+                        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(10, // shadow atlas depths
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+        writeDescriptorSets();
+    }
+
+    void DeferredLightingRenderer::writeDescriptorSets() {
+        for (uint32_t i = 0; i < descriptorSets.size(); i++) {
+            auto lightingBufferInfo = globalBuffers[i]->descriptorInfo(sizeof(LightingUniformBufferObject));
+            auto pointLightBufferInfo = lightClusters->getLightsBuffer(i).descriptorInfo();
+            auto clustersBufferInfo = lightClusters->getClustersBuffer(i).descriptorInfo();
+            auto shadowMapBufferInfo = shadowMapsBuffers[i]->descriptorInfo();
+            std::array<VkDescriptorImageInfo, GBuffer::ATTACHMENTS_COUNT> gBufferInfo;
+            for (uint32_t attachment = 0; attachment < GBuffer::ATTACHMENTS_COUNT; attachment++) {
+                gBufferInfo[attachment] = {
+                    .sampler = sampler,
+                    .imageView = gBuffer->getResolvedAttachment(attachment).getImageView(),
+                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                };
+            }
+            VkDescriptorImageInfo depthInfo{
+                .sampler = sampler,
+                .imageView = resolvedDepthBuffer->getImageView(),
+                .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            };
+            // never sampled without shadow maps
+            auto shadowAtlasInfo = depthInfo;
+            auto shadowAtlasDepthInfo = depthInfo;
+            if (shadowAtlas != nullptr) {
+                shadowAtlasInfo = {
+                    .sampler = shadowAtlas->getSampler(),
+                    .imageView = shadowAtlas->getImageView(),
+                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                };
+                shadowAtlasDepthInfo = {
+                    .sampler = shadowAtlas->getDepthSampler(),
+                    .imageView = shadowAtlas->getImageView(),
+                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                };
+            }
+            VkDescriptorImageInfo outputInfo{
+                .imageView = colorAttachmentHdr->getImageView(),
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+            };
+            auto writer = VulkanDescriptorWriter(*globalSetLayout, *globalPool)
+                .writeBuffer(0, &lightingBufferInfo)
+                .writeImage(1, &gBufferInfo[GBuffer::ALBEDO])
+                .writeImage(2, &gBufferInfo[GBuffer::NORMAL])
+                .writeImage(3, &gBufferInfo[GBuffer::MATERIAL])
+                .writeImage(4, &depthInfo)
+                .writeBuffer(5, &pointLightBufferInfo)
+                .writeBuffer(6, &clustersBufferInfo)
+                .writeBuffer(7, &shadowMapBufferInfo)
+                .writeImage(8, &shadowAtlasInfo)
+                .writeImage(9, &outputInfo)
+                .writeImage(10, &shadowAtlasDepthInfo);
+            if (descriptorSets[i] == VK_NULL_HANDLE) {
+                if (!writer.build(descriptorSets[i])) {
+                    die("Cannot allocate descriptor set");
+                }
+            } else {
+                writer.overwrite(descriptorSets[i]);
+            }
+        }
+    }
+
+    void DeferredLightingRenderer::recreateImagesResources() {
+        writeDescriptorSets();
+    }
+
+}
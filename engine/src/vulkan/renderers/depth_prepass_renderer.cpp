@@ -10,10 +10,12 @@ namespace z0 {
 
     void DepthPrepassRenderer::loadScene(std::shared_ptr<DepthBuffer>& _depthBuffer,
                                          Camera* _camera,
-                                         std::vector<MeshInstance*>& _meshes) {
+                                         std::vector<MeshInstance*>& _meshes,
+                                         const std::shared_ptr<MeshletCullingRenderer>& _meshletCulling) {
         meshes = _meshes;
         depthBuffer = _depthBuffer;
         currentCamera = _camera;
+        meshletCulling = _meshletCulling;
         createResources();
     }
 
@@ -28,12 +30,13 @@ namespace z0 {
             .view = currentCamera->getView()
         };
         writeUniformBuffer(globalBuffers, currentFrame, &globalUbo);
+        snapshotMeshes(currentFrame);
 
         uint32_t modelIndex = 0;
         for (const auto&meshInstance: meshes) {
             if (meshInstance->getMesh()->isValid()) {
                 ModelUniformBufferObject modelUbo{
-                    .matrix = meshInstance->getTransformGlobal(),
+                    .matrix = meshInstance->getTransformInterpolated(),
                 };
                 writeUniformBuffer(modelsBuffers, currentFrame, &modelUbo, modelIndex);
             }
@@ -46,25 +49,28 @@ namespace z0 {
         setInitialState(commandBuffer);
         vkCmdSetDepthWriteEnable(commandBuffer, VK_TRUE);
 
+        const auto& surfaces = surfacesSnapshots[currentFrame];
         uint32_t modelIndex = 0;
-        for (const auto&meshInstance: meshes) {
-            auto mesh = meshInstance->getMesh();
-            if (mesh->isValid()) {
+        for (const auto& snapshot : meshesSnapshots[currentFrame]) {
+            if (const auto& mesh = snapshot.mesh) {
+                // must be the same LOD as the scene renderer for the depth EQUAL test,
+                // both snapshots are taken with the same camera
+                const auto lod = snapshot.lod;
+                uint32_t surfaceIndex = 0;
                 for (const auto& surface: mesh->getSurfaces()) {
-                    if (auto standardMaterial = dynamic_cast<StandardMaterial*>(surface->material.get())) {
-                        vkCmdSetCullMode(commandBuffer,
-                                         standardMaterial->cullMode == CULLMODE_DISABLED ? VK_CULL_MODE_NONE :
-                                         standardMaterial->cullMode == CULLMODE_BACK ? VK_CULL_MODE_BACK_BIT
-                                                                                     : VK_CULL_MODE_FRONT_BIT);
-                    } else {
-                        vkCmdSetCullMode(commandBuffer, VK_CULL_MODE_NONE);
-                    }
+                    vkCmdSetCullMode(commandBuffer, surfaces[snapshot.firstSurface + surfaceIndex].cullMode);
                     std::array<uint32_t, 2> offsets = {
                         0, // globalBuffers
                         static_cast<uint32_t>(modelsBuffers[currentFrame]->getAlignmentSize() * modelIndex),
                     };
                     bindDescriptorSets(commandBuffer, currentFrame, offsets.size(), offsets.data());
-                    mesh->_getModel()->draw(commandBuffer, surface->firstVertexIndex, surface->indexCount);
+                    if ((meshletCulling == nullptr) ||
+                        !meshletCulling->drawSurface(commandBuffer, currentFrame, MeshletCullingRenderer::CAMERA_VIEW,
+                                                     snapshot.id, *mesh, surfaceIndex)) {
+                        const auto range = surface->getLod(lod);
+                        mesh->_getModel()->draw(commandBuffer, range.firstIndex, range.indexCount);
+                    }
+                    surfaceIndex += 1;
                 }
             }
             modelIndex += 1;
@@ -108,18 +114,20 @@ namespace z0 {
         }
     }
 
-    void DepthPrepassRenderer::beginRendering(VkCommandBuffer commandBuffer) {
-        vulkanDevice.transitionImageLayout(
-                commandBuffer,
-               depthBuffer->getImage(),
-                VK_IMAGE_LAYOUT_UNDEFINED,
-                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-               0, // no need to wait for any prior operation (VK_IMAGE_LAYOUT_UNDEFINED))
-               VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-               VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, // as soon as possible
-               VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-               VK_IMAGE_ASPECT_DEPTH_BIT);
+    void DepthPrepassRenderer::declareResources(RenderGraphPass& pass, uint32_t currentFrame) {
+        if (meshes.empty() || currentCamera == nullptr) return;
+        // cleared by the pass
+        pass.writeImage(depthBuffer->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_ASPECT_DEPTH_BIT, true);
+        if (meshletCulling != nullptr) {
+            meshletCulling->readCommands(pass, currentFrame);
+            meshletCulling->declareHiZBuild(pass);
+        }
+    }
 
+    void DepthPrepassRenderer::beginRendering(VkCommandBuffer commandBuffer) {
         const VkRenderingAttachmentInfo depthAttachmentInfo{
                 .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
                 .imageView = depthBuffer->getImageView(),
@@ -143,14 +151,10 @@ namespace z0 {
         vkCmdBeginRendering(commandBuffer, &renderingInfo);
     }
 
-    void DepthPrepassRenderer::endRendering(VkCommandBuffer commandBuffer, bool isLast) {
+    void DepthPrepassRenderer::endRendering(VkCommandBuffer commandBuffer) {
         vkCmdEndRendering(commandBuffer);
-        vulkanDevice.transitionImageLayout(
-                commandBuffer,depthBuffer->getImage(),
-                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
-                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-                VK_IMAGE_ASPECT_DEPTH_BIT);
+        // occluders for the meshlets culling of the next frame
+        if (meshletCulling != nullptr) meshletCulling->buildHiZ(commandBuffer, *this);
     }
 
     void DepthPrepassRenderer::createImagesResources() {
@@ -0,0 +1,112 @@
+#include "z0/vulkan/renderers/light_clusters_renderer.hpp"
+#include "z0/log.hpp"
+
+#include <algorithm>
+
+namespace z0 {
+
+    LightClustersRenderer::LightClustersRenderer(VulkanDevice &dev, const std::string& sDir) : BaseRenderpass{dev, sDir} {}
+
+    void LightClustersRenderer::cleanup() {
+        clustersShader.reset();
+        lightsBuffers.clear();
+        clustersBuffers.clear();
+        BaseRenderpass::cleanup();
+    }
+
+    void LightClustersRenderer::loadScene(uint32_t _maxLights, VkDeviceSize _lightSize) {
+        maxLights = std::max(_maxLights, 1u);
+        lightSize = _lightSize;
+        createResources();
+    }
+
+    void LightClustersRenderer::loadShaders() {
+        clustersShader = createShader("light_clusters.comp", VK_SHADER_STAGE_COMPUTE_BIT, 0);
+    }
+
+    glm::vec2 LightClustersRenderer::getTileSize() const {
+        const auto& extent = vulkanDevice.getSwapChainExtent();
+        return {
+            static_cast<float>((extent.width + CLUSTERS_X - 1) / CLUSTERS_X),
+            static_cast<float>((extent.height + CLUSTERS_Y - 1) / CLUSTERS_Y)
+        };
+    }
+
+    void LightClustersRenderer::writeLights(uint32_t currentFrame, Camera& camera, const void* lights, uint32_t count) {
+        const auto& extent = vulkanDevice.getSwapChainExtent();
+        ClustersParamsUniform paramsUbo{
+            .view = camera.getView(),
+            .inverseProjection = glm::inverse(camera.getProjection()),
+            .screenSize = {static_cast<float>(extent.width), static_cast<float>(extent.height)},
+            .tileSize = getTileSize(),
+            .near = camera.getNearDistance(),
+            .far = camera.getFarDistance(),
+            .lightsCount = std::min(count, maxLights),
+        };
+        globalBuffers[currentFrame]->writeToBuffer(&paramsUbo, sizeof(ClustersParamsUniform));
+        if (paramsUbo.lightsCount > 0) {
+            lightsBuffers[currentFrame]->writeToBuffer(lights, lightSize * paramsUbo.lightsCount);
+        }
+    }
+
+    void LightClustersRenderer::recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+        bindShader(commandBuffer, *clustersShader);
+        uint32_t offset = 0; // params UBO
+        bindDescriptorSets(commandBuffer, currentFrame, 1, &offset, VK_PIPELINE_BIND_POINT_COMPUTE);
+        // one workgroup per depth slice
+        vkCmdDispatch(commandBuffer, CLUSTERS_Z, 1, 1);
+    }
+
+    void LightClustersRenderer::declareResources(RenderGraphPass& pass, uint32_t currentFrame) {
+        // read by the fragment (or deferred lighting) shaders
+        pass.writeBuffer(clustersBuffers[currentFrame]->getBuffer(),
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT);
+    }
+
+    void LightClustersRenderer::createDescriptorSetLayout() {
+        globalPool = VulkanDescriptorPool::Builder(vulkanDevice)
+                .setMaxSets(MAX_FRAMES_IN_FLIGHT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT) // params UBO
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * MAX_FRAMES_IN_FLIGHT) // lights & clusters
+                .build();
+
+        createUniformBuffers(globalBuffers, sizeof(ClustersParamsUniform));
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            lightsBuffers[i] = std::make_unique<VulkanBuffer>(
+                    vulkanDevice, lightSize, maxLights,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            lightsBuffers[i]->map();
+            // count + light indices for each cluster
+            clustersBuffers[i] = std::make_unique<VulkanBuffer>(
+                    vulkanDevice, sizeof(uint32_t) * (CLUSTER_MAX_LIGHTS + 1), CLUSTERS_COUNT,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        }
+
+        globalSetLayout = VulkanDescriptorSetLayout::Builder(vulkanDevice)
+            .addBinding(0, // params UBO
+                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, // lights
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(2, // clusters
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+        for (uint32_t i = 0; i < descriptorSets.size(); i++) {
+            auto paramsBufferInfo = globalBuffers[i]->descriptorInfo(sizeof(ClustersParamsUniform));
+            auto lightsBufferInfo = lightsBuffers[i]->descriptorInfo();
+            auto clustersBufferInfo = clustersBuffers[i]->descriptorInfo();
+            if (!VulkanDescriptorWriter(*globalSetLayout, *globalPool)
+                .writeBuffer(0, &paramsBufferInfo)
+                .writeBuffer(1, &lightsBufferInfo)
+                .writeBuffer(2, &clustersBufferInfo)
+                .build(descriptorSets[i])) {
+                die("Cannot allocate descriptor set");
+            }
+        }
+        log("Light clusters :", std::to_string(CLUSTERS_COUNT), "clusters for", std::to_string(maxLights), "lights");
+    }
+
+}
@@ -0,0 +1,510 @@
+/*
+ * https://vkguide.dev/docs/gpudriven/compute_culling/
+ * https://github.com/zeux/niagara
+ */
+#include "z0/vulkan/renderers/meshlet_culling_renderer.hpp"
+#include "z0/utils/frustum.hpp"
+#include "z0/application.hpp"
+#include "z0/log.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace z0 {
+
+    MeshletCullingRenderer::MeshletCullingRenderer(VulkanDevice &dev, const std::string& sDir) : BaseRenderpass{dev, sDir} {}
+
+    void MeshletCullingRenderer::cleanup() {
+        cleanupImagesResources();
+        cullingShader.reset();
+        hizShader.reset();
+        meshletsBuffer.reset();
+        viewsBuffers.clear();
+        modelsBuffers.clear();
+        jobsBuffers.clear();
+        commandsBuffers.clear();
+        drawCountsBuffers.clear();
+        hizLevelsBuffers.clear();
+        depthBuffer.reset();
+        shadowMaps.clear();
+        BaseRenderpass::cleanup();
+    }
+
+    void MeshletCullingRenderer::loadScene(Camera* camera,
+                                           std::shared_ptr<DepthBuffer>& _depthBuffer,
+                                           std::vector<std::shared_ptr<ShadowMap>>& _shadowMaps,
+                                           std::vector<MeshInstance*>& _meshes) {
+        currentCamera = camera;
+        depthBuffer = _depthBuffer;
+        shadowMaps = _shadowMaps;
+        meshes = _meshes;
+        // one view per shadow map cascade
+        viewsCount = 1;
+        for (const auto& shadowMap : shadowMaps) {
+            viewsCount += shadowMap->getCascadesCount();
+        }
+
+        // The Hi-Z pyramid is built from the multisampled depth prepass buffer,
+        // with a dynamic index in the array of pyramid levels
+        const auto samples = vulkanDevice.getSamples();
+        occlusionCulling = Application::getConfig().occlusionCulling &&
+                           (samples != VK_SAMPLE_COUNT_1_BIT) && !depthBuffer->isTransient() &&
+                           ((vulkanDevice.getDeviceProperties().limits.sampledImageDepthSampleCounts & samples) != 0) &&
+                           vulkanDevice.getDeviceFeatures().shaderStorageImageArrayDynamicIndexing;
+
+        // Meshlets of all the meshes, shared by the instances of a mesh
+        std::vector<MeshletData> meshletsData;
+        for (uint32_t modelIndex = 0; modelIndex < meshes.size(); modelIndex++) {
+            const auto& mesh = meshes[modelIndex]->getMesh();
+            modelIndices[meshes[modelIndex]->getId()] = modelIndex;
+            modelsFirstSurface.push_back(surfacesCount);
+            surfacesCount += static_cast<uint32_t>(mesh->getSurfaces().size());
+            if (mesh->isValid() && !meshletsOffsets.contains(mesh->getId())) {
+                meshletsOffsets[mesh->getId()] = static_cast<uint32_t>(meshletsData.size());
+                for (const auto& meshlet : mesh->getMeshlets()) {
+                    meshletsData.push_back({
+                        .sphere = glm::vec4{meshlet.center, meshlet.radius},
+                        .coneApex = glm::vec4{meshlet.coneApex, meshlet.coneCutoff},
+                        .coneAxis = glm::vec4{meshlet.coneAxis, 0.0f},
+                        .firstIndex = meshlet.firstIndex,
+                        .indexCount = meshlet.indexCount,
+                        .vertexOffset = mesh->_useModel().getVertexOffset(meshlet.firstIndex),
+                    });
+                }
+            }
+        }
+
+        // Each surface gets, for each view, one command per meshlet of its largest level of detail
+        surfacesFirstCommand.resize(viewsCount * surfacesCount);
+        surfacesDrawCount.assign(viewsCount * surfacesCount, 0);
+        for (uint32_t view = 0; view < viewsCount; view++) {
+            for (uint32_t modelIndex = 0; modelIndex < meshes.size(); modelIndex++) {
+                const auto& mesh = meshes[modelIndex]->getMesh();
+                uint32_t surfaceIndex = 0;
+                for (const auto& surface : mesh->getSurfaces()) {
+                    uint32_t maxMeshletCount = 0;
+                    for (uint32_t lod = 0; lod < mesh->getLodCount(); lod++) {
+                        maxMeshletCount = std::max(maxMeshletCount, surface->getLod(lod).meshletCount);
+                    }
+                    surfacesFirstCommand[view * surfacesCount + modelsFirstSurface[modelIndex] + surfaceIndex] = commandsCount;
+                    commandsCount += maxMeshletCount;
+                    surfaceIndex += 1;
+                }
+            }
+        }
+
+        meshletsBuffer = std::make_unique<VulkanBuffer>(
+                vulkanDevice,
+                sizeof(MeshletData),
+                std::max(static_cast<uint32_t>(meshletsData.size()), 1u),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        meshletsBuffer->map();
+        if (!meshletsData.empty()) {
+            meshletsBuffer->writeToBuffer(meshletsData.data(), sizeof(MeshletData) * meshletsData.size());
+        }
+        log("Meshlets culling :", std::to_string(meshletsData.size()), "meshlets,",
+            std::to_string(viewsCount), "views, occlusion", occlusionCulling ? "enabled" : "disabled");
+        createResources();
+    }
+
+    void MeshletCullingRenderer::loadShaders() {
+        cullingShader = createShader("meshlet_culling.comp", VK_SHADER_STAGE_COMPUTE_BIT, 0);
+        if (occlusionCulling) {
+            hizShader = createShader("hiz.comp", VK_SHADER_STAGE_COMPUTE_BIT, 0);
+        }
+    }
+
+    MeshletCullingRenderer::ViewUniform MeshletCullingRenderer::makeView(const glm::mat4& viewProjection) {
+        ViewUniform view{
+            .viewProjection = viewProjection,
+            .hizViewProjection = viewProjection,
+            .position = glm::vec4{0.0f},
+            .hizSize = glm::vec4{0.0f},
+        };
+        const Frustum frustum{viewProjection};
+        for (int i = 0; i < 6; i++) {
+            view.frustum[i] = frustum.planes[i];
+        }
+        return view;
+    }
+
+    void MeshletCullingRenderer::update(uint32_t currentFrame) {
+        // set before the parallel recording, buildHiZ() is recorded by the depth prepass
+        recordingFrame = currentFrame;
+        if (meshes.empty() || currentCamera == nullptr) return;
+        if (hizDirty) {
+            // the swap chain have been recreated, no frame is in flight
+            cleanupImagesResources();
+            createImagesResources();
+            writeDescriptorSets();
+            hizDirty = false;
+        }
+        const auto& config = Application::getConfig();
+        const auto viewportHeight = static_cast<float>(vulkanDevice.getSwapChainExtent().height);
+
+        std::vector<ViewUniform> views;
+        std::vector<Frustum> frustums;
+        const auto cameraViewProjection = currentCamera->getProjection() * currentCamera->getView();
+        views.push_back(makeView(cameraViewProjection));
+        views[CAMERA_VIEW].position = glm::vec4{currentCamera->getPositionInterpolated(), 1.0f};
+        if (occlusionCulling && hizBuilt) {
+            // the pyramid have been built with the camera of the previous frame
+            views[CAMERA_VIEW].hizViewProjection = lastViewProjection;
+            views[CAMERA_VIEW].hizSize = glm::vec4{hizWidth, hizHeight, hizLevels, 1.0f};
+        }
+        lastViewProjection = cameraViewProjection;
+        for (const auto& shadowMap : shadowMaps) {
+            for (uint32_t cascade = 0; cascade < shadowMap->getCascadesCount(); cascade++) {
+                views.push_back(makeView(shadowMap->getLightSpace(cascade)));
+            }
+        }
+        for (const auto& view : views) {
+            frustums.emplace_back(view.viewProjection);
+        }
+        viewsBuffers[currentFrame]->writeToBuffer(views.data(), sizeof(ViewUniform) * views.size());
+
+        jobs.clear();
+        std::fill(surfacesDrawCount.begin(), surfacesDrawCount.end(), 0);
+        for (uint32_t modelIndex = 0; modelIndex < meshes.size(); modelIndex++) {
+            const auto* meshInstance = meshes[modelIndex];
+            const auto& mesh = meshInstance->getMesh();
+            if (!mesh->isValid()) continue;
+            auto transform = meshInstance->getTransformInterpolated();
+            modelsBuffers[currentFrame]->writeToBuffer(&transform, sizeof(glm::mat4), sizeof(glm::mat4) * modelIndex);
+
+            const glm::vec3 scale{glm::length(glm::vec3{transform[0]}),
+                                  glm::length(glm::vec3{transform[1]}),
+                                  glm::length(glm::vec3{transform[2]})};
+            const auto maxScale = std::max({scale.x, scale.y, scale.z});
+            // the normal cones are only valid for uniform scales without mirroring
+            const auto coneCulling = ((maxScale - std::min({scale.x, scale.y, scale.z})) <= (maxScale * 1.0e-3f)) &&
+                                     (glm::determinant(glm::mat3{transform}) > 0.0f);
+            const auto center = glm::vec3{transform * glm::vec4{mesh->getBoundsCenter(), 1.0f}};
+            const auto radius = mesh->getBoundsRadius() * maxScale;
+
+            for (uint32_t view = 0; view < viewsCount; view++) {
+                // whole mesh instance culling before the meshlets culling
+                if (frustums[view].isOutside(center, radius)) continue;
+                const auto lod = meshInstance->getLod(*currentCamera,
+                                                      viewportHeight,
+                                                      config.lodPixelError * (view == CAMERA_VIEW ? 1.0f : config.shadowLodBias));
+                uint32_t surfaceIndex = 0;
+                for (const auto& surface : mesh->getSurfaces()) {
+                    const auto slot = view * surfacesCount + modelsFirstSurface[modelIndex] + surfaceIndex;
+                    const auto range = surface->getLod(lod);
+                    const auto* material = dynamic_cast<StandardMaterial*>(surface->material.get());
+                    surfaceIndex += 1;
+                    if (range.meshletCount == 0) continue;
+                    jobs.push_back({
+                        .firstMeshlet = meshletsOffsets[mesh->getId()] + range.firstMeshlet,
+                        .meshletCount = range.meshletCount,
+                        .firstCommand = surfacesFirstCommand[slot],
+                        .model = modelIndex,
+                        .view = view,
+                        // the shadow passes may not cull the same faces than the camera
+                        .coneCulling = ((view == CAMERA_VIEW) && coneCulling &&
+                                        (material != nullptr) && (material->cullMode == CULLMODE_BACK)) ? 1u : 0u,
+                        .drawCount = slot,
+                    });
+                    surfacesDrawCount[slot] = range.meshletCount;
+                }
+            }
+        }
+        if (!jobs.empty()) {
+            jobsBuffers[currentFrame]->writeToBuffer(jobs.data(), sizeof(CullingJob) * jobs.size());
+        }
+    }
+
+    void MeshletCullingRenderer::recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+        if (jobs.empty()) return;
+        bindShader(commandBuffer, *cullingShader);
+        uint32_t offset = 0; // Hi-Z level UBO
+        bindDescriptorSets(commandBuffer, currentFrame, 1, &offset, VK_PIPELINE_BIND_POINT_COMPUTE);
+        vkCmdDispatch(commandBuffer, static_cast<uint32_t>(jobs.size()), 1, 1);
+    }
+
+    void MeshletCullingRenderer::declareResources(RenderGraphPass& pass, uint32_t currentFrame) {
+        if (commandsBuffers[currentFrame] == nullptr) return;
+        // the Hi-Z pyramid of the previous frame, read before the depth prepass builds the new one
+        if (occlusionCulling && (hizImage != VK_NULL_HANDLE)) {
+            pass.readImage(hizImage, VK_IMAGE_LAYOUT_GENERAL,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                           VK_IMAGE_ASPECT_COLOR_BIT, true);
+        }
+        pass.writeBuffer(commandsBuffers[currentFrame]->getBuffer(),
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT);
+        pass.writeBuffer(drawCountsBuffers[currentFrame]->getBuffer(),
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT);
+    }
+
+    void MeshletCullingRenderer::readCommands(RenderGraphPass& pass, uint32_t currentFrame) const {
+        if (commandsBuffers[currentFrame] == nullptr) return;
+        pass.readBuffer(commandsBuffers[currentFrame]->getBuffer(),
+                        VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+        pass.readBuffer(drawCountsBuffers[currentFrame]->getBuffer(),
+                        VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+    }
+
+    void MeshletCullingRenderer::declareHiZBuild(RenderGraphPass& pass) {
+        hizPhase = 0;
+        if (!occlusionCulling || (hizShader == nullptr) || (hizImage == VK_NULL_HANDLE)) return;
+        // the first level is reduced from the depth prepass buffer, each next level from the previous one
+        pass.nextPhase();
+        hizPhase = pass.getPhase();
+        pass.readImage(depthBuffer->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                       VK_IMAGE_ASPECT_DEPTH_BIT);
+        for (uint32_t level = 0; level < hizLevels; level++) {
+            if (level > 0) pass.nextPhase();
+            pass.writeImage(hizImage, VK_IMAGE_LAYOUT_GENERAL,
+                            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                            VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT);
+        }
+    }
+
+    bool MeshletCullingRenderer::drawSurface(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t view,
+                                             Node::id_t meshInstanceId, Mesh& mesh, uint32_t surfaceIndex) {
+        const auto modelIndex = modelIndices.find(meshInstanceId);
+        if ((modelIndex == modelIndices.end()) || mesh.getMeshlets().empty()) return false;
+        const auto slot = view * surfacesCount + modelsFirstSurface[modelIndex->second] + surfaceIndex;
+        // no culling job for this surface in this frame, its draw count have not been written
+        if (surfacesDrawCount[slot] == 0) return true;
+        mesh._getModel()->drawIndirectCount(commandBuffer,
+                                            commandsBuffers[currentFrame]->getBuffer(),
+                                            surfacesFirstCommand[slot] * sizeof(VkDrawIndexedIndirectCommand),
+                                            drawCountsBuffers[currentFrame]->getBuffer(),
+                                            slot * sizeof(uint32_t),
+                                            surfacesDrawCount[slot]);
+        return true;
+    }
+
+    void MeshletCullingRenderer::buildHiZ(VkCommandBuffer commandBuffer, const VulkanRenderer& renderer) {
+        if (hizPhase == 0) return;
+        // the render graph waits for the culling of this frame to have read the previous pyramid,
+        // the depth buffer goes back to the attachment layout with the scene pass declarations
+        bindShader(commandBuffer, *hizShader);
+        for (uint32_t level = 0; level < hizLevels; level++) {
+            vulkanDevice.beginPassPhase(commandBuffer, renderer, hizPhase + level);
+            auto offset = static_cast<uint32_t>(hizLevelsBuffers[recordingFrame]->getAlignmentSize() * level);
+            bindDescriptorSets(commandBuffer, recordingFrame, 1, &offset, VK_PIPELINE_BIND_POINT_COMPUTE);
+            vkCmdDispatch(commandBuffer,
+                          (std::max(hizWidth >> level, 1u) + 7) / 8,
+                          (std::max(hizHeight >> level, 1u) + 7) / 8,
+                          1);
+        }
+        hizBuilt = true;
+    }
+
+    void MeshletCullingRenderer::createDescriptorSetLayout() {
+        if (meshes.empty() || currentCamera == nullptr) return;
+        globalPool = VulkanDescriptorPool::Builder(vulkanDevice)
+                .setMaxSets(MAX_FRAMES_IN_FLIGHT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6 * MAX_FRAMES_IN_FLIGHT) // views, meshlets, models, jobs, commands & counts
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * MAX_FRAMES_IN_FLIGHT) // Hi-Z pyramid & depth buffer
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, HIZ_MAX_LEVELS * MAX_FRAMES_IN_FLIGHT) // Hi-Z levels
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT) // Hi-Z level UBO
+                .build();
+
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            viewsBuffers[i] = std::make_unique<VulkanBuffer>(
+                    vulkanDevice, sizeof(ViewUniform), viewsCount,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            viewsBuffers[i]->map();
+            modelsBuffers[i] = std::make_unique<VulkanBuffer>(
+                    vulkanDevice, sizeof(glm::mat4), static_cast<uint32_t>(meshes.size()),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            modelsBuffers[i]->map();
+            jobsBuffers[i] = std::make_unique<VulkanBuffer>(
+                    vulkanDevice, sizeof(CullingJob), std::max(viewsCount * surfacesCount, 1u),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            jobsBuffers[i]->map();
+            commandsBuffers[i] = std::make_unique<VulkanBuffer>(
+                    vulkanDevice, sizeof(VkDrawIndexedIndirectCommand), std::max(commandsCount, 1u),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+            drawCountsBuffers[i] = std::make_unique<VulkanBuffer>(
+                    vulkanDevice, sizeof(uint32_t), std::max(viewsCount * surfacesCount, 1u),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        }
+        // Index of the Hi-Z level to build, selected with the dynamic offset
+        createUniformBuffers(hizLevelsBuffers, sizeof(uint32_t), HIZ_MAX_LEVELS);
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            for (uint32_t level = 0; level < HIZ_MAX_LEVELS; level++) {
+                hizLevelsBuffers[i]->writeToBuffer(&level, sizeof(uint32_t), hizLevelsBuffers[i]->getAlignmentSize() * level);
+            }
+        }
+
+        globalSetLayout = VulkanDescriptorSetLayout::Builder(vulkanDevice)
+            .addBinding(0, // views
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, // meshlets
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(2, // models
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(3, // jobs
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(4, // indirect commands
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(5, // Hi-Z pyramid
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(6, // depth prepass buffer
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(7, // Hi-Z levels
+                        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                        VK_SHADER_STAGE_COMPUTE_BIT,
+                        HIZ_MAX_LEVELS)
+            .addBinding(8, // Hi-Z level UBO
+                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(9, // draw counts
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+        createImagesResources();
+        writeDescriptorSets();
+    }
+
+    void MeshletCullingRenderer::writeDescriptorSets() {
+        for (uint32_t i = 0; i < descriptorSets.size(); i++) {
+            auto viewsBufferInfo = viewsBuffers[i]->descriptorInfo();
+            auto meshletsBufferInfo = meshletsBuffer->descriptorInfo();
+            auto modelsBufferInfo = modelsBuffers[i]->descriptorInfo();
+            auto jobsBufferInfo = jobsBuffers[i]->descriptorInfo();
+            auto commandsBufferInfo = commandsBuffers[i]->descriptorInfo();
+            auto drawCountsBufferInfo = drawCountsBuffers[i]->descriptorInfo();
+            auto hizLevelBufferInfo = hizLevelsBuffers[i]->descriptorInfo(sizeof(uint32_t));
+            VkDescriptorImageInfo hizInfo{
+                .sampler = hizSampler,
+                .imageView = hizImageView,
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+            };
+            std::vector<VkDescriptorImageInfo> hizLevelsInfo{};
+            for (uint32_t level = 0; level < HIZ_MAX_LEVELS; level++) {
+                // unused levels of the array points to the last level
+                hizLevelsInfo.push_back({
+                    .sampler = VK_NULL_HANDLE,
+                    .imageView = hizLevelsViews[std::min(level, hizLevels - 1)],
+                    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+                });
+            }
+            auto writer = VulkanDescriptorWriter(*globalSetLayout, *globalPool)
+                .writeBuffer(0, &viewsBufferInfo)
+                .writeBuffer(1, &meshletsBufferInfo)
+                .writeBuffer(2, &modelsBufferInfo)
+                .writeBuffer(3, &jobsBufferInfo)
+                .writeBuffer(4, &commandsBufferInfo)
+                .writeImage(5, &hizInfo)
+                .writeImage(7, hizLevelsInfo.data())
+                .writeBuffer(8, &hizLevelBufferInfo)
+                .writeBuffer(9, &drawCountsBufferInfo);
+            VkDescriptorImageInfo depthInfo{
+                .sampler = hizSampler,
+                .imageView = depthBuffer->getImageView(),
+                .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            };
+            if (occlusionCulling) {
+                writer.writeImage(6, &depthInfo);
+            }
+            if (descriptorSets[i] == VK_NULL_HANDLE) {
+                if (!writer.build(descriptorSets[i])) {
+                    die("Cannot allocate descriptor set");
+                }
+            } else {
+                writer.overwrite(descriptorSets[i]);
+            }
+        }
+    }
+
+    void MeshletCullingRenderer::createImagesResources() {
+        // Power of two level 0, so each texel of a level covers exactly 2x2 texels of the previous level
+        const auto& extent = vulkanDevice.getSwapChainExtent();
+        hizWidth = std::bit_floor(std::max(extent.width, 1u));
+        hizHeight = std::bit_floor(std::max(extent.height, 1u));
+        hizLevels = std::min(static_cast<uint32_t>(std::bit_width(std::max(hizWidth, hizHeight))), HIZ_MAX_LEVELS);
+        vulkanDevice.createImage(hizWidth, hizHeight, hizLevels,
+                                 VK_SAMPLE_COUNT_1_BIT,
+                                 VK_FORMAT_R32_SFLOAT,
+                                 VK_IMAGE_TILING_OPTIMAL,
+                                 VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                 MEMORY_ATTACHMENTS,
+                                 hizImage, hizImageAllocation);
+        hizImageView = vulkanDevice.createImageView(hizImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, hizLevels);
+        for (uint32_t level = 0; level < hizLevels; level++) {
+            const VkImageViewCreateInfo viewInfo{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .image = hizImage,
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = VK_FORMAT_R32_SFLOAT,
+                .subresourceRange = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .baseMipLevel = level,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            };
+            VkImageView levelView;
+            if (vkCreateImageView(device, &viewInfo, nullptr, &levelView) != VK_SUCCESS) {
+                die("failed to create Hi-Z level image view!");
+            }
+            hizLevelsViews.push_back(levelView);
+        }
+        // texels are read with texelFetch()
+        const VkSamplerCreateInfo samplerInfo{
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .magFilter = VK_FILTER_NEAREST,
+            .minFilter = VK_FILTER_NEAREST,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .maxAnisotropy = 1.0f,
+            .minLod = 0.0f,
+            .maxLod = VK_LOD_CLAMP_NONE,
+        };
+        if (vkCreateSampler(device, &samplerInfo, nullptr, &hizSampler) != VK_SUCCESS) {
+            die("failed to create Hi-Z sampler!");
+        }
+        // The pyramid stays in the general layout for both the storage and the sampled accesses,
+        // transitioned by the render graph on its first use
+        hizBuilt = false;
+    }
+
+    void MeshletCullingRenderer::cleanupImagesResources() {
+        if (hizSampler != VK_NULL_HANDLE) {
+            vkDestroySampler(device, hizSampler, nullptr);
+            hizSampler = VK_NULL_HANDLE;
+        }
+        for (auto levelView : hizLevelsViews) {
+            vkDestroyImageView(device, levelView, nullptr);
+        }
+        hizLevelsViews.clear();
+        if (hizImage != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, hizImageView, nullptr);
+            vulkanDevice.destroyImage(hizImage, hizImageAllocation);
+            hizImageView = VK_NULL_HANDLE;
+            hizImage = VK_NULL_HANDLE;
+            hizImageAllocation = VK_NULL_HANDLE;
+        }
+    }
+
+    void MeshletCullingRenderer::recreateImagesResources() {
+        // the depth prepass buffer is recreated after this renderer, the descriptors are updated on the next frame
+        hizDirty = hizImage != VK_NULL_HANDLE;
+    }
+
+    // Compute only, nothing to render
+    void MeshletCullingRenderer::beginRendering(VkCommandBuffer commandBuffer) {
+    }
+
+    void MeshletCullingRenderer::endRendering(VkCommandBuffer commandBuffer) {
+    }
+
+}
@@ -6,33 +6,45 @@
 #include "z0/nodes/skybox.hpp"
 #include "z0/nodes/spot_light.hpp"
 #include "z0/nodes/directional_light.hpp"
+#include "z0/application.hpp"
+#include "z0/utils/parallel_for.hpp"
+#include "z0/utils/frustum.hpp"
 #include "z0/log.hpp"
 
+#include <algorithm>
 #include <array>
+#include <limits>
 #include <set>
 
 namespace z0 {
 
     SceneRenderer::SceneRenderer(VulkanDevice &dev, std::string sDir) :
             BaseMeshesRenderer{dev, sDir},
-            colorAttachmentMultisampled{dev, true} {
+            textureTable{dev},
+            textureStreamer{dev, textureTable},
+            deferred{Application::getConfig().renderingMode == RENDERING_DEFERRED} {
         createImagesResources();
      }
 
     void SceneRenderer::cleanup() {
-        for (const auto& shadowMapRenderer : shadowMapRenderers) {
-            shadowMapRenderer->cleanup();
-        }
+        if (shadowMapRenderer != nullptr) shadowMapRenderer->cleanup();
         if (skyboxRenderer != nullptr) skyboxRenderer->cleanup();
-        shadowMapRenderers.clear();
+        if (deferredLightingRenderer != nullptr) deferredLightingRenderer->cleanup();
+        forwardShaders.clear();
+        gBufferShaders.clear();
+        shadowMapRenderer.reset();
+        shadowAtlas.reset();
         shadowMaps.clear();
         opaquesMeshes.clear();
         transparentsMeshes.clear();
-        depthPrepassRenderer->cleanup();
-        images.clear();
+        if (depthPrepassRenderer != nullptr) depthPrepassRenderer->cleanup();
+        if (meshletCulling != nullptr) meshletCulling->cleanup();
+        imagesIndices.clear();
+        textureStreamer.cleanup();
+        textureTable.cleanup();
         shadowMapsBuffers.clear();
         surfacesBuffers.clear();
-        pointLightBuffers.clear();
+        if (lightClusters != nullptr) lightClusters->cleanup();
         BaseMeshesRenderer::cleanup();
     }
 
@@ -40,17 +52,14 @@ namespace z0 {
         loadNode(rootNode);
         createImagesIndex(rootNode);
 
-        // Build indices collections for uniform buffer to model & surfaces relations
+        // Build indices collection for uniform buffer to model relations
         // Build transparent objets sorted collection
         std::multiset<DistanceSortedNode> sortedTransparentNodes;
-        uint32_t surfaceIndex = 0;
         uint32_t modelIndex = 0;
         for (const auto &meshInstance: meshes) {
             modelIndices[meshInstance->getId()] = modelIndex;
             auto transparent = false;
             for (const auto &material: meshInstance->getMesh()->_getMaterials()) {
-                surfacesIndices[material->getId()] = surfaceIndex;
-                surfaceIndex += 1;
                 if (auto* standardMaterial = dynamic_cast<StandardMaterial*>(material.get())) {
                     if (standardMaterial->transparency != TRANSPARENCY_DISABLED) {
                         transparent = true;
@@ -67,17 +76,52 @@ namespace z0 {
         for (const auto& node: sortedTransparentNodes) {
             transparentsMeshes.push_back(dynamic_cast<MeshInstance*>(&node.getNode()));
         }
+        for (auto& shadowMap : shadowMaps) {
+            // the directional light cascades are fitted to the camera frustum
+            shadowMap->setCamera(currentCamera);
+        }
+        if (!shadowMaps.empty()) {
+            shadowAtlas = std::make_shared<ShadowAtlas>(vulkanDevice);
+        }
 
+        if (currentCamera != nullptr) {
+            lightClusters = std::make_shared<LightClustersRenderer>(vulkanDevice, shaderDirectory);
+            const auto maxLights = std::min(static_cast<uint32_t>(omniLights.size()), Application::getConfig().maxVisibleLights);
+            lightClusters->loadScene(maxLights, sizeof(PointLightUniform));
+            lightCuller.resize(omniLights.size());
+            pointLightsArray.resize(maxLights);
+        }
+        // the scene lighting is part of the forward shaders permutations
+        if (directionalLight != nullptr) lightingPermutation |= PERMUTATION_DIRECTIONAL_LIGHT;
+        if (!omniLights.empty()) lightingPermutation |= PERMUTATION_POINT_LIGHTS;
+        if (!shadowMaps.empty()) lightingPermutation |= PERMUTATION_SHADOWS;
         createResources();
 
-        for (auto& shadowMap : shadowMaps) {
-            auto shadowMapRenderer = std::make_shared<ShadowMapRenderer>(vulkanDevice, shaderDirectory);
-            shadowMapRenderer->loadScene(shadowMap, meshes);
-            shadowMapRenderers.push_back(shadowMapRenderer);
+        if (deferred && !meshes.empty() && (currentCamera != nullptr)) {
+            deferredLightingRenderer = std::make_unique<DeferredLightingRenderer>(vulkanDevice, shaderDirectory);
+            deferredLightingRenderer->loadScene(gBuffer, resolvedDepthBuffer, colorAttachmentHdr,
+                                                lightClusters, shadowAtlas, shadowMapsBuffers);
+            colorAttachmentMultisampled->cleanupImagesResources();
+            colorAttachmentMultisampled.reset();
+        }
+
+        if (Application::getConfig().meshletCulling && vulkanDevice.isDrawIndirectCountSupported() &&
+            !meshes.empty() && (currentCamera != nullptr)) {
+            meshletCulling = std::make_shared<MeshletCullingRenderer>(vulkanDevice, shaderDirectory);
+            meshletCulling->loadScene(currentCamera, depthBuffer, shadowMaps, meshes);
+        }
+        if (shadowAtlas != nullptr) {
+            shadowMapRenderer = std::make_shared<ShadowMapRenderer>(vulkanDevice, shaderDirectory);
+            shadowMapRenderer->loadScene(shadowAtlas, shadowMaps, currentCamera, meshes,
+                                         meshletCulling, MeshletCullingRenderer::CAMERA_VIEW + 1);
             vulkanDevice.registerRenderer(shadowMapRenderer);
         }
-        depthPrepassRenderer->loadScene(depthBuffer, currentCamera, opaquesMeshes);
-        vulkanDevice.registerRenderer(depthPrepassRenderer);
+        if (depthPrepassRenderer != nullptr) {
+            depthPrepassRenderer->loadScene(depthBuffer, currentCamera, opaquesMeshes, meshletCulling);
+            vulkanDevice.registerRenderer(depthPrepassRenderer);
+        }
+        if (lightClusters != nullptr) vulkanDevice.registerRenderer(lightClusters);
+        if (meshletCulling != nullptr) vulkanDevice.registerRenderer(meshletCulling);
     }
 
     void SceneRenderer::loadNode(std::shared_ptr<Node>& parent) {
@@ -99,7 +143,7 @@ namespace z0 {
                 directionalLight = light;
                 log("Using directional light", directionalLight->toString());
                 if (directionalLight->getCastShadows()) {
-                    shadowMaps.push_back(std::make_shared<ShadowMap>(vulkanDevice, directionalLight));
+                    shadowMaps.push_back(std::make_shared<ShadowMap>(directionalLight));
                 }
             }
         }
@@ -113,83 +157,166 @@ namespace z0 {
             omniLights.push_back(omniLight);
             if (omniLight->getCastShadows()) {
                 if (auto *spotLight = dynamic_cast<SpotLight *>(parent.get())) {
-                    shadowMaps.push_back(std::make_shared<ShadowMap>(vulkanDevice, spotLight));
+                    shadowMaps.push_back(std::make_shared<ShadowMap>(spotLight));
                 }
             }
         }
-        createImagesList(parent);
+        if (auto* meshInstance = dynamic_cast<MeshInstance*>(parent.get())) {
+            meshes.push_back(meshInstance);
+        }
         for(auto& child: parent->getChildren()) {
             loadNode(child);
         }
     }
 
-    void SceneRenderer::createImagesList(std::shared_ptr<Node>& node) {
+    void SceneRenderer::createImagesIndex(std::shared_ptr<Node>& node) {
         if (auto* meshInstance = dynamic_cast<MeshInstance*>(node.get())) {
-            meshes.push_back(meshInstance);
             for(const auto& material : meshInstance->getMesh()->_getMaterials()) {
-                if (auto standardMaterial = dynamic_cast<StandardMaterial *>(material.get())) {
+                if (auto* standardMaterial = dynamic_cast<StandardMaterial*>(material.get())) {
                     if (standardMaterial->albedoTexture != nullptr) {
-                        images.insert(standardMaterial->albedoTexture->getImage()._getImage());
+                        addImage(standardMaterial->albedoTexture->getImage());
                     }
                     if (standardMaterial->specularTexture != nullptr) {
-                        images.insert(standardMaterial->specularTexture->getImage()._getImage());
+                        addImage(standardMaterial->specularTexture->getImage());
                     }
                     if (standardMaterial->normalTexture != nullptr) {
-                        images.insert(standardMaterial->normalTexture->getImage()._getImage());
+                        addImage(standardMaterial->normalTexture->getImage());
                     }
                 }
             }
         }
+        for(auto& child: node->getChildren()) {
+            createImagesIndex(child);
+        }
     }
 
-    void SceneRenderer::createImagesIndex(std::shared_ptr<Node>& node) {
-        if (auto* meshInstance = dynamic_cast<MeshInstance*>(node.get())) {
-            for(const auto& material : meshInstance->getMesh()->_getMaterials()) {
+    void SceneRenderer::addImage(Image& image) {
+        if (!imagesIndices.contains(image.getId())) {
+            imagesIndices[image.getId()] = textureTable.add(image._getImage());
+            textureStreamer.add(image._getImage());
+        }
+    }
+
+    void SceneRenderer::requestTexturesLevels() {
+        const Frustum frustum{currentCamera->getProjection() * currentCamera->getView()};
+        const auto viewportHeight = static_cast<float>(vulkanDevice.getSwapChainExtent().height);
+        for (const auto* meshInstance : meshes) {
+            const auto bounds = meshInstance->getWorldBounds();
+            if (frustum.isOutside(glm::vec3{bounds}, bounds.w)) continue;
+            const auto screenSize = meshInstance->getScreenSize(*currentCamera, viewportHeight);
+            for (const auto& material : meshInstance->getMesh()->_getMaterials()) {
                 if (auto* standardMaterial = dynamic_cast<StandardMaterial*>(material.get())) {
-                    if (standardMaterial->albedoTexture != nullptr) {
-                        auto &image = standardMaterial->albedoTexture->getImage();
-                        auto index = std::distance(std::begin(images), images.find(image._getImage()));
-                        imagesIndices[image.getId()] = static_cast<int32_t>(index);
-                    }
-                    if (standardMaterial->specularTexture != nullptr) {
-                        auto &image = standardMaterial->specularTexture->getImage();
-                        auto index = std::distance(std::begin(images), images.find(image._getImage()));
-                        imagesIndices[image.getId()] = static_cast<int32_t>(index);
-                    }
-                    if (standardMaterial->normalTexture != nullptr) {
-                        auto &image = standardMaterial->normalTexture->getImage();
-                        auto index = std::distance(std::begin(images), images.find(image._getImage()));
-                        imagesIndices[image.getId()] = static_cast<int32_t>(index);
+                    for (const auto& texture : {standardMaterial->albedoTexture,
+                                                standardMaterial->specularTexture,
+                                                standardMaterial->normalTexture}) {
+                        if (texture != nullptr) {
+                            textureStreamer.request(texture->getImage()._getImage().get(), screenSize);
+                        }
                     }
                 }
             }
         }
-        for(auto& child: node->getChildren()) {
-            createImagesIndex(child);
-        }
+        textureStreamer.update();
     }
 
     void SceneRenderer::loadShaders() {
         if (skyboxRenderer != nullptr) skyboxRenderer->loadShaders();
         vertShader = createShader("default.vert", VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT);
-        fragShader = createShader("default.frag", VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+        // Build the permutations used by the scene now to avoid hitches while drawing
+        const auto toGBuffer = deferred && (currentCamera != nullptr);
+        std::set<std::pair<uint32_t, bool>> usedPermutations;
+        for (const auto* meshInstance : opaquesMeshes) {
+            for (const auto& surface : meshInstance->getMesh()->getSurfaces()) {
+                usedPermutations.insert({getPermutation(surface->material.get(), toGBuffer), toGBuffer});
+            }
+        }
+        for (const auto* meshInstance : transparentsMeshes) {
+            for (const auto& surface : meshInstance->getMesh()->getSurfaces()) {
+                usedPermutations.insert({getPermutation(surface->material.get(), false), false});
+            }
+        }
+        // The permutations are independent shaders, created on worker threads
+        const std::vector<std::pair<uint32_t, bool>> permutations{usedPermutations.begin(), usedPermutations.end()};
+        std::vector<std::unique_ptr<VulkanShader>> shaders(permutations.size());
+        parallelFor(static_cast<uint32_t>(permutations.size()), [&](uint32_t index) {
+            shaders[index] = createShaderPermutation(permutations[index].first, permutations[index].second);
+        });
+        for (uint32_t i = 0; i < permutations.size(); i++) {
+            auto& cache = permutations[i].second ? gBufferShaders : forwardShaders;
+            cache[permutations[i].first] = std::move(shaders[i]);
+        }
+    }
+
+    uint32_t SceneRenderer::getPermutation(const Material* material, bool toGBuffer) const {
+        // the lighting is done later for the G-buffer
+        uint32_t permutation = toGBuffer ? 0 : lightingPermutation;
+        if (const auto* standardMaterial = dynamic_cast<const StandardMaterial*>(material)) {
+            if (standardMaterial->albedoTexture != nullptr) permutation |= PERMUTATION_DIFFUSE_TEXTURE;
+            if (standardMaterial->normalTexture != nullptr) permutation |= PERMUTATION_NORMAL_TEXTURE;
+            if (standardMaterial->specularTexture != nullptr) permutation |= PERMUTATION_SPECULAR_TEXTURE;
+            if ((standardMaterial->transparency == TRANSPARENCY_SCISSOR) ||
+                (standardMaterial->transparency == TRANSPARENCY_SCISSOR_ALPHA)) {
+                permutation |= PERMUTATION_ALPHA_SCISSOR;
+            }
+            if ((standardMaterial->transparency == TRANSPARENCY_ALPHA) ||
+                (standardMaterial->transparency == TRANSPARENCY_SCISSOR_ALPHA)) {
+                permutation |= PERMUTATION_ALPHA_BLENDING;
+            }
+        }
+        return permutation;
+    }
+
+    VulkanShader& SceneRenderer::getShaderPermutation(uint32_t permutation, bool toGBuffer) {
+        std::lock_guard<std::mutex> lock(shadersMutex);
+        auto& shaders = toGBuffer ? gBufferShaders : forwardShaders;
+        if (const auto it = shaders.find(permutation); it != shaders.end()) {
+            return *(it->second);
+        }
+        auto shader = createShaderPermutation(permutation, toGBuffer);
+        auto& result = *shader;
+        shaders[permutation] = std::move(shader);
+        return result;
+    }
+
+    std::unique_ptr<VulkanShader> SceneRenderer::createShaderPermutation(uint32_t permutation, bool toGBuffer) {
+        std::vector<uint32_t> constants(PERMUTATIONS_COUNT);
+        for (uint32_t i = 0; i < PERMUTATIONS_COUNT; i++) {
+            constants[i] = (permutation & (1 << i)) ? VK_TRUE : VK_FALSE;
+        }
+        const auto name = toGBuffer ? std::string{"gbuffer.frag"} : "default.frag" + ShadowAtlas::getFilterShaderVariant();
+        return createShader(name, VK_SHADER_STAGE_FRAGMENT_BIT, 0, constants);
     }
 
     void SceneRenderer::update(uint32_t currentFrame) {
         if (currentCamera == nullptr) return;
         if (skyboxRenderer != nullptr) skyboxRenderer->update(currentCamera, currentFrame);
         if (meshes.empty() ) return;
+        snapshotMeshes(currentFrame);
+        requestTexturesLevels();
+        textureTable.update(descriptorSets[currentFrame], TEXTURES_BINDING, currentFrame);
 
         GobalUniformBufferObject globalUbo{
             .projection = currentCamera->getProjection(),
             .view = currentCamera->getView(),
-            .cameraPosition = currentCamera->getPosition(),
+            .cameraPosition = currentCamera->getPositionInterpolated(),
             .shadowMapsCount = static_cast<uint32_t>(shadowMaps.size()),
+            .clustersNear = currentCamera->getNearDistance(),
+            .clustersFar = currentCamera->getFarDistance(),
+            .clustersTileSize = lightClusters->getTileSize(),
         };
 
+        // The scene renderer is updated before the shadow map renderer : pack the atlas tiles of this frame first
+        if (shadowMapRenderer != nullptr) { shadowMapRenderer->allocateTiles(); }
         auto shadowMapArray =  std::make_unique<ShadowMapUniform[]>(globalUbo.shadowMapsCount);
         for(uint32_t i=0; i < globalUbo.shadowMapsCount; i++) {
-            shadowMapArray[i].lightSpace = shadowMaps[i]->getLightSpace();
+            shadowMapArray[i].cascadesCount = shadowMaps[i]->getCascadesCount();
+            for (uint32_t cascade = 0; cascade < shadowMapArray[i].cascadesCount; cascade++) {
+                shadowMapArray[i].lightSpace[cascade] = shadowMaps[i]->getLightSpace(cascade);
+                const auto& tile = shadowMaps[i]->getTile(cascade);
+                shadowMapArray[i].tiles[cascade] = glm::vec4{tile.x, tile.y, tile.size, tile.size} /
+                                                   static_cast<float>(ShadowAtlas::SIZE);
+                shadowMapArray[i].cascadeSplits[cascade] = shadowMaps[i]->getCascadeSplit(cascade);
+            }
             shadowMapArray[i].lightPos = shadowMaps[i]->getLightPosition();
         }
         writeUniformBuffer(shadowMapsBuffers, currentFrame, shadowMapArray.get());
@@ -205,32 +332,70 @@ namespace z0 {
         if (environement != nullptr) {
             globalUbo.ambient = environement->getAmbientColorAndIntensity();
         }
-        globalUbo.pointLightsCount = omniLights.size();
+
+        for(uint32_t i=0; i < omniLights.size(); i++) {
+            lightCuller.setLight(i,
+                                 omniLights[i]->getPositionInterpolated(),
+                                 omniLights[i]->getRange(),
+                                 omniLights[i]->getColorAndIntensity().w);
+        }
+        const auto& visibleLights = lightCuller.cull(globalUbo.projection * globalUbo.view,
+                                                     currentCamera->getPositionInterpolated(),
+                                                     currentCamera->getNearDistance(),
+                                                     pointLightsArray.size());
+        globalUbo.pointLightsCount = visibleLights.size();
         writeUniformBuffer(globalBuffers, currentFrame, &globalUbo);
 
-        auto pointLightsArray =  std::make_unique<PointLightUniform[]>(globalUbo.pointLightsCount);
         for(uint32_t i=0; i < globalUbo.pointLightsCount; i++) {
-            pointLightsArray[i].position = omniLights[i]->getPosition();
-            pointLightsArray[i].color = omniLights[i]->getColorAndIntensity();
-            pointLightsArray[i].specular = omniLights[i]->getSpecularIntensity();
-            pointLightsArray[i].constant = omniLights[i]->getAttenuation();
-            pointLightsArray[i].linear = omniLights[i]->getLinear();
-            pointLightsArray[i].quadratic = omniLights[i]->getQuadratic();
-            if (auto* spot = dynamic_cast<SpotLight*>(omniLights[i])) {
-                pointLightsArray[i].isSpot = true;
-                pointLightsArray[i].direction = spot->getDirection();
-                pointLightsArray[i].cutOff = spot->getCutOff();
-                pointLightsArray[i].outerCutOff =spot->getOuterCutOff();
+            auto* omniLight = omniLights[visibleLights[i]];
+            auto& pointLight = pointLightsArray[i];
+            pointLight.position = omniLight->getPositionInterpolated();
+            pointLight.color = omniLight->getColorAndIntensity();
+            pointLight.specular = omniLight->getSpecularIntensity();
+            pointLight.constant = omniLight->getAttenuation();
+            pointLight.linear = omniLight->getLinear();
+            pointLight.quadratic = omniLight->getQuadratic();
+            pointLight.range = omniLight->getRange();
+            if (auto* spot = dynamic_cast<SpotLight*>(omniLight)) {
+                pointLight.isSpot = true;
+                pointLight.direction = spot->getDirection();
+                pointLight.cutOff = spot->getCutOff();
+                pointLight.outerCutOff = spot->getOuterCutOff();
+            } else {
+                pointLight.isSpot = false;
             }
         }
-        if (globalUbo.pointLightsCount > 0) writeUniformBuffer(pointLightBuffers, currentFrame, pointLightsArray.get());
+        lightClusters->writeLights(currentFrame, *currentCamera, pointLightsArray.data(), globalUbo.pointLightsCount);
+
+        if (deferredLightingRenderer != nullptr) {
+            const DeferredLightingRenderer::LightingUniformBufferObject lightingUbo{
+                .inverseViewProjection = glm::inverse(globalUbo.projection * globalUbo.view),
+                .view = globalUbo.view,
+                .ambient = globalUbo.ambient,
+                .clearColor = {clearColor.color.float32[0], clearColor.color.float32[1],
+                               clearColor.color.float32[2], clearColor.color.float32[3]},
+                .cameraPosition = globalUbo.cameraPosition,
+                .directionalLight = {
+                    .direction = globalUbo.directionalLight.direction,
+                    .color = globalUbo.directionalLight.color,
+                    .specular = globalUbo.directionalLight.specular,
+                },
+                .haveDirectionalLight = globalUbo.haveDirectionalLight,
+                .shadowMapsCount = globalUbo.shadowMapsCount,
+                .clustersNear = globalUbo.clustersNear,
+                .clustersFar = globalUbo.clustersFar,
+                .clustersTileSize = globalUbo.clustersTileSize,
+            };
+            deferredLightingRenderer->update(currentFrame, lightingUbo);
+        }
 
         uint32_t modelIndex = 0;
         uint32_t surfaceIndex = 0;
         for (const auto&meshInstance: meshes) {
             if (meshInstance->getMesh()->isValid()) {
+                // the surfaces of a mesh are consecutive in the buffer, in the order of the surfaces snapshots
                 ModelUniformBufferObject modelUbo {
-                    .matrix = meshInstance->getTransformGlobal(),
+                    .matrix = meshInstance->getTransformInterpolated(),
                 };
                 writeUniformBuffer(modelsBuffers, currentFrame, &modelUbo, modelIndex);
                 for (const auto &surface: meshInstance->getMesh()->getSurfaces()) {
@@ -250,6 +415,8 @@ namespace z0 {
                         surfaceUbo.alphaScissor = standardMaterial->alphaScissor;
                     }
                     writeUniformBuffer(surfacesBuffers, currentFrame, &surfaceUbo, surfaceIndex);
+                    // only the material bits, the lighting bits are added by the forward passes
+                    surfacesSnapshots[currentFrame][surfaceIndex].permutation = getPermutation(surface->material.get(), true);
                     surfaceIndex += 1;
                 }
             }
@@ -259,43 +426,206 @@ namespace z0 {
 
     void SceneRenderer::recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
         if (currentCamera == nullptr) return;
-        if (!meshes.empty()) {
-            setInitialState(commandBuffer);
-            vkCmdSetDepthWriteEnable(commandBuffer, VK_FALSE); // we have a depth prepass
-            vkCmdSetDepthCompareOp(commandBuffer, VK_COMPARE_OP_EQUAL); // comparing with the depth prepass
-            drawMeshes(commandBuffer, currentFrame, opaquesMeshes);
+        if (deferredLightingRenderer != nullptr) {
+            recordDeferredCommands(commandBuffer, currentFrame);
+            return;
+        }
+        const auto colorFormat = colorAttachmentMultisampled->getFormat();
+        const VkCommandBufferInheritanceRenderingInfo renderingInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat,
+            .depthAttachmentFormat = depthBuffer->getFormat(),
+            .rasterizationSamples = vulkanDevice.getSamples(),
+        };
+        recordDrawLists(commandBuffer, currentFrame, renderingInfo, {
+            {opaquesMeshes, false, [this](VkCommandBuffer secondary) {
+                setOpaquesDepthStates(secondary);
+            }},
+            {transparentsMeshes, false, [](VkCommandBuffer secondary) {
+                vkCmdSetDepthWriteEnable(secondary, VK_TRUE);
+                vkCmdSetDepthCompareOp(secondary, VK_COMPARE_OP_LESS_OR_EQUAL);
+            }},
+        }, skyboxRenderer != nullptr);
+    }
+
+    void SceneRenderer::setOpaquesDepthStates(VkCommandBuffer commandBuffer) const {
+        if (depthBuffer->isTransient()) {
+            // no depth prepass, the depth buffer only lives in the tile memory of this pass
             vkCmdSetDepthWriteEnable(commandBuffer, VK_TRUE);
             vkCmdSetDepthCompareOp(commandBuffer, VK_COMPARE_OP_LESS_OR_EQUAL);
-            drawMeshes(commandBuffer, currentFrame, transparentsMeshes);
+        } else {
+            vkCmdSetDepthWriteEnable(commandBuffer, VK_FALSE); // we have a depth prepass
+            vkCmdSetDepthCompareOp(commandBuffer, VK_COMPARE_OP_EQUAL); // comparing with the depth prepass
         }
-        if (skyboxRenderer != nullptr) skyboxRenderer->recordCommands(commandBuffer, currentFrame);
     }
 
-    void SceneRenderer::drawMeshes(VkCommandBuffer commandBuffer, uint32_t currentFrame, const std::vector<MeshInstance*>& meshesToDraw) {
+    void SceneRenderer::recordDrawLists(VkCommandBuffer commandBuffer, uint32_t currentFrame,
+                                        const VkCommandBufferInheritanceRenderingInfo& renderingInfo,
+                                        const std::vector<DrawList>& drawLists, bool drawSkybox) {
+        struct Chunk {
+            const DrawList* drawList;
+            uint32_t begin;
+            uint32_t end;
+        };
+        std::vector<Chunk> chunks;
+        for (const auto& drawList : drawLists) {
+            const auto count = static_cast<uint32_t>(drawList.meshes.size());
+            for (uint32_t begin = 0; begin < count; begin += MESHES_PER_COMMAND_BUFFER) {
+                chunks.push_back({&drawList, begin, std::min(begin + MESHES_PER_COMMAND_BUFFER, count)});
+            }
+        }
+        // the skybox is the last chunk, without meshes
+        if (drawSkybox) {
+            chunks.push_back({drawLists.empty() ? nullptr : &drawLists.back(), 0, 0});
+        }
+        std::vector<VkCommandBuffer> commandBuffers(chunks.size());
+        parallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t index) {
+            const auto& chunk = chunks[index];
+            // the states of the primary command buffer are not inherited
+            const auto secondary = vulkanDevice.beginFrameSecondaryCommandBuffer(renderingInfo);
+            vulkanDevice.setInitialState(secondary);
+            setInitialState(secondary);
+            if (chunk.drawList != nullptr) {
+                chunk.drawList->setStates(secondary);
+            }
+            if (chunk.begin < chunk.end) {
+                drawMeshes(secondary, currentFrame,
+                           std::span{chunk.drawList->meshes}.subspan(chunk.begin, chunk.end - chunk.begin),
+                           chunk.drawList->toGBuffer);
+            } else {
+                skyboxRenderer->recordCommands(secondary, currentFrame);
+            }
+            if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+                die("failed to record command buffer!");
+            }
+            commandBuffers[index] = secondary;
+        });
+        if (!commandBuffers.empty()) {
+            vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+        }
+    }
+
+    // https://learnopengl.com/Advanced-Lighting/Deferred-Shading
+    void SceneRenderer::recordDeferredCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+        // Geometry pass : opaques surfaces into the multisampled G-buffer
+        const VkCommandBufferInheritanceRenderingInfo gBufferRenderingInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+            .colorAttachmentCount = GBuffer::ATTACHMENTS_COUNT,
+            .pColorAttachmentFormats = GBuffer::formats.data(),
+            .depthAttachmentFormat = depthBuffer->getFormat(),
+            .rasterizationSamples = vulkanDevice.getSamples(),
+        };
+        recordDrawLists(commandBuffer, currentFrame, gBufferRenderingInfo, {{opaquesMeshes, true, [this](VkCommandBuffer secondary) {
+            std::array<VkBool32, GBuffer::ATTACHMENTS_COUNT> blendEnables;
+            std::array<VkColorBlendEquationEXT, GBuffer::ATTACHMENTS_COUNT> blendEquations;
+            std::array<VkColorComponentFlags, GBuffer::ATTACHMENTS_COUNT> writeMasks;
+            for (uint32_t i = 0; i < GBuffer::ATTACHMENTS_COUNT; i++) {
+                blendEnables[i] = VK_FALSE;
+                blendEquations[i] = {
+                    .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+                    .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+                    .colorBlendOp = VK_BLEND_OP_ADD,
+                    .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+                    .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+                    .alphaBlendOp = VK_BLEND_OP_ADD,
+                };
+                writeMasks[i] = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+            }
+            vkCmdSetColorBlendEnableEXT(secondary, 0, blendEnables.size(), blendEnables.data());
+            vkCmdSetColorBlendEquationEXT(secondary, 0, blendEquations.size(), blendEquations.data());
+            vkCmdSetColorWriteMaskEXT(secondary, 0, writeMasks.size(), writeMasks.data());
+            setOpaquesDepthStates(secondary);
+        }}}, false);
+        vkCmdEndRendering(commandBuffer);
+
+        // Lighting pass : compute shader reading the resolved G-buffer & depth, writing the HDR color attachment
+        vulkanDevice.beginPassPhase(commandBuffer, *this, LIGHTING_PHASE);
+        deferredLightingRenderer->recordCommands(commandBuffer, currentFrame);
+
+        // Forward pass : transparents surfaces & skybox over the lighted image, without multisampling
+        const VkRenderingAttachmentInfo colorAttachmentInfo{
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+                .imageView = colorAttachmentHdr->getImageView(),
+                .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                .resolveMode = VK_RESOLVE_MODE_NONE,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        };
+        const VkRenderingAttachmentInfo depthAttachmentInfo{
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+                .imageView = resolvedDepthBuffer->getImageView(),
+                .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                .resolveMode = VK_RESOLVE_MODE_NONE,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        };
+        const VkRenderingInfo renderingInfo{
+                .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+                .pNext = nullptr,
+                .flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, // draws recorded by recordDrawLists()
+                .renderArea = {{0, 0}, vulkanDevice.getSwapChainExtent()},
+                .layerCount = 1,
+                .colorAttachmentCount = 1,
+                .pColorAttachments = &colorAttachmentInfo,
+                .pDepthAttachment = &depthAttachmentInfo,
+                .pStencilAttachment = nullptr
+        };
+        vulkanDevice.beginPassPhase(commandBuffer, *this, FORWARD_PHASE);
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+        const auto colorFormat = colorAttachmentHdr->getFormat();
+        const VkCommandBufferInheritanceRenderingInfo forwardRenderingInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat,
+            .depthAttachmentFormat = resolvedDepthBuffer->getFormat(),
+            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        };
+        recordDrawLists(commandBuffer, currentFrame, forwardRenderingInfo, {{transparentsMeshes, false, [](VkCommandBuffer secondary) {
+            vkCmdSetRasterizationSamplesEXT(secondary, VK_SAMPLE_COUNT_1_BIT);
+            const VkSampleMask sampleMask = 0xffffffff;
+            vkCmdSetSampleMaskEXT(secondary, VK_SAMPLE_COUNT_1_BIT, &sampleMask);
+            vkCmdSetDepthWriteEnable(secondary, VK_TRUE);
+            vkCmdSetDepthCompareOp(secondary, VK_COMPARE_OP_LESS_OR_EQUAL);
+        }}}, skyboxRenderer != nullptr);
+    }
+
+    void SceneRenderer::drawMeshes(VkCommandBuffer commandBuffer, uint32_t currentFrame, std::span<MeshInstance* const> meshesToDraw,
+                                   bool toGBuffer) {
+        // only bind the fragment shader when the permutation changes between two surfaces
+        auto boundPermutation = std::numeric_limits<uint32_t>::max();
+        const auto& surfaces = surfacesSnapshots[currentFrame];
         for (const auto& meshInstance : meshesToDraw) {
-            auto modelIndex = modelIndices[meshInstance->getId()];
-            auto mesh = meshInstance->getMesh();
-            if (mesh->isValid()) {
+            // the node ids do not change, the other states are read from the snapshots
+            const auto modelIndex = modelIndices.at(meshInstance->getId());
+            const auto& snapshot = meshesSnapshots[currentFrame][modelIndex];
+            if (const auto& mesh = snapshot.mesh) {
+                const auto lod = snapshot.lod;
+                uint32_t meshSurfaceIndex = 0;
                 for (const auto& surface: mesh->getSurfaces()) {
-                    const auto& material = surface->material.get();
-                    if (auto standardMaterial = dynamic_cast<StandardMaterial*>(material)) {
-                        vkCmdSetCullMode(commandBuffer,
-                                         standardMaterial->cullMode == CULLMODE_DISABLED ? VK_CULL_MODE_NONE :
-                                         standardMaterial->cullMode == CULLMODE_BACK ? VK_CULL_MODE_BACK_BIT
-                                                                                     : VK_CULL_MODE_FRONT_BIT);
-                    } else {
-                        vkCmdSetCullMode(commandBuffer, VK_CULL_MODE_NONE);
+                    const auto surfaceIndex = snapshot.firstSurface + meshSurfaceIndex;
+                    const auto& surfaceSnapshot = surfaces[surfaceIndex];
+                    const auto permutation = toGBuffer ? surfaceSnapshot.permutation :
+                                                         surfaceSnapshot.permutation | lightingPermutation;
+                    if (permutation != boundPermutation) {
+                        bindShader(commandBuffer, getShaderPermutation(permutation, toGBuffer));
+                        boundPermutation = permutation;
                     }
-                    auto surfaceIndex = surfacesIndices[material->getId()];
-                    std::array<uint32_t, 5> offsets = {
+                    vkCmdSetCullMode(commandBuffer, surfaceSnapshot.cullMode);
+                    std::array<uint32_t, 4> offsets = {
                             0, // globalBuffers
                             static_cast<uint32_t>(modelsBuffers[currentFrame]->getAlignmentSize() * modelIndex),
                             static_cast<uint32_t>(surfacesBuffers[currentFrame]->getAlignmentSize() * surfaceIndex),
-                            0, // pointLightBuffers
                             0, // shadowMapsBuffers
                     };
                     bindDescriptorSets(commandBuffer, currentFrame, offsets.size(), offsets.data());
-                    mesh->_getModel()->draw(commandBuffer, surface->firstVertexIndex, surface->indexCount);
+                    if ((meshletCulling == nullptr) ||
+                        !meshletCulling->drawSurface(commandBuffer, currentFrame, MeshletCullingRenderer::CAMERA_VIEW,
+                                                     snapshot.id, *mesh, meshSurfaceIndex)) {
+                        const auto range = surface->getLod(lod);
+                        mesh->_getModel()->draw(commandBuffer, range.firstIndex, range.indexCount);
+                    }
+                    meshSurfaceIndex += 1;
                 }
             }
         }
@@ -307,12 +637,13 @@ namespace z0 {
         if (meshes.empty()) return;
         globalPool = VulkanDescriptorPool::Builder(vulkanDevice)
                 .setMaxSets(MAX_FRAMES_IN_FLIGHT)
+                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT) // textures table
                 .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT) // global UBO
-                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_FRAMES_IN_FLIGHT) // textures
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textureTable.getCapacity() * MAX_FRAMES_IN_FLIGHT) // textures
                 .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT) // model UBO
                 .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT) // surfaces UBO
-                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT) // pointlightarray UBO
-                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_FRAMES_IN_FLIGHT) // shadow map
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * MAX_FRAMES_IN_FLIGHT) // point lights & clusters
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * MAX_FRAMES_IN_FLIGHT) // shadow atlas & depths
                 .build();
 
         // Global UBO
@@ -332,10 +663,6 @@ namespace z0 {
         }
         createUniformBuffers(surfacesBuffers, surfaceBufferSize, surfaceCount);
 
-        // PointLight array UBO
-        VkDeviceSize pointLightBufferSize = sizeof(PointLightUniform) * (omniLights.size()+ (omniLights.empty() ? 1 : 0));
-        createUniformBuffers(pointLightBuffers, pointLightBufferSize);
-
         // Shadow maps UBO
         VkDeviceSize shadowMapBufferSize = sizeof(ShadowMapUniform) * (shadowMaps.size()+ (shadowMaps.empty() ? 1 : 0));
         createUniformBuffers(shadowMapsBuffers, shadowMapBufferSize);
@@ -344,60 +671,73 @@ namespace z0 {
             .addBinding(0, // global UBO
                     VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                     VK_SHADER_STAGE_ALL_GRAPHICS)
-            .addBinding(1, // textures
-                       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                       VK_SHADER_STAGE_FRAGMENT_BIT,
-                       images.size())
+            .addBinding(1, // shadow atlas depths, not written if the scene have no shadows
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_FRAGMENT_BIT,
+                        1,
+                        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT)
             .addBinding(2, // model UBO
                         VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                         VK_SHADER_STAGE_VERTEX_BIT)
             .addBinding(3, // surfaces UBO
                         VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                         VK_SHADER_STAGE_FRAGMENT_BIT)
-            .addBinding(4, // PointLight array UBO
-                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .addBinding(4, // PointLight array
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
                         VK_SHADER_STAGE_FRAGMENT_BIT)
             .addBinding(5, // shadow maps infos
                         VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                         VK_SHADER_STAGE_FRAGMENT_BIT)
-            .addBinding(6, // shadow maps
+            .addBinding(6, // shadow atlas, not written if the scene have no shadows
+                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        VK_SHADER_STAGE_FRAGMENT_BIT,
+                        1,
+                        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT)
+            .addBinding(7, // lights clusters
+                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(TEXTURES_BINDING, // textures table, must be the last binding (variable size)
                         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                         VK_SHADER_STAGE_FRAGMENT_BIT,
-                        shadowMaps.size())
+                        textureTable.getCapacity(),
+                        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                        VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT)
            .build();
 
         for (uint32_t i = 0; i < descriptorSets.size(); i++) {
             auto globalBufferInfo = globalBuffers[i]->descriptorInfo(sizeof(GobalUniformBufferObject));
             auto modelBufferInfo = modelsBuffers[i]->descriptorInfo(modelBufferSize);
             auto surfaceBufferInfo = surfacesBuffers[i]->descriptorInfo(surfaceBufferSize);
-            auto pointLightBufferInfo = pointLightBuffers[i]->descriptorInfo(pointLightBufferSize);
+            auto pointLightBufferInfo = lightClusters->getLightsBuffer(i).descriptorInfo();
+            auto clustersBufferInfo = lightClusters->getClustersBuffer(i).descriptorInfo();
             auto shadowMapBufferInfo = shadowMapsBuffers[i]->descriptorInfo(shadowMapBufferSize);
-            std::vector<VkDescriptorImageInfo> imagesInfo{};
-            for(const auto& image : images) {
-                imagesInfo.push_back(image->imageInfo());
-            }
+            // the textures are written by the textures table
             auto writer = VulkanDescriptorWriter(*globalSetLayout, *globalPool)
                 .writeBuffer(0, &globalBufferInfo)
-                .writeImage(1, imagesInfo.data())
                 .writeBuffer(2, &modelBufferInfo)
                 .writeBuffer(3, &surfaceBufferInfo)
                 .writeBuffer(4, &pointLightBufferInfo)
-                .writeBuffer(5, &shadowMapBufferInfo);
-            std::vector<VkDescriptorImageInfo> shadowMapsInfo{};
-            if (shadowMaps.empty()) {
-                VkDescriptorImageInfo imageInfo = imagesInfo[0]; // find a better solution (blank image ?)
-                writer.writeImage(6, &imageInfo);
-            } else {
-                for (const auto &shadowMap: shadowMaps) {
-                    shadowMapsInfo.push_back(VkDescriptorImageInfo{
-                        .sampler = shadowMap->getSampler(),
-                        .imageView = shadowMap->getImageView(),
-                        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
-                    });
-                }
-                writer.writeImage(6, shadowMapsInfo.data());
+                .writeBuffer(5, &shadowMapBufferInfo)
+                .writeBuffer(7, &clustersBufferInfo);
+            VkDescriptorImageInfo shadowAtlasInfo;
+            VkDescriptorImageInfo shadowAtlasDepthInfo;
+            if (shadowAtlas != nullptr) {
+                shadowAtlasInfo = {
+                    .sampler = shadowAtlas->getSampler(),
+                    .imageView = shadowAtlas->getImageView(),
+                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                };
+                shadowAtlasDepthInfo = {
+                    .sampler = shadowAtlas->getDepthSampler(),
+                    .imageView = shadowAtlas->getImageView(),
+                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                };
+                writer.writeImage(6, &shadowAtlasInfo);
+                writer.writeImage(1, &shadowAtlasDepthInfo);
             }
-            if (!writer.build(descriptorSets[i])) {
+            if (!writer.build(descriptorSets[i], textureTable.getCapacity())) {
                 die("Cannot allocate descriptor set");
             }
         }
@@ -406,18 +746,36 @@ namespace z0 {
     void SceneRenderer::recreateImagesResources() {
         cleanupImagesResources();
         colorAttachmentHdr->createImagesResources();
-        colorAttachmentMultisampled.createImagesResources();
+        if (colorAttachmentMultisampled != nullptr) {
+            colorAttachmentMultisampled->createImagesResources();
+        }
         if (depthBuffer != nullptr) {
+            // without depth prepass renderer the multisampled depth buffer is ours
+            if (depthPrepassRenderer == nullptr) depthBuffer->createImagesResources();
             resolvedDepthBuffer->createImagesResources();
         }
+        if (gBuffer != nullptr) {
+            gBuffer->createImagesResources();
+        }
+        if (deferredLightingRenderer != nullptr) {
+            deferredLightingRenderer->recreateImagesResources();
+        }
     }
 
     void SceneRenderer::createImagesResources() {
-        colorAttachmentHdr = std::make_shared<ColorAttachmentHDR>(vulkanDevice);
+        colorAttachmentHdr = std::make_shared<ColorAttachmentHDR>(vulkanDevice, COLOR_ALIASING_SLOT);
         if (depthBuffer == nullptr) {
+            // the forward multisampled attachment is no longer used by the postprocessing passes
+            colorAttachmentMultisampled = std::make_unique<ColorAttachment>(
+                vulkanDevice, true, deferred ? BaseFrameBuffer::NO_ALIASING : SCENE_ALIASING_SLOT);
             depthBuffer = std::make_shared<DepthBuffer>(vulkanDevice, true);
             resolvedDepthBuffer = std::make_shared<DepthBuffer>(vulkanDevice, false);
-            depthPrepassRenderer = std::make_shared<DepthPrepassRenderer>(vulkanDevice, shaderDirectory);
+            if (!depthBuffer->isTransient()) {
+                depthPrepassRenderer = std::make_shared<DepthPrepassRenderer>(vulkanDevice, shaderDirectory);
+            }
+            if (deferred) {
+                gBuffer = std::make_shared<GBuffer>(vulkanDevice, SCENE_ALIASING_SLOT);
+            }
         } else {
             depthBuffer->createImagesResources();
         }
@@ -425,35 +783,99 @@ namespace z0 {
 
     void SceneRenderer::cleanupImagesResources() {
         if (depthBuffer != nullptr) {
+            if (depthPrepassRenderer == nullptr) depthBuffer->cleanupImagesResources();
             resolvedDepthBuffer->cleanupImagesResources();
         }
+        if (gBuffer != nullptr) {
+            gBuffer->cleanupImagesResources();
+        }
         colorAttachmentHdr->cleanupImagesResources();
-        colorAttachmentMultisampled.cleanupImagesResources();
+        if (colorAttachmentMultisampled != nullptr) {
+            colorAttachmentMultisampled->cleanupImagesResources();
+        }
+    }
+
+    // The attachments are cleared or fully resolved, their previous content is discarded.
+    // The lighting & forward passes of the deferred mode are declared in the next phases of the pass
+    void SceneRenderer::declareResources(RenderGraphPass& pass, uint32_t currentFrame) {
+        constexpr auto depthStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        constexpr auto depthAccess = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        // read by the forward shaders, the deferred lighting & the transparents surfaces
+        if (shadowAtlas != nullptr) {
+            pass.readImage(shadowAtlas->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                           VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+        }
+        if ((lightClusters != nullptr) &&
+            ((deferredLightingRenderer != nullptr) || (lightingPermutation & PERMUTATION_POINT_LIGHTS))) {
+            pass.readBuffer(lightClusters->getClustersBuffer(currentFrame).getBuffer(),
+                            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                            VK_ACCESS_2_SHADER_READ_BIT);
+        }
+        if (meshletCulling != nullptr) meshletCulling->readCommands(pass, currentFrame);
+        // the depth prepass output, or cleared by this pass without depth prepass
+        pass.writeImage(depthBuffer->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        depthStages, depthAccess, VK_IMAGE_ASPECT_DEPTH_BIT, depthBuffer->isTransient());
+        // the resolve is done in the color attachment output stage
+        pass.writeImage(resolvedDepthBuffer->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        depthStages | VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        depthAccess | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_ASPECT_DEPTH_BIT, true);
+        if (deferredLightingRenderer != nullptr) {
+            for (uint32_t i = 0; i < GBuffer::ATTACHMENTS_COUNT; i++) {
+                pass.writeImage(gBuffer->getAttachment(i).getImage(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                                VK_IMAGE_ASPECT_COLOR_BIT, true);
+                pass.writeImage(gBuffer->getResolvedAttachment(i).getImage(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                                VK_IMAGE_ASPECT_COLOR_BIT, true);
+            }
+            // the lighting pass reads the resolved G-buffer & depth
+            pass.nextPhase();
+            for (uint32_t i = 0; i < GBuffer::ATTACHMENTS_COUNT; i++) {
+                pass.readImage(gBuffer->getResolvedAttachment(i).getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+            }
+            pass.readImage(resolvedDepthBuffer->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                           VK_IMAGE_ASPECT_DEPTH_BIT);
+            pass.writeImage(colorAttachmentHdr->getImage(), VK_IMAGE_LAYOUT_GENERAL,
+                            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                            VK_IMAGE_ASPECT_COLOR_BIT, true);
+            // the forward pass draws over the lighted image
+            pass.nextPhase();
+            pass.writeImage(colorAttachmentHdr->getImage(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+            pass.writeImage(resolvedDepthBuffer->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                            depthStages, depthAccess, VK_IMAGE_ASPECT_DEPTH_BIT);
+        } else {
+            pass.writeImage(colorAttachmentMultisampled->getImage(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                            VK_IMAGE_ASPECT_COLOR_BIT, true);
+            pass.writeImage(colorAttachmentHdr->getImage(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                            VK_IMAGE_ASPECT_COLOR_BIT, true);
+        }
     }
 
     // https://lesleylai.info/en/vk-khr-dynamic-rendering/
     void SceneRenderer::beginRendering(VkCommandBuffer commandBuffer) {
-        vulkanDevice.transitionImageLayout(commandBuffer, colorAttachmentMultisampled.getImage(),
-                                           VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                           0, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                           VK_IMAGE_ASPECT_COLOR_BIT);
-        vulkanDevice.transitionImageLayout(commandBuffer, colorAttachmentHdr->getImage(),
-                                           VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                           0, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                           VK_IMAGE_ASPECT_COLOR_BIT);
-        // Color attachement : where the rendering is done (multisampled memory image)
+        if (deferredLightingRenderer != nullptr) {
+            beginGBufferRendering(commandBuffer);
+            return;
+        }
+        // Color attachement : where the rendering is done (multisampled transient image)
         // Resolved into a non multisampled image
         const VkRenderingAttachmentInfo colorAttachmentInfo{
                 .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
-                .imageView = colorAttachmentMultisampled.getImageView(),
+                .imageView = colorAttachmentMultisampled->getImageView(),
                 .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                 .resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT ,
                 .resolveImageView = colorAttachmentHdr->getImageView(),
                 .resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                 .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
                 .clearValue = clearColor,
         };
         const VkRenderingAttachmentInfo depthAttachmentInfo{
@@ -462,14 +884,15 @@ namespace z0 {
                 .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
                 .resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT,
                 .resolveImageView = resolvedDepthBuffer->getImageView(),
-                .resolveImageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-                .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+                .resolveImageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                .loadOp = depthBuffer->isTransient() ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
                 .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
                 .clearValue = depthClearValue,
         };
         const VkRenderingInfo renderingInfo{
                 .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
                 .pNext = nullptr,
+                .flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, // draws recorded by recordDrawLists()
                 .renderArea = {{0, 0}, vulkanDevice.getSwapChainExtent()},
                 .layerCount = 1,
                 .colorAttachmentCount = 1,
@@ -480,24 +903,51 @@ namespace z0 {
         vkCmdBeginRendering(commandBuffer, &renderingInfo);
     }
 
-    void SceneRenderer::endRendering(VkCommandBuffer commandBuffer, bool isLast) {
+    void SceneRenderer::beginGBufferRendering(VkCommandBuffer commandBuffer) {
+        std::array<VkRenderingAttachmentInfo, GBuffer::ATTACHMENTS_COUNT> colorAttachmentsInfo;
+        for (uint32_t i = 0; i < GBuffer::ATTACHMENTS_COUNT; i++) {
+            // Rendered in multisampled transient images, resolved into the sampled images
+            colorAttachmentsInfo[i] = {
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+                .imageView = gBuffer->getAttachment(i).getImageView(),
+                .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                .resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT,
+                .resolveImageView = gBuffer->getResolvedAttachment(i).getImageView(),
+                .resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .clearValue = {.color = {0.0f, 0.0f, 0.0f, 0.0f}},
+            };
+        }
+        // The depth prepass output, resolved for the lighting pass & the transparents surfaces.
+        // Cleared for a transient depth buffer, written by the G-buffer pass
+        const VkRenderingAttachmentInfo depthAttachmentInfo{
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+                .imageView = depthBuffer->getImageView(),
+                .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                .resolveMode = VK_RESOLVE_MODE_SAMPLE_ZERO_BIT,
+                .resolveImageView = resolvedDepthBuffer->getImageView(),
+                .resolveImageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                .loadOp = depthBuffer->isTransient() ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .clearValue = depthClearValue,
+        };
+        const VkRenderingInfo renderingInfo{
+                .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+                .pNext = nullptr,
+                .flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, // draws recorded by recordDrawLists()
+                .renderArea = {{0, 0}, vulkanDevice.getSwapChainExtent()},
+                .layerCount = 1,
+                .colorAttachmentCount = GBuffer::ATTACHMENTS_COUNT,
+                .pColorAttachments = colorAttachmentsInfo.data(),
+                .pDepthAttachment = &depthAttachmentInfo,
+                .pStencilAttachment = nullptr
+        };
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+    }
+
+    void SceneRenderer::endRendering(VkCommandBuffer commandBuffer) {
         vkCmdEndRendering(commandBuffer);
-        vulkanDevice.transitionImageLayout(commandBuffer, colorAttachmentHdr->getImage(),
-                                           VK_IMAGE_LAYOUT_UNDEFINED,
-                                           isLast ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                           0,
-                                           isLast ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT,
-                                           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                                           isLast ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                           VK_IMAGE_ASPECT_COLOR_BIT);
-        vulkanDevice.transitionImageLayout(commandBuffer, resolvedDepthBuffer->getImage(),
-                                           VK_IMAGE_LAYOUT_UNDEFINED,
-                                           VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
-                                           0,
-                                           VK_ACCESS_SHADER_READ_BIT,
-                                           VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-                                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                           VK_IMAGE_ASPECT_DEPTH_BIT);
     }
 
 
@@ -5,9 +5,13 @@
 #include "z0/vulkan/renderers/shadowmap_renderer.hpp"
 #include "z0/nodes/spot_light.hpp"
 #include "z0/nodes/camera.hpp"
+#include "z0/application.hpp"
 #include "z0/log.hpp"
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cmath>
 
 namespace z0 {
 
@@ -16,14 +20,40 @@ namespace z0 {
 
     void ShadowMapRenderer::cleanup() {
         cleanupImagesResources();
-        shadowMap.reset();
+        shadowAtlas.reset();
+        shadowMaps.clear();
+        meshletCulling.reset();
+        casters.clear();
         modelsBuffers.clear();
         BaseRenderpass::cleanup();
     }
 
-    void ShadowMapRenderer::loadScene(std::shared_ptr<ShadowMap>& _shadowMap, std::vector<MeshInstance*>& _meshes) {
+    void ShadowMapRenderer::loadScene(std::shared_ptr<ShadowAtlas>& _shadowAtlas, std::vector<std::shared_ptr<ShadowMap>>& _shadowMaps,
+                                      Camera* _camera, std::vector<MeshInstance*>& _meshes,
+                                      const std::shared_ptr<MeshletCullingRenderer>& _meshletCulling, uint32_t _cullingView) {
         meshes = _meshes;
-        shadowMap = _shadowMap;
+        currentCamera = _camera;
+        shadowAtlas = _shadowAtlas;
+        shadowMaps = _shadowMaps;
+        meshletCulling = _meshletCulling;
+        cullingView = _cullingView;
+        casters.clear();
+        for (const auto& meshInstance : meshes) {
+            casters.push_back({
+                .transform = meshInstance->getTransformInterpolated(),
+                .mesh = meshInstance->getMesh(),
+                .lod = 0,
+                .unchangedFrames = 0,
+                .dynamic = !shadowAtlas->isCached(),
+            });
+        }
+        views.clear();
+        for (const auto& shadowMap : shadowMaps) {
+            for (uint32_t cascade = 0; cascade < shadowMap->getCascadesCount(); cascade++) {
+                views.push_back({ .shadowMap = shadowMap.get(), .cascade = cascade });
+            }
+        }
+        atlasRendered = false;
         createResources();
     }
 
@@ -31,31 +61,155 @@ namespace z0 {
         vertShader = createShader("shadowmap.vert", VK_SHADER_STAGE_VERTEX_BIT, 0);
     }
 
-    void ShadowMapRenderer::update(uint32_t currentFrame) {
-        GlobalUniformBufferObject globalUbo {
-            .lightSpace = shadowMap->getLightSpace()
-        };
-        writeUniformBuffer(globalBuffers, currentFrame, &globalUbo);
+    // Size of the tile of a spot light from the ratio of the screen height covered by its light sphere
+    uint32_t ShadowMapRenderer::getSpotTileSize(const ShadowMap& shadowMap) {
+        auto* spotLight = dynamic_cast<SpotLight*>(shadowMap.getLight());
+        if ((currentCamera == nullptr) || (spotLight == nullptr)) { return shadowMap.size; }
+        const auto position = spotLight->getPositionInterpolated();
+        const auto range = spotLight->getRange();
+        const auto& projection = currentCamera->getProjection();
+        if (Frustum{projection * currentCamera->getView()}.isOutside(position, range)) {
+            return ShadowAtlas::MIN_TILE_SIZE;
+        }
+        const auto distance = std::max(glm::distance(currentCamera->getPositionInterpolated(), position),
+                                       currentCamera->getNearDistance());
+        const auto coverage = std::min(range * projection[1][1] / distance, 1.0f);
+        const auto size = static_cast<uint32_t>(coverage * static_cast<float>(shadowMap.size));
+        return std::clamp(std::bit_ceil(size), ShadowAtlas::MIN_TILE_SIZE, shadowMap.size);
+    }
+
+    void ShadowMapRenderer::allocateTiles() {
+        std::vector<uint32_t> sizes{};
+        for (const auto& view : views) {
+            sizes.push_back(view.shadowMap->isDirectional() ? view.shadowMap->size : getSpotTileSize(*view.shadowMap));
+        }
+        // Keep the packing, and the cached static tiles, while the requested sizes do not change
+        if ((sizes == requestedSizes) && (tiles.size() == views.size())) { return; }
+        requestedSizes = sizes;
+        tiles.clear();
+        for (const auto size : sizes) {
+            tiles.push_back({ .size = size });
+        }
+        // Over budget : halve the largest spot lights tiles, the cascades keep their size for the texels snapping
+        while (!ShadowAtlas::allocate(tiles)) {
+            auto largest = tiles.end();
+            for (auto tile = tiles.begin(); tile != tiles.end(); tile++) {
+                const auto& view = views[tile - tiles.begin()];
+                if (!view.shadowMap->isDirectional() && (tile->size > 0) &&
+                    ((largest == tiles.end()) || (tile->size > largest->size))) {
+                    largest = tile;
+                }
+            }
+            if (largest == tiles.end()) { die("Shadow atlas too small for the directional light cascades"); }
+            // The spot lights which do not fit at the minimum size do not cast shadows
+            largest->size = largest->size > ShadowAtlas::MIN_TILE_SIZE ? largest->size / 2 : 0;
+        }
+        for (uint32_t index = 0; index < views.size(); index++) {
+            views[index].shadowMap->setTile(views[index].cascade, tiles[index]);
+        }
+    }
 
+    void ShadowMapRenderer::update(uint32_t currentFrame) {
+        // A static caster which moves becomes dynamic and a dynamic caster which stops moving goes back
+        // in the static layer, both invalidate the static layer. A static caster which changes of LOD
+        // only invalidates the static layer
+        auto staticChanged = false;
+        const auto& config = Application::getConfig();
         uint32_t modelIndex = 0;
         for (const auto&meshInstance: meshes) {
+            auto& caster = casters[modelIndex];
+            const auto transform = meshInstance->getTransformInterpolated();
+            auto mesh = meshInstance->getMesh();
+            // LOD selected from the camera point of view, with a coarser bias
+            const auto lod = (currentCamera == nullptr) || !mesh->isValid() ? 0 :
+                             meshInstance->getLod(*currentCamera,
+                                                  static_cast<float>(vulkanDevice.getSwapChainExtent().height),
+                                                  config.lodPixelError * config.shadowLodBias);
+            if (shadowAtlas->isCached()) {
+                if ((transform != caster.transform) || (mesh != caster.mesh)) {
+                    staticChanged |= !caster.dynamic;
+                    caster.dynamic = true;
+                    caster.unchangedFrames = 0;
+                } else if (caster.dynamic && (++caster.unchangedFrames >= STATIC_CASTER_FRAMES)) {
+                    caster.dynamic = false;
+                    staticChanged = true;
+                } else if (!caster.dynamic && (lod != caster.lod)) {
+                    staticChanged = true;
+                }
+            }
+            caster.transform = transform;
+            caster.mesh = std::move(mesh);
+            caster.lod = lod;
+            caster.cullModes.clear();
+            if (caster.mesh->isValid()) {
+                for (const auto& surface : caster.mesh->getSurfaces()) {
+                    caster.cullModes.push_back(getCullMode(surface->material.get()));
+                }
+            }
             ModelUniformBufferObject modelUbo{
-                .matrix = meshInstance->getTransformGlobal(),
+                .matrix = transform,
             };
             writeUniformBuffer(modelsBuffers, currentFrame, &modelUbo, modelIndex);
             modelIndex += 1;
         }
+
+        // The tiles are allocated by the scene renderer before writing the shadow maps uniforms
+        viewsFrustums.clear();
+        for (uint32_t index = 0; index < views.size(); index++) {
+            auto& view = views[index];
+            GlobalUniformBufferObject globalUbo {
+                .lightSpace = view.shadowMap->getLightSpace(view.cascade)
+            };
+            writeUniformBuffer(globalBuffers, currentFrame, &globalUbo, index);
+            viewsFrustums.emplace_back(globalUbo.lightSpace);
+
+            const auto& tile = tiles[index];
+            view.renderStatic = shadowAtlas->isCached() && (tile.size > 0) &&
+                                (!view.staticValid || staticChanged ||
+                                 (globalUbo.lightSpace != view.lightSpace) || (tile != view.tile));
+            view.renderDynamic = false;
+            for (uint32_t i = 0; (i < meshes.size()) && (tile.size > 0); i++) {
+                if (casters[i].dynamic && isInView(casters[i], index)) {
+                    view.renderDynamic = true;
+                    break;
+                }
+            }
+            // Without dynamic casters the atlas tile already contains the static layer
+            view.update = (tile.size > 0) &&
+                          (!shadowAtlas->isCached() || view.renderStatic || view.renderDynamic || view.dynamicDrawn);
+            view.lightSpace = globalUbo.lightSpace;
+            view.tile = tile;
+            view.staticValid = tile.size > 0;
+            view.dynamicDrawn = view.renderDynamic;
+        }
+        renderStaticLayer = std::ranges::any_of(views, [](const ViewState& view) { return view.renderStatic; });
+        const auto anyUpdate = std::ranges::any_of(views, [](const ViewState& view) { return view.update; });
+        copyStaticTiles = shadowAtlas->isCached() && anyUpdate;
+        renderAtlas = anyUpdate || !atlasRendered;
+        atlasRendered = true;
+
+        // only the casters drawn in this frame are kept resident, the evicted models are uploaded again
+        for (const auto& caster : casters) {
+            for (uint32_t index = 0; index < views.size(); index++) {
+                const auto& view = views[index];
+                const auto drawn = caster.dynamic ? (view.update && view.renderDynamic) : view.renderStatic;
+                if (drawn && isInView(caster, index)) {
+                    caster.mesh->_useModel();
+                    break;
+                }
+            }
+        }
     }
 
     void ShadowMapRenderer::recordCommands(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
-        bindShaders(commandBuffer);
+        if (!renderAtlas) { return; }
 
+        bindShaders(commandBuffer);
         vkCmdSetRasterizationSamplesEXT(commandBuffer, VK_SAMPLE_COUNT_1_BIT);
         vkCmdSetDepthTestEnable(commandBuffer, VK_TRUE);
         vkCmdSetDepthWriteEnable(commandBuffer, VK_TRUE);
         vkCmdSetDepthBiasEnable(commandBuffer, VK_TRUE);
         vkCmdSetDepthBias(commandBuffer, depthBiasConstant, 0.0f, depthBiasSlope);
-        setViewport(commandBuffer, shadowMap->size, shadowMap->size);
 
         std::vector<VkVertexInputBindingDescription2EXT> vertexBinding = VulkanModel::getBindingDescription();
         std::vector<VkVertexInputAttributeDescription2EXT> vertexAttribute = VulkanModel::getAttributeDescription();
@@ -65,31 +219,113 @@ namespace z0 {
                                vertexAttribute.size(),
                                vertexAttribute.data());
 
+        // Static casters in the cached atlas
+        if (renderStaticLayer) {
+            beginAtlasRendering(commandBuffer, shadowAtlas->getStaticImageView(), VK_ATTACHMENT_LOAD_OP_LOAD);
+            for (uint32_t index = 0; index < views.size(); index++) {
+                if (!views[index].renderStatic) { continue; }
+                const auto& tile = views[index].tile;
+                const VkClearAttachment clearAttachment{
+                    .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                    .clearValue = depthClearValue,
+                };
+                const VkClearRect clearRect{
+                    .rect = {{static_cast<int32_t>(tile.x), static_cast<int32_t>(tile.y)}, {tile.size, tile.size}},
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                };
+                vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+                drawView(commandBuffer, currentFrame, index, false);
+            }
+            vkCmdEndRendering(commandBuffer);
+        }
+
+        // Copy of the cached tiles in the atlas
+        vulkanDevice.beginPassPhase(commandBuffer, *this, COPY_PHASE);
+        if (copyStaticTiles) {
+            std::vector<VkImageCopy> regions;
+            for (const auto& view : views) {
+                if (!view.update) { continue; }
+                regions.push_back({
+                    .srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 },
+                    .srcOffset = { static_cast<int32_t>(view.tile.x), static_cast<int32_t>(view.tile.y), 0 },
+                    .dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 },
+                    .dstOffset = { static_cast<int32_t>(view.tile.x), static_cast<int32_t>(view.tile.y), 0 },
+                    .extent = { view.tile.size, view.tile.size, 1 },
+                });
+            }
+            vkCmdCopyImage(commandBuffer,
+                           shadowAtlas->getStaticImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           shadowAtlas->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           regions.size(), regions.data());
+        }
+
+        // Dynamic casters on top of the static tiles, or all the casters without cache in the cleared atlas
+        vulkanDevice.beginPassPhase(commandBuffer, *this, ATLAS_PHASE);
+        beginAtlasRendering(commandBuffer, shadowAtlas->getImageView(),
+                            copyStaticTiles ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR);
+        for (uint32_t index = 0; index < views.size(); index++) {
+            if (views[index].update && views[index].renderDynamic) {
+                drawView(commandBuffer, currentFrame, index, true);
+            }
+        }
+        vkCmdEndRendering(commandBuffer);
+        vkCmdSetDepthBiasEnable(commandBuffer, VK_FALSE);
+    }
+
+    bool ShadowMapRenderer::isInView(const CasterState& caster, uint32_t view) const {
+        const auto& mesh = caster.mesh;
+        const auto& transform = caster.transform;
+        const auto maxScale = std::max({glm::length(glm::vec3{transform[0]}),
+                                        glm::length(glm::vec3{transform[1]}),
+                                        glm::length(glm::vec3{transform[2]})});
+        const auto center = glm::vec3{transform * glm::vec4{mesh->getBoundsCenter(), 1.0f}};
+        return mesh->isValid() && !viewsFrustums[view].isOutside(center, mesh->getBoundsRadius() * maxScale);
+    }
+
+    void ShadowMapRenderer::drawView(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t view, bool dynamic) {
+        const auto& tile = views[view].tile;
+        const VkViewport viewport{
+                .x = static_cast<float>(tile.x),
+                .y = static_cast<float>(tile.y),
+                .width = static_cast<float>(tile.size),
+                .height = static_cast<float>(tile.size),
+                .minDepth = 0.0f,
+                .maxDepth = 1.0f
+        };
+        vkCmdSetViewportWithCount(commandBuffer, 1, &viewport);
+        const VkRect2D scissor{
+                .offset = {static_cast<int32_t>(tile.x), static_cast<int32_t>(tile.y)},
+                .extent = {tile.size, tile.size}
+        };
+        vkCmdSetScissorWithCount(commandBuffer, 1, &scissor);
+
+        // the casters states of the frame are the snapshots of the meshes instances
         uint32_t modelIndex = 0;
-        for (const auto&meshInstance: meshes) {
-            auto mesh = meshInstance->getMesh();
-            if (mesh->isValid()) {
+        for (const auto& caster: casters) {
+            // per view casters culling
+            if ((caster.dynamic == dynamic) && isInView(caster, view)) {
+                const auto& mesh = caster.mesh;
+                const auto lod = caster.lod;
+                uint32_t surfaceIndex = 0;
                 for (const auto& surface: mesh->getSurfaces()) {
-                    if (auto standardMaterial = dynamic_cast<StandardMaterial*>(surface->material.get())) {
-                        vkCmdSetCullMode(commandBuffer,
-                                         standardMaterial->cullMode == CULLMODE_DISABLED ? VK_CULL_MODE_NONE :
-                                         standardMaterial->cullMode == CULLMODE_BACK ? VK_CULL_MODE_BACK_BIT
-                                                                                     : VK_CULL_MODE_FRONT_BIT);
-                    } else {
-                        //vkCmdSetCullMode(commandBuffer, VK_CULL_MODE_FRONT_BIT); // default avoid Peter panning
-                        vkCmdSetCullMode(commandBuffer, VK_CULL_MODE_NONE);
-                    }
+                    vkCmdSetCullMode(commandBuffer, caster.cullModes[surfaceIndex]);
                     std::array<uint32_t, 2> offsets = {
-                        0, // globalBuffers
+                        static_cast<uint32_t>(globalBuffers[currentFrame]->getAlignmentSize() * view),
                         static_cast<uint32_t>(modelsBuffers[currentFrame]->getAlignmentSize() * modelIndex),
                     };
                     bindDescriptorSets(commandBuffer, currentFrame, offsets.size(), offsets.data());
-                    mesh->_getModel()->draw(commandBuffer, surface->firstVertexIndex, surface->indexCount);
+                    if ((meshletCulling == nullptr) ||
+                        !meshletCulling->drawSurface(commandBuffer, currentFrame, cullingView + view,
+                                                     meshes[modelIndex]->getId(), *mesh, surfaceIndex)) {
+                        const auto range = surface->getLod(lod);
+                        mesh->_getModel()->draw(commandBuffer, range.firstIndex, range.indexCount);
+                    }
+                    surfaceIndex += 1;
                 }
             }
             modelIndex += 1;
         }
-        vkCmdSetDepthBiasEnable(commandBuffer, VK_FALSE);
     }
 
     void ShadowMapRenderer::createDescriptorSetLayout() {
@@ -99,8 +335,8 @@ namespace z0 {
                 .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT) // model UBO
                 .build();
 
-        // Global UBO
-        createUniformBuffers(globalBuffers, sizeof(GlobalUniformBufferObject));
+        // Global UBO, one light space per view
+        createUniformBuffers(globalBuffers, sizeof(GlobalUniformBufferObject), views.size());
 
         // Models UBO
         VkDeviceSize modelBufferSize = sizeof(ModelUniformBufferObject);
@@ -127,18 +363,17 @@ namespace z0 {
         }
     }
 
+    // The atlas is rendered in recordCommands(), the static tiles first
     void ShadowMapRenderer::beginRendering(VkCommandBuffer commandBuffer) {
-        vulkanDevice.transitionImageLayout(commandBuffer, shadowMap->getImage(),
-                                           VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-                                           0, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
-                                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-                                           VK_IMAGE_ASPECT_DEPTH_BIT);
+    }
+
+    void ShadowMapRenderer::beginAtlasRendering(VkCommandBuffer commandBuffer, VkImageView imageView, VkAttachmentLoadOp loadOp) {
         const VkRenderingAttachmentInfo depthAttachmentInfo{
                 .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
-                .imageView = shadowMap->getImageView(),
+                .imageView = imageView,
                 .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
                 .resolveMode = VK_RESOLVE_MODE_NONE,
-                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .loadOp = loadOp,
                 .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
                 .clearValue = depthClearValue,
         };
@@ -146,7 +381,7 @@ namespace z0 {
                 .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
                 .pNext = nullptr,
                 .renderArea = {{0, 0},
-                               {shadowMap->size, shadowMap->size}},
+                               {ShadowAtlas::SIZE, ShadowAtlas::SIZE}},
                 .layerCount = 1,
                 .colorAttachmentCount = 0,
                 .pColorAttachments = nullptr,
@@ -156,27 +391,42 @@ namespace z0 {
         vkCmdBeginRendering(commandBuffer, &renderingInfo);
     }
 
-    void ShadowMapRenderer::endRendering(VkCommandBuffer commandBuffer, bool isLast) {
-        vkCmdEndRendering(commandBuffer);
-        vulkanDevice.transitionImageLayout(
-                commandBuffer, shadowMap->getImage(),
-                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
-                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, // After depth writes
-                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, // Before depth reads in the shader
-                VK_IMAGE_ASPECT_DEPTH_BIT);
+    void ShadowMapRenderer::endRendering(VkCommandBuffer commandBuffer) {
+    }
+
+    // The static layer, then the copy of the cached tiles, then the atlas. Nothing is declared, and the pass
+    // is culled, when the atlas is unchanged
+    void ShadowMapRenderer::declareResources(RenderGraphPass& pass, uint32_t currentFrame) {
+        if (!renderAtlas) { return; }
+        constexpr auto depthStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        constexpr auto depthAccess = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        if (meshletCulling != nullptr) meshletCulling->readCommands(pass, currentFrame);
+        if (renderStaticLayer) {
+            // the tiles of the static layer are cleared one by one
+            pass.writeImage(shadowAtlas->getStaticImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                            depthStages, depthAccess, VK_IMAGE_ASPECT_DEPTH_BIT);
+        }
+        pass.nextPhase();
+        if (copyStaticTiles) {
+            pass.readImage(shadowAtlas->getStaticImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+            pass.writeImage(shadowAtlas->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+        }
+        pass.nextPhase();
+        pass.writeImage(shadowAtlas->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        depthStages, depthAccess, VK_IMAGE_ASPECT_DEPTH_BIT, !copyStaticTiles);
     }
 
     void ShadowMapRenderer::createImagesResources() {
-        shadowMap->createImagesResources();
     }
 
     void ShadowMapRenderer::cleanupImagesResources() {
-        if (shadowMap != nullptr) shadowMap->cleanupImagesResources();
+        if (shadowAtlas != nullptr) shadowAtlas->cleanupImagesResources();
     }
 
     void ShadowMapRenderer::recreateImagesResources() {
 
     }
 
-}
\ No newline at end of file
+}
@@ -11,8 +11,7 @@ namespace z0 {
     }
 
     void SimplePostprocessingRenderer::loadShaders() {
-        BasePostprocessingRenderer::loadShaders();
-        fragShader = createShader(shaderName + ".frag", VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+        createShaders(shaderName + ".frag");
     }
 
     void SimplePostprocessingRenderer::update(uint32_t currentFrame) {
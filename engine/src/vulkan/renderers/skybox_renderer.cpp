@@ -80,8 +80,7 @@ namespace z0 {
     }
 
     void SkyboxRenderer::loadShaders() {
-        vertShader = createShader("skybox.vert", VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT);
-        fragShader = createShader("skybox.frag", VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+        createLinkedShaders("skybox.vert", "skybox.frag");
     }
 
     void SkyboxRenderer::update(Camera* currentCamera, uint32_t currentFrame) {
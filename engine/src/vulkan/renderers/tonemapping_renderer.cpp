@@ -14,8 +14,7 @@ namespace z0 {
     }
 
     void TonemappingRenderer::loadShaders() {
-        BasePostprocessingRenderer::loadShaders();
-        fragShader = createShader("reinhard.frag", VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+        createShaders("reinhard.frag");
     }
 
     void TonemappingRenderer::update(uint32_t currentFrame) {
@@ -83,5 +82,11 @@ namespace z0 {
         }
     }
 
+    void TonemappingRenderer::declareResources(RenderGraphPass& pass, uint32_t currentFrame) {
+        BasePostprocessingRenderer::declareResources(pass, currentFrame);
+        pass.readImage(resolvedDepthBuffer->getImage(), VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+                       VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                       VK_IMAGE_ASPECT_DEPTH_BIT);
+    }
 
-}
\ No newline at end of file
+}
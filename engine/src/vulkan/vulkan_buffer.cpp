@@ -38,6 +38,9 @@ namespace z0 {
         }
 #ifdef VULKAN_STATS
         VulkanStats::get().buffersCount += 1;
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(vulkanDevice.getAllocator(), allocation, &allocationInfo);
+        VulkanStats::get().memoryUsage[MEMORY_BUFFERS] += allocationInfo.size;
 #endif
     }
 
@@ -46,6 +49,11 @@ namespace z0 {
             vmaUnmapMemory(vulkanDevice.getAllocator(), allocation);
             mapped = nullptr;
         }
+#ifdef VULKAN_STATS
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(vulkanDevice.getAllocator(), allocation, &allocationInfo);
+        VulkanStats::get().memoryUsage[MEMORY_BUFFERS] -= allocationInfo.size;
+#endif
         vmaDestroyBuffer(vulkanDevice.getAllocator(), buffer, allocation);
     }
 
@@ -29,8 +29,8 @@ namespace z0 {
         vulkanDevice.createImage(width, height, 1, VK_SAMPLE_COUNT_1_BIT, format,
                                  VK_IMAGE_TILING_OPTIMAL,
                                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                                 VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
-                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory,
+                                 VK_IMAGE_USAGE_SAMPLED_BIT,
+                                 MEMORY_CUBEMAPS, textureImage, textureImageAllocation,
                                  VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, 6);
 
 
@@ -110,8 +110,7 @@ namespace z0 {
     VulkanCubemap::~VulkanCubemap() {
         vkDestroySampler(vulkanDevice.getDevice(), textureSampler, nullptr);
         vkDestroyImageView(vulkanDevice.getDevice(), textureImageView, nullptr);
-        vkDestroyImage(vulkanDevice.getDevice(), textureImage, nullptr);
-        vkFreeMemory(vulkanDevice.getDevice(), textureImageMemory, nullptr);
+        vulkanDevice.destroyImage(textureImage, textureImageAllocation);
     }
 
     VkDescriptorImageInfo VulkanCubemap::imageInfo() {
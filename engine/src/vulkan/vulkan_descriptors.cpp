@@ -6,8 +6,10 @@
 */
 #include "z0/vulkan/vulkan_descriptors.hpp"
 #include "z0/vulkan/vulkan_stats.hpp"
+#include "z0/vulkan/vulkan_shader_cache.hpp"
 #include "z0/log.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -17,7 +19,8 @@ namespace z0 {
             uint32_t binding,
             VkDescriptorType descriptorType,
             VkShaderStageFlags stageFlags,
-            uint32_t count) {
+            uint32_t count,
+            VkDescriptorBindingFlags bindingFlags) {
         assert(bindings.count(binding) == 0 && "Binding already in use");
         VkDescriptorSetLayoutBinding layoutBinding{
             .binding = binding,
@@ -26,22 +29,40 @@ namespace z0 {
             .stageFlags = stageFlags,
         };
         bindings[binding] = layoutBinding;
+        if (bindingFlags != 0) {
+            bindingsFlags[binding] = bindingFlags;
+        }
         return *this;
     }
 
     std::unique_ptr<VulkanDescriptorSetLayout> VulkanDescriptorSetLayout::Builder::build() const {
-        return std::make_unique<VulkanDescriptorSetLayout>(vulkanDevice, bindings);
+        return std::make_unique<VulkanDescriptorSetLayout>(vulkanDevice, bindings, bindingsFlags);
     }
 
     VulkanDescriptorSetLayout::VulkanDescriptorSetLayout(
-            VulkanDevice &device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+            VulkanDevice &device,
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingsFlags)
             : vulkanDevice{device}, bindings{bindings} {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        // https://docs.vulkan.org/samples/latest/samples/extensions/descriptor_indexing/README.html
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingsFlags{};
+        auto updateAfterBind = false;
         for (auto kv : bindings) {
             setLayoutBindings.push_back(kv.second);
+            const auto flags = bindingsFlags.contains(kv.first) ? bindingsFlags.at(kv.first) : 0;
+            setLayoutBindingsFlags.push_back(flags);
+            updateAfterBind |= (flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
         }
+        const VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+            .bindingCount = static_cast<uint32_t>(setLayoutBindingsFlags.size()),
+            .pBindingFlags = setLayoutBindingsFlags.data(),
+        };
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptorSetLayoutInfo.pNext = bindingsFlags.empty() ? nullptr : &bindingFlagsInfo;
+        descriptorSetLayoutInfo.flags = updateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
         if (vkCreateDescriptorSetLayout(
@@ -51,9 +72,22 @@ namespace z0 {
                 &descriptorSetLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor set layout!");
         }
+        // the shaders cache keys depend on the content of the layout, in the bindings order
+        std::ranges::sort(setLayoutBindings, {}, &VkDescriptorSetLayoutBinding::binding);
+        uint64_t key = VulkanShaderCache::hash(&descriptorSetLayoutInfo.flags, sizeof(descriptorSetLayoutInfo.flags), 0);
+        for (const auto& binding : setLayoutBindings) {
+            const auto flags = bindingsFlags.contains(binding.binding) ? bindingsFlags.at(binding.binding) : 0;
+            key = VulkanShaderCache::hash(&binding.binding, sizeof(binding.binding), key);
+            key = VulkanShaderCache::hash(&binding.descriptorType, sizeof(binding.descriptorType), key);
+            key = VulkanShaderCache::hash(&binding.descriptorCount, sizeof(binding.descriptorCount), key);
+            key = VulkanShaderCache::hash(&binding.stageFlags, sizeof(binding.stageFlags), key);
+            key = VulkanShaderCache::hash(&flags, sizeof(flags), key);
+        }
+        vulkanDevice.getShaderCache().addSetLayout(descriptorSetLayout, key);
     }
 
     VulkanDescriptorSetLayout::~VulkanDescriptorSetLayout() {
+        vulkanDevice.getShaderCache().removeSetLayout(descriptorSetLayout);
         vkDestroyDescriptorSetLayout(vulkanDevice.getDevice(), descriptorSetLayout, nullptr);
     }
 
@@ -102,9 +136,16 @@ namespace z0 {
     }
 
     bool VulkanDescriptorPool::allocateDescriptor(
-            const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor) const {
+            const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor,
+            uint32_t variableDescriptorCount) const {
+        const VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+            .descriptorSetCount = 1,
+            .pDescriptorCounts = &variableDescriptorCount,
+        };
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = variableDescriptorCount == 0 ? nullptr : &variableCountInfo;
         allocInfo.descriptorPool = descriptorPool;
         allocInfo.pSetLayouts = &descriptorSetLayout;
         allocInfo.descriptorSetCount = 1;
@@ -163,8 +204,24 @@ namespace z0 {
         return *this;
     }
 
-    bool VulkanDescriptorWriter::build(VkDescriptorSet &set) {
-        bool success = pool.allocateDescriptor(*setLayout.getDescriptorSetLayout(), set);
+    VulkanDescriptorWriter &VulkanDescriptorWriter::writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo,
+                                                               uint32_t arrayElement, uint32_t count) {
+        assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+        auto &bindingDescription = setLayout.bindings[binding];
+        VkWriteDescriptorSet write{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstBinding = binding,
+            .dstArrayElement = arrayElement,
+            .descriptorCount = count,
+            .descriptorType = bindingDescription.descriptorType,
+            .pImageInfo = imageInfo,
+        };
+        writes.push_back(write);
+        return *this;
+    }
+
+    bool VulkanDescriptorWriter::build(VkDescriptorSet &set, uint32_t variableDescriptorCount) {
+        bool success = pool.allocateDescriptor(*setLayout.getDescriptorSetLayout(), set, variableDescriptorCount);
         if (!success) {
             return false;
         }
@@ -5,6 +5,8 @@
 #include "z0/vulkan/vulkan_model.hpp"
 #include "z0/log.hpp"
 #include "z0/vulkan/vulkan_image.hpp"
+#include "z0/vulkan/vulkan_stats.hpp"
+#include "z0/utils/parallel_for.hpp"
 
 #include <map>
 #include <set>
@@ -24,7 +26,8 @@ namespace z0 {
 
 
     VulkanDevice::VulkanDevice(VulkanInstance& _instance, WindowHelper &_window,
-                               bool autoMSAA, VkSampleCountFlagBits _samples):
+                               bool autoMSAA, VkSampleCountFlagBits _samples,
+                               const std::filesystem::path& shaderCacheDirectory):
         vulkanInstance{_instance}, window{_window}, samples(_samples)
     {
         // Check for at least one supported Vulkan physical device
@@ -62,28 +65,16 @@ namespace z0 {
                 samples = getMaxUsableMSAASampleCount();
             }
             vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+            vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
         } else {
             die("Failed to find a suitable GPU!");
         }
         createDevice();
         createAllocator();
+        residency = std::make_unique<VulkanResidency>(allocator, MAX_FRAMES_IN_FLIGHT);
+        shaderCache = std::make_unique<VulkanShaderCache>(physicalDevice, device, shaderCacheDirectory);
         createSwapChain();
 
-        // Create command buffers
-        // https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Command_buffers
-        {
-            commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-            const VkCommandBufferAllocateInfo allocInfo{
-                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-                .commandPool = commandPool,
-                .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-                .commandBufferCount = static_cast<uint32_t>(commandBuffers.size())
-            };
-            if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-                die("failed to allocate command buffers!");
-            }
-        }
-
         // Create sync objects
         {
             imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -119,7 +110,22 @@ namespace z0 {
             vkDestroyFence(device, inFlightFences[i], nullptr);
         }
         cleanupSwapChain();
+        for (const auto& commandBuffers : frameCommandBuffers) {
+            for (const auto& frameCommandBuffer : commandBuffers) {
+                vkDestroyCommandPool(device, frameCommandBuffer.commandPool, nullptr);
+            }
+        }
+        for (const auto& commandBuffers : frameSecondaryCommandBuffers) {
+            for (const auto& frameCommandBuffer : commandBuffers) {
+                vkDestroyCommandPool(device, frameCommandBuffer.commandPool, nullptr);
+            }
+        }
         vkDestroyCommandPool(device, commandPool, nullptr);
+        for (auto& slot : aliasingSlots) {
+            releaseAliasingSlot(slot);
+        }
+        // the evicted resources of the last frames
+        residency.reset();
         vmaDestroyAllocator(allocator);
         vkDestroyDevice(device, nullptr);
         vkDestroySurfaceKHR(vulkanInstance.getInstance(), surface, nullptr);
@@ -130,13 +136,20 @@ namespace z0 {
     }
 
     void VulkanDevice::registerRenderer(const std::shared_ptr<VulkanRenderer>& renderer) {
-        renderers.insert(renderers.begin(), renderer);
+        renderers.push_back(renderer);
     }
 
     // https://vulkan-tutorial.com/en/Drawing_a_triangle/Drawing/Rendering_and_presentation
-    void VulkanDevice::drawFrame() {
+    bool VulkanDevice::prepareFrame(std::chrono::steady_clock::time_point inputTime) {
+        // GLFW is only used on the main thread
+        if (swapChainOutdated || window._windowResized) {
+            swapChainOutdated = false;
+            recreateSwapChain();
+            for (auto& renderer: renderers) {
+                renderer->recreateImagesResources();
+            }
+        }
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-        uint32_t imageIndex;
         auto result = vkAcquireNextImageKHR(device,
                                                 swapChain,
                                                 UINT64_MAX,
@@ -148,35 +161,68 @@ namespace z0 {
             for (auto& renderer: renderers) {
                 renderer->recreateImagesResources();
             }
-            return;
+            return false;
         } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
             die("failed to acquire swap chain image!");
         }
         vkResetFences(device, 1, &inFlightFences[currentFrame]);
+        // VMA refreshes the heaps budget once per frame
+        frameIndex += 1;
+        vmaSetCurrentFrameIndex(allocator, frameIndex);
+        residency->update();
+        if (outputRenderer == nullptr) {
+            die("No output renderer");
+        }
+        // Snapshot of the nodes states : the uniform buffers of the frame & the renderers draw lists
+        for (auto& renderer: renderers) {
+            renderer->update(currentFrame);
+        }
+        debugUI->newFrame();
+        frameInputTime = inputTime;
+        return true;
+    }
+
+    void VulkanDevice::renderFrame() {
+        std::vector<VkCommandBuffer> commandBuffers;
+        frameSecondaryCommandBuffersCount = 0;
         {
             for (auto& renderer: renderers) {
-                renderer->update(currentFrame);
+                renderer->declareResources(renderGraph.addPass(*renderer), currentFrame);
             }
-            vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-            const VkCommandBufferBeginInfo beginInfo{
-                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-                    .flags = 0,
-                    .pInheritanceInfo = nullptr
-            };
-            if (vkBeginCommandBuffer(commandBuffers[currentFrame], &beginInfo) != VK_SUCCESS) {
-                die("failed to begin recording command buffer!");
+            renderGraph.setOutput(outputRenderer->getImage());
+            renderGraph.compile();
+#ifdef VULKAN_STATS
+            VulkanStats::get().trianglesCount = 0;
+            VulkanStats::get().shaderBindsCount = 0;
+            VulkanStats::get().barriersCount = 0;
+#endif
+            // The barriers depend on the states left by the previous passes : they are recorded here,
+            // in the execution order, before the parallel recording of the passes
+            const auto& passes = renderGraph.getPasses();
+            const auto passesCount = static_cast<uint32_t>(passes.size());
+            commandBuffers.resize(passesCount + 1);
+            for (uint32_t index = 0; index < passesCount; index++) {
+                commandBuffers[index] = beginFrameCommandBuffer(index);
+                setInitialState(commandBuffers[index]);
+                renderGraph.beginPass(commandBuffers[index], *passes[index]);
             }
+            parallelFor(passesCount, [&](uint32_t index) {
+                auto& renderer = passes[index]->getRenderer();
+                renderer.beginRendering(commandBuffers[index]);
+                renderer.recordCommands(commandBuffers[index], currentFrame);
+                renderer.endRendering(commandBuffers[index]);
+                if (vkEndCommandBuffer(commandBuffers[index]) != VK_SUCCESS) {
+                    die("failed to record command buffer!");
+                }
+            });
 
-            setInitialState(commandBuffers[currentFrame]);
-            auto lastRenderer = renderers.back();
-            for (auto& renderer: renderers) {
-                renderer->beginRendering(commandBuffers[currentFrame]);
-                renderer->recordCommands(commandBuffers[currentFrame], currentFrame);
-                renderer->endRendering(commandBuffers[currentFrame], renderer == lastRenderer);
-            }
+            const auto commandBuffer = beginFrameCommandBuffer(passesCount);
+            commandBuffers[passesCount] = commandBuffer;
+            setInitialState(commandBuffer);
+            renderGraph.endFrame(commandBuffer);
 
             transitionImageLayout(
-                    commandBuffers[currentFrame],
+                    commandBuffer,
                     swapChainImages[imageIndex],
                     VK_IMAGE_LAYOUT_UNDEFINED,
                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -185,8 +231,8 @@ namespace z0 {
                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
                     VK_PIPELINE_STAGE_TRANSFER_BIT,
                     VK_IMAGE_ASPECT_COLOR_BIT);
-            vkCmdBlitImage(commandBuffers[currentFrame],
-                           lastRenderer->getImage(),
+            vkCmdBlitImage(commandBuffer,
+                           outputRenderer->getImage(),
                            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
                            swapChainImages[imageIndex],
                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -194,7 +240,7 @@ namespace z0 {
                            &colorImageBlit,
                            VK_FILTER_LINEAR );
             transitionImageLayout(
-                    commandBuffers[currentFrame],
+                    commandBuffer,
                     swapChainImages[imageIndex],
                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                     VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
@@ -205,13 +251,14 @@ namespace z0 {
                     VK_IMAGE_ASPECT_COLOR_BIT);
 
 
-            debugUI->drawFrame(commandBuffers[currentFrame], swapChainImageViews[imageIndex], swapChainExtent);
+            debugUI->drawFrame(commandBuffer, swapChainImageViews[imageIndex], swapChainExtent);
 
-            if (vkEndCommandBuffer(commandBuffers[currentFrame]) != VK_SUCCESS) {
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
                 die("failed to record command buffer!");
             }
         }
 
+        std::lock_guard<std::mutex> lock(queueMutex);
         const VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
         {
             const VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
@@ -221,8 +268,8 @@ namespace z0 {
                     .waitSemaphoreCount     = 1,
                     .pWaitSemaphores        = waitSemaphores,
                     .pWaitDstStageMask      = waitStages,
-                    .commandBufferCount     = 1,
-                    .pCommandBuffers        = &commandBuffers[currentFrame],
+                    .commandBufferCount     = static_cast<uint32_t>(commandBuffers.size()),
+                    .pCommandBuffers        = commandBuffers.data(),
                     .signalSemaphoreCount   = 1,
                     .pSignalSemaphores      = signalSemaphores
             };
@@ -242,20 +289,96 @@ namespace z0 {
                     .pImageIndices      = &imageIndex,
                     .pResults           = nullptr // Optional
             };
-            result = vkQueuePresentKHR(presentQueue, &presentInfo);
-            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window._windowResized) {
-                recreateSwapChain();
-                for (auto& renderer: renderers) {
-                    renderer->recreateImagesResources();
-                }
+            const auto result = vkQueuePresentKHR(presentQueue, &presentInfo);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+                // recreated by the next prepareFrame()
+                swapChainOutdated = true;
             } else if (result != VK_SUCCESS) {
                 die("failed to present swap chain image!");
             }
         }
+        frameLatency.store(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameInputTime).count(),
+                           std::memory_order_relaxed);
 
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
+    // https://arm-software.github.io/vulkan_best_practice_for_mobile_developers/samples/performance/command_buffer_usage/command_buffer_usage_tutorial.html
+    VulkanDevice::FrameCommandBuffer VulkanDevice::createFrameCommandBuffer(VkCommandBufferLevel level) {
+        // the command buffers are never reset individually
+        const VkCommandPoolCreateInfo poolInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = graphicsQueueFamily,
+        };
+        FrameCommandBuffer frameCommandBuffer;
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &frameCommandBuffer.commandPool) != VK_SUCCESS) {
+            die("Failed to create the command pool");
+        }
+        const VkCommandBufferAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = frameCommandBuffer.commandPool,
+            .level = level,
+            .commandBufferCount = 1,
+        };
+        if (vkAllocateCommandBuffers(device, &allocInfo, &frameCommandBuffer.commandBuffer) != VK_SUCCESS) {
+            die("failed to allocate command buffers!");
+        }
+        return frameCommandBuffer;
+    }
+
+    VkCommandBuffer VulkanDevice::beginFrameCommandBuffer(uint32_t index) {
+        auto& commandBuffers = frameCommandBuffers[currentFrame];
+        if (index == commandBuffers.size()) {
+            commandBuffers.push_back(createFrameCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY));
+        } else {
+            // the fence of the frame have been waited for, the previous recording is no longer in use
+            vkResetCommandPool(device, commandBuffers[index].commandPool, 0);
+        }
+        const VkCommandBufferBeginInfo beginInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr
+        };
+        if (vkBeginCommandBuffer(commandBuffers[index].commandBuffer, &beginInfo) != VK_SUCCESS) {
+            die("failed to begin recording command buffer!");
+        }
+        return commandBuffers[index].commandBuffer;
+    }
+
+    VkCommandBuffer VulkanDevice::beginFrameSecondaryCommandBuffer(const VkCommandBufferInheritanceRenderingInfo& renderingInfo) {
+        FrameCommandBuffer frameCommandBuffer;
+        auto reused = true;
+        {
+            // only the choice of the command buffer is locked, the recording threads use different pools
+            std::lock_guard<std::mutex> lock(frameSecondaryCommandBuffersMutex);
+            auto& commandBuffers = frameSecondaryCommandBuffers[currentFrame];
+            if (frameSecondaryCommandBuffersCount == commandBuffers.size()) {
+                commandBuffers.push_back(createFrameCommandBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+                reused = false;
+            }
+            frameCommandBuffer = commandBuffers[frameSecondaryCommandBuffersCount];
+            frameSecondaryCommandBuffersCount += 1;
+        }
+        if (reused) {
+            // the fence of the frame have been waited for, the previous recording is no longer in use
+            vkResetCommandPool(device, frameCommandBuffer.commandPool, 0);
+        }
+        const VkCommandBufferInheritanceInfo inheritanceInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .pNext = &renderingInfo,
+        };
+        const VkCommandBufferBeginInfo beginInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+            .pInheritanceInfo = &inheritanceInfo,
+        };
+        if (vkBeginCommandBuffer(frameCommandBuffer.commandBuffer, &beginInfo) != VK_SUCCESS) {
+            die("failed to begin recording command buffer!");
+        }
+        return frameCommandBuffer.commandBuffer;
+    }
+
     // https://github.com/KhronosGroup/Vulkan-Samples/blob/main/samples/extensions/shader_object/shader_object.cpp
     void VulkanDevice::setInitialState(VkCommandBuffer commandBuffer)
     {
@@ -329,10 +452,28 @@ namespace z0 {
         // https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Logical_device_and_queues#page_Specifying-used-device-features
         // https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Logical_device_and_queues#page_Creating-the-logical-device
         {
+            // Bindless textures table
+            // https://docs.vulkan.org/samples/latest/samples/extensions/descriptor_indexing/README.html
+            VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+                .pNext = VK_NULL_HANDLE,
+                .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+                .descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+                .descriptorBindingPartiallyBound = VK_TRUE,
+                .descriptorBindingVariableDescriptorCount = VK_TRUE,
+                .runtimeDescriptorArray = VK_TRUE,
+            };
+            // Render graph barriers
+            // https://docs.vulkan.org/samples/latest/samples/extensions/synchronization2/README.html
+            VkPhysicalDeviceSynchronization2Features synchronization2Features{
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+                .pNext = &descriptorIndexingFeatures,
+                .synchronization2 = VK_TRUE,
+            };
             // https://docs.vulkan.org/samples/latest/samples/extensions/shader_object/README.html
             VkPhysicalDeviceShaderObjectFeaturesEXT deviceShaderObjectFeatures{
                 .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
-                .pNext = VK_NULL_HANDLE,
+                .pNext = &synchronization2Features,
                 .shaderObject  = VK_TRUE,
             };
             // https://lesleylai.info/en/vk-khr-dynamic-rendering/
@@ -341,9 +482,28 @@ namespace z0 {
                 .pNext = &deviceShaderObjectFeatures,
                 .dynamicRendering = VK_TRUE,
             };
-            const VkPhysicalDeviceFeatures deviceFeatures{
-                .samplerAnisotropy = VK_TRUE
+            // Optional features are enabled only when supported
+            deviceFeatures = VkPhysicalDeviceFeatures{
+                .multiDrawIndirect = deviceFeatures.multiDrawIndirect,
+                .samplerAnisotropy = VK_TRUE,
+                .shaderSampledImageArrayDynamicIndexing = deviceFeatures.shaderSampledImageArrayDynamicIndexing,
+                .shaderStorageImageArrayDynamicIndexing = deviceFeatures.shaderStorageImageArrayDynamicIndexing,
             };
+            // Heaps budget for the stats and GPU draw counts, optional
+            auto enabledExtensions = deviceExtensions;
+            uint32_t extensionCount;
+            vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+            std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+            vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+            for (const auto& extension : availableExtensions) {
+                if (std::string{extension.extensionName} == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) {
+                    enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+                    memoryBudgetSupported = true;
+                } else if (std::string{extension.extensionName} == VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) {
+                    enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+                    drawIndirectCountSupported = true;
+                }
+            }
             VkDeviceCreateInfo createInfo{
                 .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
                 .pNext = &dynamicRenderingFeature,
@@ -351,8 +511,8 @@ namespace z0 {
                 .pQueueCreateInfos = queueCreateInfos.data(),
                 .enabledLayerCount = static_cast<uint32_t>(requestedLayers.size()),
                 .ppEnabledLayerNames = requestedLayers.data(),
-                .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
-                .ppEnabledExtensionNames = deviceExtensions.data(),
+                .enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()),
+                .ppEnabledExtensionNames = enabledExtensions.data(),
                 .pEnabledFeatures = &deviceFeatures,
             };
             if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
@@ -361,17 +521,17 @@ namespace z0 {
         }
 
         // https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Logical_device_and_queues#page_Retrieving-queue-handles
-        vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
+        graphicsQueueFamily = indices.graphicsFamily.value();
+        vkGetDeviceQueue(device, graphicsQueueFamily, 0, &graphicsQueue);
         // https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Window_surface#page_Creating-the-presentation-queue
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
 
         // Create the device command pool
         // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Command_buffers#page_Command-pools
-        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice, surface);
         const VkCommandPoolCreateInfo poolInfo = {
             .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
             .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-            .queueFamilyIndex = queueFamilyIndices.graphicsFamily.value(),
+            .queueFamilyIndex = graphicsQueueFamily,
         };
         if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
             die("Failed to create the command pool");
@@ -409,6 +569,7 @@ namespace z0 {
                 .vkGetDeviceImageMemoryRequirements = vkGetDeviceImageMemoryRequirements,
         };
         const VmaAllocatorCreateInfo allocatorInfo = {
+                .flags = memoryBudgetSupported ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0u,
                 .physicalDevice = physicalDevice,
                 .device = device,
                 .pVulkanFunctions = &vulkanFunctions,
@@ -416,6 +577,14 @@ namespace z0 {
                 .vulkanApiVersion = deviceProperties.apiVersion,
         };
         vmaCreateAllocator(&allocatorInfo, &allocator);
+
+        const VkPhysicalDeviceMemoryProperties* memoryProperties;
+        vmaGetMemoryProperties(allocator, &memoryProperties);
+        for (uint32_t i = 0; i < memoryProperties->memoryTypeCount; i++) {
+            if (memoryProperties->memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+                lazilyAllocatedSupported = true;
+            }
+        }
     }
 
     // https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Swap_chain
@@ -562,19 +731,6 @@ namespace z0 {
         }
     }
 
-    uint32_t VulkanDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            if ((typeFilter & (1 << i)) &&
-                (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
-        die("failed to find suitable memory type!");
-        return 0;
-    }
-
     // https://vulkan-tutorial.com/Texture_mapping/Images#page_Layout-transitions
     VkCommandBuffer VulkanDevice::beginSingleTimeCommands() {
         const VkCommandBufferAllocateInfo allocInfo{
@@ -602,11 +758,38 @@ namespace z0 {
             .commandBufferCount = 1,
             .pCommandBuffers = &commandBuffer
         };
+        std::lock_guard<std::mutex> lock(queueMutex);
         vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
         vkQueueWaitIdle(graphicsQueue);
         vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 
+    VkFence VulkanDevice::submitSingleTimeCommands(VkCommandBuffer commandBuffer) {
+        vkEndCommandBuffer(commandBuffer);
+        const VkFenceCreateInfo fenceInfo{
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        };
+        VkFence fence;
+        if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            die("failed to create fence!");
+        }
+        const VkSubmitInfo submitInfo{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer
+        };
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence) != VK_SUCCESS) {
+            die("failed to submit the commands!");
+        }
+        return fence;
+    }
+
+    void VulkanDevice::releaseSingleTimeCommands(VkCommandBuffer commandBuffer, VkFence fence) {
+        vkDestroyFence(device, fence, nullptr);
+        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    }
+
     // https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Physical_devices_and_queue_families#page_Queue-families
     QueueFamilyIndices  VulkanDevice::findQueueFamilies(VkPhysicalDevice vkPhysicalDevice, VkSurfaceKHR surface) {
         QueueFamilyIndices indices;
@@ -682,6 +865,22 @@ namespace z0 {
         if (!deviceFeatures.geometryShader) {
             return 0;
         }
+        // nor without the bindless textures table
+        VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+        };
+        VkPhysicalDeviceFeatures2 deviceFeatures2{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &descriptorIndexingFeatures,
+        };
+        vkGetPhysicalDeviceFeatures2(vkPhysicalDevice, &deviceFeatures2);
+        if (!descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind ||
+            !descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending ||
+            !descriptorIndexingFeatures.descriptorBindingPartiallyBound ||
+            !descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount ||
+            !descriptorIndexingFeatures.runtimeDescriptorArray) {
+            return 0;
+        }
         bool extensionsSupported = checkDeviceExtensionSupport(vkPhysicalDevice);
         bool swapChainAdequate = false;
         if (extensionsSupported) {
@@ -727,7 +926,8 @@ namespace z0 {
 
     // https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Image_views
     VkImageView VulkanDevice::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
-                                              uint32_t mipLevels, VkImageViewType type) {
+                                              uint32_t mipLevels, VkImageViewType type,
+                                              uint32_t baseArrayLayer, uint32_t layers) {
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = image;
@@ -736,8 +936,8 @@ namespace z0 {
         viewInfo.subresourceRange.aspectMask = aspectFlags;
         viewInfo.subresourceRange.baseMipLevel = 0;
         viewInfo.subresourceRange.levelCount = mipLevels;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = type == VK_IMAGE_VIEW_TYPE_CUBE ? VK_REMAINING_ARRAY_LAYERS : 1;
+        viewInfo.subresourceRange.baseArrayLayer = baseArrayLayer;
+        viewInfo.subresourceRange.layerCount = type == VK_IMAGE_VIEW_TYPE_CUBE ? VK_REMAINING_ARRAY_LAYERS : layers;
 
         VkImageView imageView;
         if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
@@ -747,10 +947,11 @@ namespace z0 {
     }
 
     // https://vulkan-tutorial.com/Texture_mapping/Images#page_Texture-Image
+    // https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/usage_patterns.html
     void VulkanDevice::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples,
                                    VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                                   VkMemoryPropertyFlags properties, VkImage &image,
-                                   VkDeviceMemory &imageMemory, VkImageCreateFlags flags, uint32_t layers) {
+                                   MemoryCategory category, VkImage &image,
+                                   VmaAllocation &allocation, VkImageCreateFlags flags, uint32_t layers) {
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -767,23 +968,134 @@ namespace z0 {
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.flags = flags;
 
-        if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create image!");
+        // Attachments never loaded nor stored only live in the tile memory of the tile based GPUs
+        const auto lazy = lazilyAllocatedSupported && (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+        // Large render targets are recreated with the swap chain : a dedicated block avoids fragmenting the shared ones
+        VmaAllocationCreateFlags allocationFlags = 0;
+        if (!lazy && (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))) {
+            if (getImageMemoryRequirements(imageInfo).size >= DEDICATED_ALLOCATION_MIN_SIZE) {
+                allocationFlags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+            }
+        }
+        const VmaAllocationCreateInfo allocInfo{
+            .flags = allocationFlags,
+            .usage = lazy ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            .pUserData = reinterpret_cast<void*>(static_cast<uintptr_t>(category)),
+        };
+        VmaAllocationInfo allocationInfo;
+        if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &image, &allocation, &allocationInfo) != VK_SUCCESS) {
+            die("failed to create image!");
         }
+#ifdef VULKAN_STATS
+        // the lazily allocated memory is not committed in the video memory
+        if (!lazy) VulkanStats::get().memoryUsage[category] += allocationInfo.size;
+#endif
+    }
 
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device, image, &memRequirements);
+    void VulkanDevice::destroyImage(VkImage image, VmaAllocation allocation) {
+#ifdef VULKAN_STATS
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(allocator, allocation, &allocationInfo);
+        VkMemoryPropertyFlags memoryFlags;
+        vmaGetAllocationMemoryProperties(allocator, allocation, &memoryFlags);
+        if (!(memoryFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+            VulkanStats::get().memoryUsage[reinterpret_cast<uintptr_t>(allocationInfo.pUserData)] -= allocationInfo.size;
+        }
+#endif
+        renderGraph.removeImage(image);
+        vmaDestroyImage(allocator, image, allocation);
+    }
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    VkMemoryRequirements VulkanDevice::getImageMemoryRequirements(const VkImageCreateInfo& imageInfo) const {
+        const VkDeviceImageMemoryRequirements requirementsInfo{
+            .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+            .pCreateInfo = &imageInfo,
+        };
+        VkMemoryRequirements2 requirements{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+        };
+        vkGetDeviceImageMemoryRequirements(device, &requirementsInfo, &requirements);
+        return requirements.memoryRequirements;
+    }
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            die("failed to allocate image memory!");
+    // https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/resource_aliasing.html
+    bool VulkanDevice::createAliasedImage(uint32_t slot, uint32_t width, uint32_t height, VkSampleCountFlagBits samples,
+                                          VkFormat format, VkImageUsageFlags usage, VkImage& image) {
+        VkImageCreateInfo imageInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = format,
+            .extent = {width, height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = samples,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+        const auto requirements = getImageMemoryRequirements(imageInfo);
+        auto& aliasingSlot = aliasingSlots[slot];
+        if ((aliasingSlot.allocation == VK_NULL_HANDLE) ||
+            (aliasingSlot.extent.width != swapChainExtent.width) ||
+            (aliasingSlot.extent.height != swapChainExtent.height)) {
+            // the images bound to the previous memory are recreated with the swap chain
+            releaseAliasingSlot(aliasingSlot);
+            auto slotInfo = imageInfo;
+            slotInfo.extent = {swapChainExtent.width, swapChainExtent.height, 1};
+            slotInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            slotInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+            slotInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                             VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            auto slotRequirements = getImageMemoryRequirements(slotInfo);
+            // a larger first image, like a multisampled attachment, is shared with the following resolved ones
+            if ((slotRequirements.memoryTypeBits & requirements.memoryTypeBits) != 0) {
+                slotRequirements.size = std::max(slotRequirements.size, requirements.size);
+                slotRequirements.alignment = std::max(slotRequirements.alignment, requirements.alignment);
+                slotRequirements.memoryTypeBits &= requirements.memoryTypeBits;
+            }
+            const VmaAllocationCreateInfo allocInfo{
+                .flags = slotRequirements.size >= DEDICATED_ALLOCATION_MIN_SIZE ? VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT : 0u,
+                .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                .pUserData = reinterpret_cast<void*>(static_cast<uintptr_t>(MEMORY_ATTACHMENTS)),
+            };
+            VmaAllocationInfo allocationInfo;
+            if (vmaAllocateMemory(allocator, &slotRequirements, &allocInfo, &aliasingSlot.allocation, &allocationInfo) != VK_SUCCESS) {
+                die("failed to allocate aliased attachments memory!");
+            }
+            aliasingSlot.extent = swapChainExtent;
+#ifdef VULKAN_STATS
+            VulkanStats::get().memoryUsage[MEMORY_ATTACHMENTS] += allocationInfo.size;
+#endif
         }
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(allocator, aliasingSlot.allocation, &allocationInfo);
+        if ((requirements.size > allocationInfo.size) ||
+            ((requirements.memoryTypeBits & (1u << allocationInfo.memoryType)) == 0) ||
+            ((allocationInfo.offset % requirements.alignment) != 0)) {
+            return false;
+        }
+        if (vmaCreateAliasingImage(allocator, aliasingSlot.allocation, &imageInfo, &image) != VK_SUCCESS) {
+            die("failed to create aliased image!");
+        }
+        renderGraph.setAliasingSlot(image, slot);
+        return true;
+    }
 
-        vkBindImageMemory(device, image, imageMemory, 0);
+    void VulkanDevice::destroyAliasedImage(VkImage image) {
+        renderGraph.removeImage(image);
+        vkDestroyImage(device, image, nullptr);
+    }
+
+    void VulkanDevice::releaseAliasingSlot(AliasingSlot& slot) {
+        if (slot.allocation == VK_NULL_HANDLE) return;
+#ifdef VULKAN_STATS
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(allocator, slot.allocation, &allocationInfo);
+        VulkanStats::get().memoryUsage[MEMORY_ATTACHMENTS] -= allocationInfo.size;
+#endif
+        vmaFreeMemory(allocator, slot.allocation);
+        slot.allocation = VK_NULL_HANDLE;
     }
 
     VkBool32 VulkanDevice::formatIsFilterable(VkFormat format, VkImageTiling tiling) {
@@ -9,6 +9,7 @@
 #include <stb_image.h>
 //#include <stb_image_write.h>
 
+#include <algorithm>
 #include <cmath>
 
 namespace z0 {
@@ -21,19 +22,41 @@ namespace z0 {
                              VkFormat format):
             width{w}, height{h}, vulkanDevice{device}
     {
-        const VulkanBuffer textureStagingBuffer{
+        VkCommandBuffer commandBuffer = vulkanDevice.beginSingleTimeCommands();
+        recordUpload(commandBuffer, imageSize, data, format);
+        vulkanDevice.endSingleTimeCommands(commandBuffer);
+        releaseStagingBuffer();
+    }
+
+    VulkanImage::VulkanImage(VulkanDevice& device,
+                             VkCommandBuffer commandBuffer,
+                             uint32_t w,
+                             uint32_t h,
+                             VkDeviceSize imageSize,
+                             void* data,
+                             VkFormat format):
+            width{w}, height{h}, vulkanDevice{device}
+    {
+        recordUpload(commandBuffer, imageSize, data, format);
+    }
+
+    void VulkanImage::releaseStagingBuffer() {
+        stagingBuffer.reset();
+    }
+
+    void VulkanImage::recordUpload(VkCommandBuffer commandBuffer, VkDeviceSize imageSize, void* data, VkFormat format) {
+        stagingBuffer = std::make_unique<VulkanBuffer>(
                 vulkanDevice,
                 imageSize,
                 1,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        };
-        textureStagingBuffer.writeToBuffer(data);
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+        stagingBuffer->writeToBuffer(data);
 
         mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
         vulkanDevice.createImage(width, height, mipLevels, VK_SAMPLE_COUNT_1_BIT, format,
                                  VK_IMAGE_TILING_OPTIMAL,
                                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+                                 MEMORY_TEXTURES, textureImage, textureImageAllocation);
 
         // https://vulkan-tutorial.com/Texture_mapping/Images#page_Copying-buffer-to-image
         VkBufferImageCopy region{};
@@ -50,7 +73,6 @@ namespace z0 {
                 height,
                 1
         };
-        VkCommandBuffer commandBuffer = vulkanDevice.beginSingleTimeCommands();
         vulkanDevice.transitionImageLayout(commandBuffer,
                 textureImage,
                 VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -59,24 +81,90 @@ namespace z0 {
                 VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
         vkCmdCopyBufferToImage(
                 commandBuffer,
-                textureStagingBuffer.getBuffer(),
+                stagingBuffer->getBuffer(),
                 textureImage,
                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                 1,
                 &region
         );
-        vulkanDevice.endSingleTimeCommands(commandBuffer);
         //transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
         textureImageView = vulkanDevice.createImageView(textureImage, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
 
-        generateMipmaps(format);
+        generateMipmaps(commandBuffer, format);
         createTextureSampler();
 #ifdef VULKAN_STATS
         VulkanStats::get().imagesCount += 1;
 #endif
     }
 
-    std::shared_ptr<VulkanImage> VulkanImage::createFromFile(VulkanDevice &device, const std::string &filepath) {
+    uint32_t VulkanImageSource::getMipLevels() const {
+        return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    }
+
+    std::vector<unsigned char> VulkanImageSource::getLevel(uint32_t level, uint32_t& levelWidth, uint32_t& levelHeight) const {
+        levelWidth = width;
+        levelHeight = height;
+        std::vector<unsigned char> levelPixels{pixels};
+        for (uint32_t i = 0; i < level; i++) {
+            const auto w = std::max(levelWidth / 2, 1u);
+            const auto h = std::max(levelHeight / 2, 1u);
+            std::vector<unsigned char> halved(w * h * 4);
+            // 2x2 box filter, the last row & column of odd sizes are clamped
+            for (uint32_t y = 0; y < h; y++) {
+                const auto y0 = std::min(y * 2, levelHeight - 1);
+                const auto y1 = std::min(y * 2 + 1, levelHeight - 1);
+                for (uint32_t x = 0; x < w; x++) {
+                    const auto x0 = std::min(x * 2, levelWidth - 1);
+                    const auto x1 = std::min(x * 2 + 1, levelWidth - 1);
+                    for (uint32_t c = 0; c < 4; c++) {
+                        const auto sum = levelPixels[(y0 * levelWidth + x0) * 4 + c] +
+                                         levelPixels[(y0 * levelWidth + x1) * 4 + c] +
+                                         levelPixels[(y1 * levelWidth + x0) * 4 + c] +
+                                         levelPixels[(y1 * levelWidth + x1) * 4 + c];
+                        halved[(y * w + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+            levelPixels = std::move(halved);
+            levelWidth = w;
+            levelHeight = h;
+        }
+        return levelPixels;
+    }
+
+    VkDeviceSize VulkanImageSource::getMipChainSize(uint32_t level) const {
+        VkDeviceSize size = 0;
+        for (auto i = level; i < getMipLevels(); i++) {
+            size += static_cast<VkDeviceSize>(std::max(width >> i, 1u)) * std::max(height >> i, 1u) * 4;
+        }
+        return size;
+    }
+
+    std::shared_ptr<VulkanImage> VulkanImage::createStreamed(VulkanDevice& device,
+                                                             uint32_t width,
+                                                             uint32_t height,
+                                                             const void* data,
+                                                             VkFormat format) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        auto source = std::make_shared<VulkanImageSource>(VulkanImageSource{
+            .width = width,
+            .height = height,
+            .format = format,
+            .pixels = std::vector<unsigned char>(bytes, bytes + static_cast<size_t>(width) * height * 4),
+        });
+        uint32_t tailLevel = 0;
+        while (std::max(width >> tailLevel, height >> tailLevel) > STREAMING_TAIL_SIZE) {
+            tailLevel += 1;
+        }
+        uint32_t tailWidth, tailHeight;
+        auto tailPixels = source->getLevel(tailLevel, tailWidth, tailHeight);
+        auto image = std::make_shared<VulkanImage>(device, tailWidth, tailHeight, tailPixels.size(), tailPixels.data(), format);
+        image->source = std::move(source);
+        image->baseLevel = tailLevel;
+        return image;
+    }
+
+    std::shared_ptr<VulkanImage> VulkanImage::createFromFile(VulkanDevice &device, const std::string &filepath, bool streamed) {
         // Create texture image
         // https://vulkan-tutorial.com/Texture_mapping/Images#page_Loading-an-image
         int texWidth, texHeight, texChannels;
@@ -85,7 +173,9 @@ namespace z0 {
         if (!pixels) {
             die("failed to load texture image!");
         }
-        auto image =  std::make_shared<VulkanImage>(device, texWidth, texHeight, imageSize, pixels);
+        auto image = streamed ?
+                createStreamed(device, texWidth, texHeight, pixels) :
+                std::make_shared<VulkanImage>(device, texWidth, texHeight, imageSize, pixels);
         stbi_image_free(pixels);
         return image;
     }
@@ -148,8 +238,7 @@ namespace z0 {
     VulkanImage::~VulkanImage() {
         vkDestroySampler(vulkanDevice.getDevice(), textureSampler, nullptr);
         vkDestroyImageView(vulkanDevice.getDevice(), textureImageView, nullptr);
-        vkDestroyImage(vulkanDevice.getDevice(), textureImage, nullptr);
-        vkFreeMemory(vulkanDevice.getDevice(), textureImageMemory, nullptr);
+        vulkanDevice.destroyImage(textureImage, textureImageAllocation);
     }
 
     // https://vulkan-tutorial.com/Texture_mapping/Combined_image_sampler#page_Updating-the-descriptors
@@ -162,7 +251,7 @@ namespace z0 {
     }
 
     // https://vulkan-tutorial.com/en/Generating_Mipmaps
-    void VulkanImage::generateMipmaps(VkFormat imageFormat) {
+    void VulkanImage::generateMipmaps(VkCommandBuffer commandBuffer, VkFormat imageFormat) {
         // Check if image format supports linear blitting
         VkFormatProperties formatProperties;
         vkGetPhysicalDeviceFormatProperties(vulkanDevice.getPhysicalDevice(), imageFormat, &formatProperties);
@@ -170,7 +259,6 @@ namespace z0 {
             die("texture image format does not support linear blitting!"); // See todo.txt
         }
 
-        VkCommandBuffer commandBuffer = vulkanDevice.beginSingleTimeCommands();
 
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -239,8 +327,6 @@ namespace z0 {
                              0, nullptr,
                              0, nullptr,
                              1, &barrier);
-
-        vulkanDevice.endSingleTimeCommands(commandBuffer);
     }
 
     // https://vulkan-tutorial.com/Texture_mapping/Image_view_and_sampler#page_Samplers
@@ -5,40 +5,21 @@
  * https://vulkan-tutorial.com/Loading_models
 */
 #include "z0/vulkan/vulkan_model.hpp"
+#include "z0/vulkan/vulkan_stats.hpp"
 #include "z0/log.hpp"
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
+#include <algorithm>
 #include <cassert>
-#include <unordered_map>
-
-namespace  z0 {
-    // from: https://stackoverflow.com/a/57595105
-    template<typename T, typename... Rest>
-    void hashCombine(std::size_t &seed, const T &v, const Rest &... rest) {
-        seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        (hashCombine(seed, rest), ...);
-    };
-}
-
-namespace std {
-    template<>
-    struct hash<z0::Vertex>{
-        size_t operator()(z0::Vertex const &vertex) const {
-            size_t seed = 0;
-            z0::hashCombine(seed, vertex.position, vertex.normal, vertex.uv);
-            return seed;
-        }
-    };
-}
 
 namespace  z0 {
 
-    VulkanModel::VulkanModel(VulkanDevice &dev, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices):
+    VulkanModel::VulkanModel(VulkanDevice &dev,
+                             const std::vector<Vertex> &vertices,
+                             const std::vector<uint32_t> &indices,
+                             const std::vector<uint32_t> &cutIndices):
         device{dev}  {
         createVertexBuffers(vertices);
-        createIndexBuffers(indices);
+        createIndexBuffers(indices, cutIndices);
     }
 
     void VulkanModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
@@ -66,20 +47,79 @@ namespace  z0 {
         stagingBuffer.copyTo(*vertexBuffer, bufferSize);
     }
 
-    void VulkanModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
+    void VulkanModel::createIndexBuffers(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &cutIndices) {
         indexCount = static_cast<uint32_t>(indices.size());
         if (indexCount <= 0) {
             die("Unindexed meshes aren't supported");
         }
-        VkDeviceSize bufferSize = sizeof (indices[0]) * indexCount;
-        uint32_t  indexSize = sizeof(indices[0]);
+        // Use 16-bit indices when all the vertices are addressable, or when the index buffer
+        // can be split in chunks of 65536 vertices with a per-chunk base vertex
+        if ((vertexCount <= MAX_16BIT_VERTICES) || splitIndexChunks(indices, cutIndices)) {
+            if (indexChunks.empty()) {
+                indexChunks.push_back({0, indexCount, 0});
+            }
+            std::vector<uint16_t> indices16(indexCount);
+            for (const auto& chunk : indexChunks) {
+                for (uint32_t i = chunk.firstIndex; i < (chunk.firstIndex + chunk.indexCount); i++) {
+                    indices16[i] = static_cast<uint16_t>(indices[i] - chunk.vertexOffset);
+                }
+            }
+            indexType = VK_INDEX_TYPE_UINT16;
+            uploadIndexBuffer(indices16.data(), sizeof(uint16_t));
+        } else {
+            indexChunks = {{0, indexCount, 0}};
+            indexType = VK_INDEX_TYPE_UINT32;
+            uploadIndexBuffer(indices.data(), sizeof(uint32_t));
+        }
+    }
+
+    // Greedily cut the index buffer, on triangle boundaries (or on the given cut indices), each time the range
+    // of addressed vertices does not fit in 16 bits anymore. Fails if a single triangle, or a range between
+    // two cut indices, can't be addressed with 16-bit indices.
+    bool VulkanModel::splitIndexChunks(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &cutIndices) {
+        indexChunks.clear();
+        uint32_t firstIndex = 0;
+        uint32_t minVertex = UINT32_MAX;
+        uint32_t maxVertex = 0;
+        auto nextCut = cutIndices.begin();
+        uint32_t i = 0;
+        while (i + 2 < indexCount) {
+            // group of triangles that can't be split
+            uint32_t end = i + 3;
+            if (!cutIndices.empty()) {
+                while ((nextCut != cutIndices.end()) && (*nextCut <= i)) { nextCut++; }
+                end = nextCut == cutIndices.end() ? indexCount : *nextCut;
+            }
+            const auto groupMin = *std::min_element(indices.begin() + i, indices.begin() + end);
+            const auto groupMax = *std::max_element(indices.begin() + i, indices.begin() + end);
+            if ((groupMax - groupMin) >= MAX_16BIT_VERTICES) {
+                indexChunks.clear();
+                return false;
+            }
+            if ((std::max(maxVertex, groupMax) - std::min(minVertex, groupMin)) >= MAX_16BIT_VERTICES) {
+                indexChunks.push_back({firstIndex, i - firstIndex, static_cast<int32_t>(minVertex)});
+                firstIndex = i;
+                minVertex = groupMin;
+                maxVertex = groupMax;
+            } else {
+                minVertex = std::min(minVertex, groupMin);
+                maxVertex = std::max(maxVertex, groupMax);
+            }
+            i = end;
+        }
+        indexChunks.push_back({firstIndex, indexCount - firstIndex, static_cast<int32_t>(minVertex)});
+        return true;
+    }
+
+    void VulkanModel::uploadIndexBuffer(const void* indices, uint32_t indexSize) {
+        VkDeviceSize bufferSize = indexSize * indexCount;
         const VulkanBuffer stagingBuffer {
                 device,
             indexSize,
             indexCount,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         };
-        stagingBuffer.writeToBuffer((void*)indices.data());
+        stagingBuffer.writeToBuffer((void*)indices);
 
         indexBuffer = std::make_unique<VulkanBuffer>(
                 device,
@@ -93,14 +133,42 @@ namespace  z0 {
 
     void VulkanModel::draw(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t count) {
         bind(commandBuffer);
-        vkCmdDrawIndexed(commandBuffer, count, 1, firstIndex, 0, 0);
+        // one draw for each chunk overlapping the range
+        const auto lastIndex = firstIndex + count;
+        for (const auto& chunk : indexChunks) {
+            const auto first = std::max(firstIndex, chunk.firstIndex);
+            const auto last = std::min(lastIndex, chunk.firstIndex + chunk.indexCount);
+            if (first < last) {
+                vkCmdDrawIndexed(commandBuffer, last - first, 1, first, chunk.vertexOffset, 0);
+#ifdef VULKAN_STATS
+                VulkanStats::get().trianglesCount += (last - first) / 3;
+#endif
+            }
+        }
+    }
+
+    // Without the multiDrawIndirect feature the draw count must be 0 or 1
+    void VulkanModel::drawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                        VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCount) {
+        bind(commandBuffer);
+        vkCmdDrawIndexedIndirectCountKHR(commandBuffer, buffer, offset, countBuffer, countOffset, maxDrawCount,
+                                         sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    int32_t VulkanModel::getVertexOffset(uint32_t firstIndex) const {
+        for (const auto& chunk : indexChunks) {
+            if (firstIndex < (chunk.firstIndex + chunk.indexCount)) {
+                return chunk.vertexOffset;
+            }
+        }
+        return 0;
     }
 
     void VulkanModel::bind(VkCommandBuffer commandBuffer) {
         VkBuffer buffers[] = { vertexBuffer->getBuffer() };
         VkDeviceSize offsets[] = { 0 };
         vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
     }
 
     std::vector<VkVertexInputBindingDescription2EXT> VulkanModel::getBindingDescription() {
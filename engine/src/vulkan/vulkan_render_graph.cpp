@@ -0,0 +1,392 @@
+#include "z0/vulkan/vulkan_render_graph.hpp"
+#include "z0/vulkan/vulkan_stats.hpp"
+#include "z0/log.hpp"
+
+#include <algorithm>
+#include <set>
+
+namespace z0 {
+
+    RenderGraphPass& RenderGraphPass::readImage(VkImage image, VkImageLayout layout,
+                                                VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                                                VkImageAspectFlags aspect, bool history) {
+        return add({
+            .resource = toResource(image),
+            .layout = layout,
+            .stages = stages,
+            .access = access,
+            .aspect = aspect,
+            .write = false,
+            .discard = false,
+            .history = history,
+            .phase = phase,
+        });
+    }
+
+    RenderGraphPass& RenderGraphPass::writeImage(VkImage image, VkImageLayout layout,
+                                                 VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                                                 VkImageAspectFlags aspect, bool discard) {
+        return add({
+            .resource = toResource(image),
+            .layout = layout,
+            .stages = stages,
+            .access = access,
+            .aspect = aspect,
+            .write = true,
+            .discard = discard,
+            .history = false,
+            .phase = phase,
+        });
+    }
+
+    RenderGraphPass& RenderGraphPass::readBuffer(VkBuffer buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access) {
+        return add({
+            .resource = toResource(buffer),
+            .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .stages = stages,
+            .access = access,
+            .aspect = VK_IMAGE_ASPECT_NONE,
+            .write = false,
+            .discard = false,
+            .history = false,
+            .phase = phase,
+        });
+    }
+
+    RenderGraphPass& RenderGraphPass::writeBuffer(VkBuffer buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access) {
+        return add({
+            .resource = toResource(buffer),
+            .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .stages = stages,
+            .access = access,
+            .aspect = VK_IMAGE_ASPECT_NONE,
+            .write = true,
+            .discard = false,
+            .history = false,
+            .phase = phase,
+        });
+    }
+
+    RenderGraphPass& RenderGraphPass::setSideEffects() {
+        sideEffects = true;
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::nextPhase() {
+        phase += 1;
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::add(const Access& access) {
+        accesses.push_back(access);
+        return *this;
+    }
+
+    RenderGraphPass::Resource RenderGraphPass::toResource(VkImage image) {
+        return { reinterpret_cast<uint64_t>(image), true };
+    }
+
+    RenderGraphPass::Resource RenderGraphPass::toResource(VkBuffer buffer) {
+        return { reinterpret_cast<uint64_t>(buffer), false };
+    }
+
+    RenderGraphPass& VulkanRenderGraph::addPass(VulkanRenderer& renderer) {
+        passes.push_back(std::make_unique<RenderGraphPass>(renderer));
+        return *passes.back();
+    }
+
+    void VulkanRenderGraph::compile() {
+        const auto count = static_cast<uint32_t>(passes.size());
+        // Writers & readers of each resource, in the declaration order.
+        // The writes preserving the content read the previous writes
+        struct Usage {
+            std::vector<uint32_t> writers;
+            std::vector<uint32_t> readers;
+            std::vector<uint32_t> historyReaders;
+        };
+        std::map<Resource, Usage> usages;
+        for (uint32_t index = 0; index < count; index++) {
+            for (const auto& access : passes[index]->accesses) {
+                auto& usage = usages[access.resource];
+                if (access.write) usage.writers.push_back(index);
+                if (access.history) {
+                    usage.historyReaders.push_back(index);
+                } else if (!access.discard) {
+                    usage.readers.push_back(index);
+                }
+            }
+        }
+
+        // Dependencies : the writers before the readers, the history readers before the writers
+        std::vector<std::vector<uint32_t>> successors(count);
+        std::vector<uint32_t> predecessorsCount(count, 0);
+        const auto addDependency = [&](uint32_t from, uint32_t to) {
+            successors[from].push_back(to);
+            predecessorsCount[to] += 1;
+        };
+        const auto contains = [](const std::vector<uint32_t>& passesIndices, uint32_t index) {
+            return std::ranges::find(passesIndices, index) != passesIndices.end();
+        };
+        for (const auto& [resource, usage] : usages) {
+            for (const auto writer : usage.writers) {
+                for (const auto reader : usage.readers) {
+                    if (writer == reader) continue;
+                    // two passes updating the same resource keep the declaration order
+                    if ((writer > reader) && contains(usage.readers, writer) && contains(usage.writers, reader)) continue;
+                    addDependency(writer, reader);
+                }
+                for (const auto reader : usage.historyReaders) {
+                    if (writer != reader) addDependency(reader, writer);
+                }
+            }
+        }
+
+        // Kahn's topological sort, the first declared pass first between the ready passes
+        std::set<uint32_t> ready;
+        for (uint32_t index = 0; index < count; index++) {
+            if (predecessorsCount[index] == 0) ready.insert(index);
+        }
+        std::vector<uint32_t> order;
+        while (!ready.empty()) {
+            const auto index = *ready.begin();
+            ready.erase(ready.begin());
+            order.push_back(index);
+            for (const auto successor : successors[index]) {
+                predecessorsCount[successor] -= 1;
+                if (predecessorsCount[successor] == 0) ready.insert(successor);
+            }
+        }
+        if (order.size() != count) {
+            die("Render graph : cycle between the passes dependencies");
+        }
+
+        // Passes culling : only the passes writing the frame image or a resource read by a needed pass are kept
+        std::vector<bool> needed(count, false);
+        std::set<Resource> neededResources{ RenderGraphPass::toResource(output) };
+        auto changed = true;
+        while (changed) {
+            changed = false;
+            for (uint32_t index = 0; index < count; index++) {
+                if (needed[index]) continue;
+                const auto& pass = *passes[index];
+                needed[index] = pass.sideEffects || std::ranges::any_of(pass.accesses, [&](const RenderGraphPass::Access& access) {
+                    return access.write && neededResources.contains(access.resource);
+                });
+                if (!needed[index]) continue;
+                for (const auto& access : pass.accesses) {
+                    if (!access.discard) neededResources.insert(access.resource);
+                }
+                changed = true;
+            }
+        }
+
+        executionOrder.clear();
+        for (const auto index : order) {
+            if (needed[index]) executionOrder.push_back(passes[index].get());
+        }
+        checkAliasingLifetimes();
+    }
+
+    void VulkanRenderGraph::checkAliasingLifetimes() const {
+        // First & last pass using each aliased image
+        struct Lifetime {
+            uint32_t slot;
+            uint32_t first;
+            uint32_t last;
+        };
+        std::map<Resource, Lifetime> lifetimes;
+        for (uint32_t position = 0; position < executionOrder.size(); position++) {
+            for (const auto& access : executionOrder[position]->accesses) {
+                const auto slot = aliasingSlots.find(access.resource);
+                if (slot == aliasingSlots.end()) continue;
+                auto [lifetime, inserted] = lifetimes.try_emplace(access.resource, Lifetime{slot->second, position, position});
+                lifetime->second.last = position;
+            }
+        }
+        // the frame image is used until the copy to the swap chain
+        const auto outputLifetime = lifetimes.find(RenderGraphPass::toResource(output));
+        if (outputLifetime != lifetimes.end()) {
+            outputLifetime->second.last = static_cast<uint32_t>(executionOrder.size());
+        }
+        for (auto a = lifetimes.begin(); a != lifetimes.end(); ++a) {
+            for (auto b = std::next(a); b != lifetimes.end(); ++b) {
+                if ((a->second.slot == b->second.slot) &&
+                    (a->second.first <= b->second.last) && (b->second.first <= a->second.last)) {
+                    die("Render graph : aliased images used at the same time");
+                }
+            }
+        }
+    }
+
+    void VulkanRenderGraph::beginPass(VkCommandBuffer commandBuffer, RenderGraphPass& pass) {
+        // the accesses are declared in the phases order
+        pass.phasesBarriers.clear();
+        uint32_t phase = 0;
+        const auto endPhase = [&] {
+            if (phase == 0) {
+                recordBarriers(commandBuffer, barriers);
+            } else {
+                pass.phasesBarriers.push_back(std::move(barriers));
+            }
+            barriers = {};
+            phase += 1;
+        };
+        for (const auto& access : pass.accesses) {
+            while (phase < access.phase) endPhase();
+            addBarrier(access);
+        }
+        while (phase <= pass.phase) endPhase();
+    }
+
+    void VulkanRenderGraph::beginPhase(VkCommandBuffer commandBuffer, const VulkanRenderer& renderer, uint32_t phase) const {
+        const auto pass = std::ranges::find_if(executionOrder, [&](const RenderGraphPass* candidate) {
+            return &candidate->renderer == &renderer;
+        });
+        if ((pass == executionOrder.end()) || (phase == 0) || (phase > (*pass)->phasesBarriers.size())) {
+            die("Render graph : phase not declared by the renderer");
+        }
+        recordBarriers(commandBuffer, (*pass)->phasesBarriers[phase - 1]);
+    }
+
+    void VulkanRenderGraph::endFrame(VkCommandBuffer commandBuffer) {
+        if (output != VK_NULL_HANDLE) {
+            addBarrier({
+                .resource = RenderGraphPass::toResource(output),
+                .layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                .stages = VK_PIPELINE_STAGE_2_BLIT_BIT,
+                .access = VK_ACCESS_2_TRANSFER_READ_BIT,
+                .aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+                .write = false,
+                .discard = false,
+                .history = false,
+                .phase = 0,
+            });
+            recordBarriers(commandBuffer, barriers);
+            barriers = {};
+        }
+        executionOrder.clear();
+        passes.clear();
+    }
+
+    void VulkanRenderGraph::addBarrier(const RenderGraphPass::Access& access) {
+        auto& state = states[access.resource];
+        auto discard = access.discard;
+        // First use of an aliased image after another image of the slot : the content is lost,
+        // wait for the previous uses of the memory
+        const auto slot = aliasingSlots.find(access.resource);
+        if (slot != aliasingSlots.end()) {
+            const auto owner = slotsOwners.find(slot->second);
+            if ((owner != slotsOwners.end()) && (owner->second != access.resource)) {
+                const auto& ownerState = states[owner->second];
+                state = {
+                    .writeStages = ownerState.writeStages | ownerState.readStages,
+                    .writeAccess = ownerState.writeAccess,
+                };
+                discard = true;
+            }
+            slotsOwners[slot->second] = access.resource;
+        }
+
+        const auto layoutChange = access.resource.image && (discard || (access.layout != state.layout));
+        if (!access.write && !layoutChange) {
+            // read after read, the last write is made visible only once to each stage
+            if ((state.writeStages != VK_PIPELINE_STAGE_2_NONE) &&
+                (((state.visibleStages & access.stages) != access.stages) ||
+                 ((state.visibleAccess & access.access) != access.access))) {
+                pushBarrier(access, state.layout, state.writeStages, state.writeAccess);
+                state.visibleStages |= access.stages;
+                state.visibleAccess |= access.access;
+            }
+            state.readStages |= access.stages;
+            return;
+        }
+
+        // write after read or write, or layout transition
+        const auto srcStages = state.writeStages | state.readStages;
+        if (layoutChange || (srcStages != VK_PIPELINE_STAGE_2_NONE)) {
+            pushBarrier(access, discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout, srcStages, state.writeAccess);
+        }
+        if (access.write) {
+            state = {
+                .layout = access.layout,
+                .writeStages = access.stages,
+                .writeAccess = access.access,
+            };
+        } else {
+            // the layout transition is visible to the reads of the pass
+            state = {
+                .layout = access.layout,
+                .writeStages = access.stages,
+                .visibleStages = access.stages,
+                .visibleAccess = access.access,
+                .readStages = access.stages,
+            };
+        }
+    }
+
+    void VulkanRenderGraph::pushBarrier(const RenderGraphPass::Access& access, VkImageLayout oldLayout,
+                                        VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess) {
+        if (access.resource.image) {
+            barriers.images.push_back({
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = srcStages,
+                .srcAccessMask = srcAccess,
+                .dstStageMask = access.stages,
+                .dstAccessMask = access.access,
+                .oldLayout = oldLayout,
+                .newLayout = access.layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = reinterpret_cast<VkImage>(access.resource.handle),
+                .subresourceRange = {
+                    .aspectMask = access.aspect,
+                    .baseMipLevel = 0,
+                    .levelCount = VK_REMAINING_MIP_LEVELS,
+                    .baseArrayLayer = 0,
+                    .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                },
+            });
+        } else {
+            barriers.buffers.push_back({
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                .srcStageMask = srcStages,
+                .srcAccessMask = srcAccess,
+                .dstStageMask = access.stages,
+                .dstAccessMask = access.access,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = reinterpret_cast<VkBuffer>(access.resource.handle),
+                .offset = 0,
+                .size = VK_WHOLE_SIZE,
+            });
+        }
+    }
+
+    // https://docs.vulkan.org/samples/latest/samples/extensions/synchronization2/README.html
+    void VulkanRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const RenderGraphPass::Barriers& barriers) {
+        if (barriers.images.empty() && barriers.buffers.empty()) return;
+        const VkDependencyInfo dependencyInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .bufferMemoryBarrierCount = static_cast<uint32_t>(barriers.buffers.size()),
+            .pBufferMemoryBarriers = barriers.buffers.data(),
+            .imageMemoryBarrierCount = static_cast<uint32_t>(barriers.images.size()),
+            .pImageMemoryBarriers = barriers.images.data(),
+        };
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+#ifdef VULKAN_STATS
+        VulkanStats::get().barriersCount += 1;
+#endif
+    }
+
+    void VulkanRenderGraph::setAliasingSlot(VkImage image, uint32_t slot) {
+        aliasingSlots[RenderGraphPass::toResource(image)] = slot;
+    }
+
+    void VulkanRenderGraph::removeImage(VkImage image) {
+        const auto resource = RenderGraphPass::toResource(image);
+        states.erase(resource);
+        aliasingSlots.erase(resource);
+        std::erase_if(slotsOwners, [&](const auto& owner) { return owner.second == resource; });
+    }
+
+}
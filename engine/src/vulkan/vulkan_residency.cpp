@@ -0,0 +1,119 @@
+#include "z0/vulkan/vulkan_residency.hpp"
+
+#include <algorithm>
+
+namespace z0 {
+
+    VulkanResidency::VulkanResidency(VmaAllocator vmaAllocator, uint32_t frames):
+        allocator{vmaAllocator}, framesInFlight{frames} {
+    }
+
+    VulkanResidency::handle_t VulkanResidency::add(MemoryCategory category, evict_t evict) {
+        handle_t handle;
+        if (freeHandles.empty()) {
+            handle = static_cast<handle_t>(resources.size());
+            resources.emplace_back();
+        } else {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+        }
+        resources[handle] = {
+            .category = category,
+            .evict = std::move(evict),
+            .lastUsedFrame = frameCount,
+            .valid = true,
+        };
+        return handle;
+    }
+
+    void VulkanResidency::remove(handle_t handle) {
+        resources[handle] = {};
+        freeHandles.push_back(handle);
+    }
+
+    void VulkanResidency::setResidentSize(handle_t handle, VkDeviceSize size) {
+        auto& resource = resources[handle];
+        if (resource.evicted && (size > 0)) {
+            resource.evicted = false;
+#ifdef VULKAN_STATS
+            VulkanStats::get().restreamsCount[resource.category] += 1;
+#endif
+        }
+        resource.size = size;
+    }
+
+    void VulkanResidency::use(handle_t handle) {
+        resources[handle].lastUsedFrame = frameCount;
+    }
+
+    bool VulkanResidency::reserve(VkDeviceSize size) {
+        refreshUsage();
+        const auto low = static_cast<VkDeviceSize>(static_cast<double>(budget) * LOW_WATERMARK);
+        if (size > low) return false;
+        return evict(low - size);
+    }
+
+    void VulkanResidency::update() {
+        frameCount += 1;
+        std::erase_if(releasing, [&](const Releasing& released) {
+            if (released.frame > frameCount) return false;
+            releasingSize -= released.size;
+            return true;
+        });
+        refreshUsage();
+        if (usage > static_cast<VkDeviceSize>(static_cast<double>(budget) * HIGH_WATERMARK)) {
+            evict(static_cast<VkDeviceSize>(static_cast<double>(budget) * LOW_WATERMARK));
+        }
+#ifdef VULKAN_STATS
+        VulkanStats::get().memoryHeapsUsage = usage;
+        VulkanStats::get().memoryHeapsBudget = budget;
+#endif
+    }
+
+    void VulkanResidency::refreshUsage() {
+        const VkPhysicalDeviceMemoryProperties* memoryProperties;
+        vmaGetMemoryProperties(allocator, &memoryProperties);
+        std::vector<VmaBudget> budgets(memoryProperties->memoryHeapCount);
+        vmaGetHeapBudgets(allocator, budgets.data());
+        VkDeviceSize heapsUsage{0};
+        VkDeviceSize heapsBudget{0};
+        for (uint32_t heap = 0; heap < memoryProperties->memoryHeapCount; heap++) {
+            if (memoryProperties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                heapsUsage += budgets[heap].usage;
+                heapsBudget += budgets[heap].budget;
+            }
+        }
+        // the evicted resources are destroyed a few frames later
+        usage = heapsUsage > releasingSize ? heapsUsage - releasingSize : 0;
+        budget = budgetOverride > 0 ? budgetOverride : heapsBudget;
+    }
+
+    bool VulkanResidency::evict(VkDeviceSize target) {
+        if (usage <= target) return true;
+        std::vector<handle_t> candidates;
+        for (handle_t handle = 0; handle < resources.size(); handle++) {
+            const auto& resource = resources[handle];
+            if (resource.valid && (resource.size > 0) && ((resource.lastUsedFrame + MIN_UNUSED_FRAMES) <= frameCount)) {
+                candidates.push_back(handle);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](handle_t a, handle_t b) {
+            return resources[a].lastUsedFrame < resources[b].lastUsedFrame;
+        });
+        for (const auto handle : candidates) {
+            if (usage <= target) break;
+            auto& resource = resources[handle];
+            const auto size = resource.size;
+            releasing.push_back({ resource.evict(), size, frameCount + framesInFlight });
+            releasingSize += size;
+            usage = usage > size ? usage - size : 0;
+            resource.size = 0;
+            resource.evicted = true;
+#ifdef VULKAN_STATS
+            VulkanStats::get().evictionsCount[resource.category] += 1;
+#endif
+        }
+        return usage <= target;
+    }
+
+}
@@ -16,8 +16,24 @@ namespace z0 {
                                std::string _name,
                                const std::vector<char> &code,
                                const VkDescriptorSetLayout *pSetLayouts,
-                               const VkPushConstantRange *pPushConstantRange):
-            device{dev}, stage{_stage}, stageFlags{_next_stage}, shaderName{std::move(_name)}, spirv{code} {
+                               const VkPushConstantRange *pPushConstantRange,
+                               const std::vector<uint32_t> &specializationConstants):
+            device{dev}, stage{_stage}, stageFlags{_next_stage}, shaderName{std::move(_name)}, spirv{code},
+            specializationData{specializationConstants} {
+        // https://docs.vulkan.org/guide/latest/pipelines.html#_specialization_constants
+        for (uint32_t id = 0; id < specializationData.size(); id++) {
+            specializationEntries.push_back({
+                .constantID = id,
+                .offset = static_cast<uint32_t>(id * sizeof(uint32_t)),
+                .size = sizeof(uint32_t),
+            });
+        }
+        specializationInfo = {
+            .mapEntryCount = static_cast<uint32_t>(specializationEntries.size()),
+            .pMapEntries = specializationEntries.data(),
+            .dataSize = specializationData.size() * sizeof(uint32_t),
+            .pData = specializationData.data(),
+        };
         shaderCreateInfo.sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT;
         shaderCreateInfo.pNext                  = nullptr;
         shaderCreateInfo.flags                  = 0;
@@ -31,7 +47,7 @@ namespace z0 {
         shaderCreateInfo.pSetLayouts            = pSetLayouts;
         shaderCreateInfo.pushConstantRangeCount = 0;
         shaderCreateInfo.pPushConstantRanges    = pPushConstantRange;
-        shaderCreateInfo.pSpecializationInfo    = nullptr;
+        shaderCreateInfo.pSpecializationInfo    = specializationData.empty() ? nullptr : &specializationInfo;
    }
 
     VulkanShader::~VulkanShader() {
@@ -0,0 +1,226 @@
+#include "z0/vulkan/vulkan_shader_cache.hpp"
+#include "z0/log.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+namespace z0 {
+
+    VulkanShaderCache::VulkanShaderCache(VkPhysicalDevice physicalDevice, VkDevice dev, std::filesystem::path dir):
+        device{dev}, directory{std::move(dir)} {
+        if (directory.empty()) return;
+        // the binaries are only compatible with the same shaderBinaryUUID & shaderBinaryVersion
+        VkPhysicalDeviceShaderObjectPropertiesEXT shaderObjectProperties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_PROPERTIES_EXT,
+        };
+        VkPhysicalDeviceProperties2 properties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &shaderObjectProperties,
+        };
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+        deviceHeader.magic = MAGIC;
+        deviceHeader.version = VERSION;
+        std::memcpy(deviceHeader.binaryUUID, shaderObjectProperties.shaderBinaryUUID, VK_UUID_SIZE);
+        deviceHeader.binaryVersion = shaderObjectProperties.shaderBinaryVersion;
+        deviceHeader.vendorID = properties.properties.vendorID;
+        deviceHeader.deviceID = properties.properties.deviceID;
+        deviceHeader.driverVersion = properties.properties.driverVersion;
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            log("shader cache disabled :", directory.string(), error.message());
+            directory.clear();
+        }
+    }
+
+    VkResult VulkanShaderCache::createShaders(uint32_t count, const VkShaderCreateInfoEXT* createInfos, VkShaderEXT* shaders) {
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+        auto result = VK_SUCCESS;
+        // The binary of a linked shader depends on the other stages of the link
+        std::vector<uint64_t> keys(count, 0);
+        if (!directory.empty()) {
+            uint64_t linkKey{0};
+            for (uint32_t i = 0; i < count; i++) {
+                if (createInfos[i].flags & VK_SHADER_CREATE_LINK_STAGE_BIT_EXT) {
+                    linkKey = hash(createInfos[i], linkKey);
+                }
+            }
+            for (uint32_t i = 0; i < count; i++) {
+                keys[i] = hash(createInfos[i], (createInfos[i].flags & VK_SHADER_CREATE_LINK_STAGE_BIT_EXT) ? linkKey : 0);
+            }
+        }
+        const auto hit = !directory.empty() && load(count, createInfos, keys.data(), shaders);
+        if (!hit) {
+            result = vkCreateShadersEXT(device, count, createInfos, nullptr, shaders);
+            if ((result == VK_SUCCESS) && !directory.empty()) {
+                for (uint32_t i = 0; i < count; i++) {
+                    save(keys[i], shaders[i]);
+                }
+            }
+        }
+        const auto duration = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        auto lock = std::lock_guard{statsMutex};
+        (hit ? hits : misses) += count;
+        creationTime += duration;
+        return result;
+    }
+
+    void VulkanShaderCache::logStats() const {
+        log("shaders :", std::format("{} loaded from the cache, {} created from SPIR-V, {:.1f} ms of shaders creation",
+                                     hits, misses, creationTime));
+    }
+
+    void VulkanShaderCache::addSetLayout(VkDescriptorSetLayout setLayout, uint64_t key) {
+        auto lock = std::lock_guard{setLayoutsMutex};
+        setLayoutsKeys[setLayout] = key;
+    }
+
+    void VulkanShaderCache::removeSetLayout(VkDescriptorSetLayout setLayout) {
+        // the handle can be reused by another layout
+        auto lock = std::lock_guard{setLayoutsMutex};
+        setLayoutsKeys.erase(setLayout);
+    }
+
+    bool VulkanShaderCache::load(uint32_t count, const VkShaderCreateInfoEXT* createInfos, const uint64_t* keys,
+                                 VkShaderEXT* shaders) const {
+        std::vector<std::vector<char>> binaries(count);
+        for (uint32_t i = 0; i < count; i++) {
+            if (!read(keys[i], binaries[i])) return false;
+        }
+        // Same create infos as the SPIR-V version, only the code changes
+        std::vector<VkShaderCreateInfoEXT> binaryCreateInfos(createInfos, createInfos + count);
+        for (uint32_t i = 0; i < count; i++) {
+            binaryCreateInfos[i].codeType = VK_SHADER_CODE_TYPE_BINARY_EXT;
+            binaryCreateInfos[i].codeSize = binaries[i].size();
+            binaryCreateInfos[i].pCode = binaries[i].data();
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            shaders[i] = VK_NULL_HANDLE;
+        }
+        if (vkCreateShadersEXT(device, count, binaryCreateInfos.data(), nullptr, shaders) != VK_SUCCESS) {
+            // VK_INCOMPATIBLE_SHADER_BINARY_EXT if the driver rejects one of the binaries
+            log("shader cache : incompatible binary", getFilename(keys[0]).string());
+            for (uint32_t i = 0; i < count; i++) {
+                if (shaders[i] != VK_NULL_HANDLE) {
+                    vkDestroyShaderEXT(device, shaders[i], nullptr);
+                    shaders[i] = VK_NULL_HANDLE;
+                }
+            }
+            return false;
+        }
+        return true;
+    }
+
+    bool VulkanShaderCache::read(uint64_t key, std::vector<char>& data) const {
+        const auto filename = getFilename(key);
+        std::ifstream file{filename, std::ios::binary | std::ios::ate};
+        if (!file) return false;
+        const auto fileSize = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+        Header header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        // Older device, driver or engine : the file will be replaced after the shader creation
+        if ((header.magic != deviceHeader.magic) ||
+            (header.version != deviceHeader.version) ||
+            (std::memcmp(header.binaryUUID, deviceHeader.binaryUUID, VK_UUID_SIZE) != 0) ||
+            (header.binaryVersion != deviceHeader.binaryVersion) ||
+            (header.vendorID != deviceHeader.vendorID) ||
+            (header.deviceID != deviceHeader.deviceID) ||
+            (header.driverVersion != deviceHeader.driverVersion) ||
+            (header.key != key)) {
+            return false;
+        }
+        // Truncated file or corrupted size : the entry is discarded before allocating the data
+        if (header.dataSize != (fileSize - sizeof(header))) {
+            log("shader cache : corrupted file", filename.string());
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(filename, error);
+            return false;
+        }
+        data.resize(header.dataSize);
+        if (!file.read(data.data(), static_cast<std::streamsize>(data.size())) ||
+            (hash(data.data(), data.size(), 0) != header.dataHash)) {
+            log("shader cache : corrupted file", filename.string());
+            return false;
+        }
+        return true;
+    }
+
+    void VulkanShaderCache::save(uint64_t key, VkShaderEXT shader) const {
+        size_t size{0};
+        if ((vkGetShaderBinaryDataEXT(device, shader, &size, nullptr) != VK_SUCCESS) || (size == 0)) return;
+        std::vector<char> data(size);
+        if (vkGetShaderBinaryDataEXT(device, shader, &size, data.data()) != VK_SUCCESS) return;
+
+        auto header = deviceHeader;
+        header.key = key;
+        header.dataSize = size;
+        header.dataHash = hash(data.data(), size, 0);
+        // Written in a temporary file then renamed to never leave a partial file in the cache
+        const auto filename = getFilename(key);
+        auto tempFilename = filename;
+        tempFilename += ".tmp";
+        {
+            std::ofstream file{tempFilename, std::ios::binary | std::ios::trunc};
+            if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+                !file.write(data.data(), static_cast<std::streamsize>(size))) {
+                log("shader cache : failed to write", tempFilename.string());
+                return;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(tempFilename, filename, error);
+        if (error) {
+            std::filesystem::remove(tempFilename, error);
+        }
+    }
+
+    std::filesystem::path VulkanShaderCache::getFilename(uint64_t key) const {
+        return directory / std::format("{:016x}.bin", key);
+    }
+
+    // https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+    uint64_t VulkanShaderCache::hash(const void* data, size_t size, uint64_t seed) {
+        auto result = seed ^ 0xcbf29ce484222325ull;
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            result ^= bytes[i];
+            result *= 0x100000001b3ull;
+        }
+        return result;
+    }
+
+    uint64_t VulkanShaderCache::hash(const VkShaderCreateInfoEXT& createInfo, uint64_t seed) const {
+        auto result = hash(createInfo.pCode, createInfo.codeSize, seed);
+        result = hash(&createInfo.flags, sizeof(createInfo.flags), result);
+        result = hash(&createInfo.stage, sizeof(createInfo.stage), result);
+        result = hash(&createInfo.nextStage, sizeof(createInfo.nextStage), result);
+        if (const auto* specialization = createInfo.pSpecializationInfo) {
+            result = hash(specialization->pMapEntries,
+                          specialization->mapEntryCount * sizeof(VkSpecializationMapEntry), result);
+            result = hash(specialization->pData, specialization->dataSize, result);
+        }
+        {
+            auto lock = std::lock_guard{setLayoutsMutex};
+            for (uint32_t i = 0; i < createInfo.setLayoutCount; i++) {
+                const auto setLayout = createInfo.pSetLayouts[i];
+                if (const auto it = setLayoutsKeys.find(setLayout); it != setLayoutsKeys.end()) {
+                    result = hash(&it->second, sizeof(it->second), result);
+                } else {
+                    result = hash(&setLayout, sizeof(setLayout), result);
+                }
+            }
+        }
+        result = hash(createInfo.pPushConstantRanges,
+                      createInfo.pushConstantRangeCount * sizeof(VkPushConstantRange), result);
+        return result;
+    }
+
+}
@@ -13,6 +13,17 @@ namespace z0 {
         std::cout << descriptorSetsCount << " descriptor sets" << std::endl;
         std::cout << imagesCount << " images" << std::endl;
         std::cout << averageFps << " avg FPS" << std::endl;
+        std::cout << trianglesCount.load() << " triangles per frame" << std::endl;
+        std::cout << shaderBindsCount.load() << " shader binds per frame" << std::endl;
+        std::cout << barriersCount.load() << " pipeline barriers per frame" << std::endl;
+        const char* categories[] = { "buffers", "textures", "cubemaps", "attachments", "shadow maps" };
+        for (uint32_t category = 0; category < MEMORY_CATEGORIES_COUNT; category++) {
+            std::cout << memoryUsage[category] / (1024 * 1024) << " MB of " << categories[category]
+                      << ", " << evictionsCount[category] << " evictions, "
+                      << restreamsCount[category] << " restreams" << std::endl;
+        }
+        std::cout << memoryHeapsUsage / (1024 * 1024) << "/" << memoryHeapsBudget / (1024 * 1024)
+                  << " MB of video memory budget" << std::endl;
     }
 #endif
 
@@ -0,0 +1,156 @@
+#include "z0/vulkan/vulkan_texture_streamer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace z0 {
+
+    VulkanTextureStreamer::VulkanTextureStreamer(VulkanDevice& device, VulkanTextureTable& table):
+        vulkanDevice{device}, textureTable{table} {
+    }
+
+    void VulkanTextureStreamer::add(const std::shared_ptr<VulkanImage>& image) {
+        if (image->getSource() == nullptr || images.contains(image.get())) return;
+        auto& streamed = images[image.get()];
+        streamed.tail = image;
+        streamed.residentLevel = image->getBaseLevel();
+        streamed.requestedLevel = image->getBaseLevel();
+        // the map nodes are stable
+        streamed.residencyHandle = vulkanDevice.getResidency().add(MEMORY_TEXTURES, [this, &streamed]() {
+            std::shared_ptr<void> evicted = streamed.resident;
+            setResident(streamed, nullptr, streamed.tail->getBaseLevel());
+            return evicted;
+        });
+    }
+
+    void VulkanTextureStreamer::request(const VulkanImage* image, float screenSize) {
+        auto it = images.find(image);
+        if (it == images.end()) return;
+        auto& streamed = it->second;
+        // the surface is mapped once by the texture : one texel per pixel
+        const auto texels = static_cast<float>(std::max(image->getWidth(), image->getHeight()));
+        const auto level = static_cast<uint32_t>(std::clamp(
+                std::floor(std::log2(texels / std::max(screenSize, 1.0f))),
+                0.0f,
+                static_cast<float>(streamed.tail->getBaseLevel())));
+        // the finest level requested by the surfaces of this frame
+        if (streamed.lastUsedFrame != frameCount) {
+            streamed.requestedLevel = level;
+            streamed.lastUsedFrame = frameCount;
+            vulkanDevice.getResidency().use(streamed.residencyHandle);
+        } else {
+            streamed.requestedLevel = std::min(streamed.requestedLevel, level);
+        }
+    }
+
+    void VulkanTextureStreamer::update() {
+        auto& residency = vulkanDevice.getResidency();
+        // swap the uploaded levels, the frames recorded from now on can sample them
+        uint32_t pendingCount{0};
+        for (auto& [key, streamed] : images) {
+            if (streamed.uploadFence == VK_NULL_HANDLE) continue;
+            if (vkGetFenceStatus(vulkanDevice.getDevice(), streamed.uploadFence) != VK_SUCCESS) {
+                pendingCount += 1;
+                continue;
+            }
+            auto image = streamed.uploading;
+            endUpload(streamed);
+            // the resident level may have changed during the upload, only a finer level is swapped in
+            if (streamed.pendingLevel < streamed.residentLevel) {
+                setResident(streamed, image, streamed.pendingLevel);
+            }
+        }
+
+        // upload the prepared levels without waiting for the GPU
+        uint32_t uploads{0};
+        for (auto& [key, streamed] : images) {
+            if (!streamed.pending.valid()) continue;
+            if ((uploads == MAX_UPLOADS_PER_FRAME) ||
+                (streamed.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) {
+                pendingCount += 1;
+                continue;
+            }
+            auto level = streamed.pending.get();
+            // the image is still visible, the level is finer than the resident one & fits in the budget
+            if ((streamed.lastUsedFrame == frameCount) &&
+                (streamed.pendingLevel < streamed.residentLevel) &&
+                residency.reserve(getStreamingSize(streamed, streamed.pendingLevel))) {
+                streamed.uploadCommands = vulkanDevice.beginSingleTimeCommands();
+                streamed.uploading = std::make_shared<VulkanImage>(vulkanDevice,
+                                                                   streamed.uploadCommands,
+                                                                   level.width, level.height,
+                                                                   level.pixels.size(),
+                                                                   level.pixels.data(),
+                                                                   streamed.tail->getSource()->format);
+                streamed.uploadFence = vulkanDevice.submitSingleTimeCommands(streamed.uploadCommands);
+                pendingCount += 1;
+                uploads += 1;
+            }
+        }
+
+        // start the loads of the requested levels, the biggest resolution deficits first
+        std::vector<StreamedImage*> requests;
+        for (auto& [key, streamed] : images) {
+            if ((streamed.lastUsedFrame == frameCount) &&
+                (streamed.requestedLevel < streamed.residentLevel) &&
+                !streamed.pending.valid() &&
+                (streamed.uploadFence == VK_NULL_HANDLE)) {
+                requests.push_back(&streamed);
+            }
+        }
+        std::sort(requests.begin(), requests.end(), [](const StreamedImage* a, const StreamedImage* b) {
+            return (a->residentLevel - a->requestedLevel) > (b->residentLevel - b->requestedLevel);
+        });
+        for (auto* streamed : requests) {
+            if (pendingCount == MAX_PENDING_LOADS) break;
+            // checked again when loaded, the usage may have changed
+            const auto level = streamed->requestedLevel;
+            if (!residency.reserve(getStreamingSize(*streamed, level))) continue;
+            streamed->pendingLevel = level;
+            streamed->pending = std::async(std::launch::async, [source = streamed->tail->getSource(), level]() {
+                Level result;
+                result.pixels = source->getLevel(level, result.width, result.height);
+                return result;
+            });
+            pendingCount += 1;
+        }
+        frameCount += 1;
+    }
+
+    void VulkanTextureStreamer::setResident(StreamedImage& streamed, const std::shared_ptr<VulkanImage>& image, uint32_t level) {
+        streamed.resident = image;
+        streamed.residentLevel = level;
+        vulkanDevice.getResidency().setResidentSize(streamed.residencyHandle,
+                                                    image != nullptr ? streamed.tail->getSource()->getMipChainSize(level) : 0);
+        textureTable.replace(streamed.tail, image != nullptr ? image : streamed.tail);
+    }
+
+    void VulkanTextureStreamer::endUpload(StreamedImage& streamed) {
+        vulkanDevice.releaseSingleTimeCommands(streamed.uploadCommands, streamed.uploadFence);
+        streamed.uploading->releaseStagingBuffer();
+        streamed.uploading.reset();
+        streamed.uploadCommands = VK_NULL_HANDLE;
+        streamed.uploadFence = VK_NULL_HANDLE;
+    }
+
+    VkDeviceSize VulkanTextureStreamer::getStreamingSize(const StreamedImage& streamed, uint32_t level) {
+        const auto& source = streamed.tail->getSource();
+        return source->getMipChainSize(level) -
+               (streamed.resident != nullptr ? source->getMipChainSize(streamed.residentLevel) : 0);
+    }
+
+    void VulkanTextureStreamer::cleanup() {
+        // wait for the worker threads & the uploads
+        for (auto& [key, streamed] : images) {
+            if (streamed.pending.valid()) streamed.pending.wait();
+            if (streamed.uploadFence != VK_NULL_HANDLE) {
+                vkWaitForFences(vulkanDevice.getDevice(), 1, &streamed.uploadFence, VK_TRUE, UINT64_MAX);
+                endUpload(streamed);
+            }
+            vulkanDevice.getResidency().remove(streamed.residencyHandle);
+        }
+        images.clear();
+    }
+
+}
@@ -0,0 +1,121 @@
+#include "z0/vulkan/vulkan_texture_table.hpp"
+#include "z0/log.hpp"
+
+#include <algorithm>
+
+namespace z0 {
+
+    VulkanTextureTable::VulkanTextureTable(VulkanDevice& device): vulkanDevice{device} {
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+        };
+        VkPhysicalDeviceProperties2 properties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &indexingProperties,
+        };
+        vkGetPhysicalDeviceProperties2(vulkanDevice.getPhysicalDevice(), &properties);
+        // keep some room for the other samplers of the shaders
+        const auto deviceLimit = std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                          indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+        capacity = std::min(MAX_TEXTURES, std::max(deviceLimit, RESERVED_SAMPLERS) - RESERVED_SAMPLERS);
+        if (capacity < MIN_TEXTURES) {
+            die("Bindless textures not supported : the device allows", std::to_string(deviceLimit),
+                "update after bind samplers per stage, at least",
+                std::to_string(MIN_TEXTURES + RESERVED_SAMPLERS), "are needed");
+        }
+        images.resize(capacity);
+        // popped from the back, the lowest slots are used first
+        freeSlots.reserve(capacity);
+        for (auto index = static_cast<int32_t>(capacity) - 1; index >= 0; index--) {
+            freeSlots.push_back(index);
+        }
+    }
+
+    int32_t VulkanTextureTable::add(const std::shared_ptr<VulkanImage>& image) {
+        if (auto it = slots.find(image.get()); it != slots.end()) {
+            it->second.useCount += 1;
+            return it->second.index;
+        }
+        if (freeSlots.empty()) {
+            die("Textures table full :", std::to_string(capacity), "textures");
+        }
+        const auto index = freeSlots.back();
+        freeSlots.pop_back();
+        images[index] = image;
+        slots[image.get()] = { index, 1 };
+        for (auto& frameSlots : dirtySlots) {
+            frameSlots.push_back(index);
+        }
+        return index;
+    }
+
+    void VulkanTextureTable::remove(const std::shared_ptr<VulkanImage>& image) {
+        auto it = slots.find(image.get());
+        if (it == slots.end()) return;
+        it->second.useCount -= 1;
+        if (it->second.useCount == 0) {
+            // the image is kept alive until the frames in flight are completed
+            releasedSlots.push_back({ it->second.index, frameCount + MAX_FRAMES_IN_FLIGHT });
+            slots.erase(it);
+        }
+    }
+
+    void VulkanTextureTable::replace(const std::shared_ptr<VulkanImage>& image, const std::shared_ptr<VulkanImage>& content) {
+        auto it = slots.find(image.get());
+        if (it == slots.end()) return;
+        const auto index = it->second.index;
+        if (images[index] == content) return;
+        retiredImages.push_back({ images[index], frameCount + MAX_FRAMES_IN_FLIGHT });
+        images[index] = content;
+        for (auto& frameSlots : dirtySlots) {
+            frameSlots.push_back(index);
+        }
+    }
+
+    void VulkanTextureTable::update(VkDescriptorSet descriptorSet, uint32_t binding, uint32_t currentFrame) {
+        frameCount += 1;
+        std::erase_if(releasedSlots, [&](const ReleasedSlot& released) {
+            if (released.frame > frameCount) return false;
+            images[released.index].reset();
+            freeSlots.push_back(released.index);
+            return true;
+        });
+        std::erase_if(retiredImages, [&](const RetiredImage& retired) {
+            return retired.frame <= frameCount;
+        });
+
+        auto& frameSlots = dirtySlots[currentFrame];
+        if (frameSlots.empty()) return;
+        std::vector<VkDescriptorImageInfo> imagesInfo;
+        std::vector<VkWriteDescriptorSet> writes;
+        imagesInfo.reserve(frameSlots.size());
+        writes.reserve(frameSlots.size());
+        for (const auto index : frameSlots) {
+            // released before this frame update
+            if (images[index] == nullptr) continue;
+            imagesInfo.push_back(images[index]->imageInfo());
+            writes.push_back({
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSet,
+                .dstBinding = binding,
+                .dstArrayElement = static_cast<uint32_t>(index),
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &imagesInfo.back(),
+            });
+        }
+        vkUpdateDescriptorSets(vulkanDevice.getDevice(), writes.size(), writes.data(), 0, nullptr);
+        frameSlots.clear();
+    }
+
+    void VulkanTextureTable::cleanup() {
+        slots.clear();
+        releasedSlots.clear();
+        retiredImages.clear();
+        for (auto& frameSlots : dirtySlots) {
+            frameSlots.clear();
+        }
+        images.clear();
+    }
+
+}